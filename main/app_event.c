@@ -0,0 +1,115 @@
+#include "app_event.h"
+#include "config.h"
+#include "peer_sync.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include <stdatomic.h>
+#include <sys/time.h>
+
+static const char *TAG = "app_event";
+
+static QueueHandle_t event_queue = NULL;
+static esp_timer_handle_t tick_timer = NULL;
+static esp_timer_handle_t wake_timer = NULL;
+
+// Status event types currently sitting in the queue
+static atomic_uint queued_status = 0;
+
+// Deadline of the armed wake-up (esp_timer time), 0 if none
+static int64_t wake_deadline_us = 0;
+static portMUX_TYPE wake_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Arm the tick for just after the next displayed second boundary. Re-armed
+// from every tick, so slewing and peer phase changes are followed.
+static void arm_tick(void) {
+    struct timeval tv;
+    peer_sync_get_time(&tv);
+    esp_timer_stop(tick_timer);
+    esp_timer_start_once(tick_timer, 1000000 - tv.tv_usec + APP_EVENT_TICK_MARGIN_US);
+}
+
+static void tick_cb(void *arg) {
+    app_event_post(APP_EVENT_TICK);
+    arm_tick();
+}
+
+static void wake_cb(void *arg) {
+    portENTER_CRITICAL(&wake_lock);
+    wake_deadline_us = 0;
+    portEXIT_CRITICAL(&wake_lock);
+    app_event_post(APP_EVENT_FRAME);
+}
+
+void app_event_init(void) {
+    event_queue = xQueueCreate(APP_EVENT_QUEUE_LEN, sizeof(app_event_t));
+
+    const esp_timer_create_args_t tick_args = {
+        .callback = tick_cb,
+        .name = "app_tick",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&tick_args, &tick_timer));
+    const esp_timer_create_args_t wake_args = {
+        .callback = wake_cb,
+        .name = "app_wake",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&wake_args, &wake_timer));
+    arm_tick();
+}
+
+void app_event_post(app_event_type_t type) {
+    // A stepped clock moves the second boundary, even when the event itself
+    // is coalesced with one already queued
+    if (type == APP_EVENT_SYNC) {
+        arm_tick();
+    }
+
+    unsigned bit = 1u << type;
+    if (atomic_fetch_or(&queued_status, bit) & bit) {
+        return;
+    }
+
+    app_event_t event = { .type = type };
+    if (xQueueSend(event_queue, &event, 0) != pdTRUE) {
+        atomic_fetch_and(&queued_status, ~bit);
+        ESP_LOGD(TAG, "Event queue full, dropping event %d", type);
+    }
+}
+
+void app_event_post_input(const input_event_t *input) {
+    app_event_t event = {
+        .type = APP_EVENT_INPUT,
+        .input = *input,
+    };
+    if (xQueueSend(event_queue, &event, 0) != pdTRUE) {
+        ESP_LOGD(TAG, "Event queue full, dropping input %d", input->type);
+    }
+}
+
+bool app_event_wait(app_event_t *event, TickType_t timeout) {
+    if (xQueueReceive(event_queue, event, timeout) != pdTRUE) {
+        return false;
+    }
+    if (event->type != APP_EVENT_INPUT) {
+        atomic_fetch_and(&queued_status, ~(1u << event->type));
+    }
+    return true;
+}
+
+bool app_event_peek(app_event_t *event) {
+    return xQueuePeek(event_queue, event, 0) == pdTRUE;
+}
+
+void app_event_wake_after(uint32_t ms) {
+    int64_t deadline = esp_timer_get_time() + (int64_t)ms * 1000;
+
+    portENTER_CRITICAL(&wake_lock);
+    bool sooner = wake_deadline_us == 0 || deadline < wake_deadline_us;
+    if (sooner) wake_deadline_us = deadline;
+    portEXIT_CRITICAL(&wake_lock);
+
+    if (sooner) {
+        esp_timer_stop(wake_timer);
+        esp_timer_start_once(wake_timer, (uint64_t)ms * 1000);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef APP_EVENT_H
+#define APP_EVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "input.h"
+
+// The UI task's single event queue. Input, the once-a-second clock tick,
+// WiFi and time sync status changes and frame wake-ups all arrive here, so
+// the main loop sleeps until something actually happens.
+
+typedef enum {
+    APP_EVENT_INPUT,        // Touch or BOOT button event in .input
+    APP_EVENT_TICK,         // Displayed time crossed a second boundary
+    APP_EVENT_WIFI,         // Connection, connect progress or scan results changed
+    APP_EVENT_SYNC,         // Time sync attempt finished (the clock may have stepped)
+    APP_EVENT_FRAME,        // Wake-up requested with app_event_wake_after()
+} app_event_type_t;
+
+typedef struct {
+    app_event_type_t type;
+    input_event_t input;
+} app_event_t;
+
+// Create the queue and start the second tick (call before input_init)
+void app_event_init(void);
+
+// Post a status event from any task. Events other than input are coalesced:
+// one already waiting in the queue is not queued again.
+void app_event_post(app_event_type_t type);
+
+// Post an input event (input task)
+void app_event_post_input(const input_event_t *input);
+
+// Wait up to timeout for the next event. Returns false on timeout.
+bool app_event_wait(app_event_t *event, TickType_t timeout);
+
+// Look at the next event without removing it. Returns false if none.
+bool app_event_peek(app_event_t *event);
+
+// Post APP_EVENT_FRAME after ms; an earlier pending wake-up wins
+void app_event_wake_after(uint32_t ms);
+
+#endif // APP_EVENT_H
@@ -13,6 +13,16 @@
 #define TOUCH_MAX_X         3900
 #define TOUCH_MIN_Y         240
 #define TOUCH_MAX_Y         3800
+#define TOUCH_SPI_HZ        2000000   // XPT2046 allows 2.5 MHz at 125 kHz conversion rate
+#define TOUCH_BURST_SAMPLES 5         // X/Y pairs per burst, median taken
+#define TOUCH_PRESS_PRESSURE 500      // Z1 + 4095 - Z2 needed to start a touch
+#define TOUCH_RELEASE_PRESSURE 300    // ...and below this a touch ends (hysteresis)
+#define TOUCH_RELEASE_SAMPLES 2       // Consecutive light readings before a release
+#define TOUCH_MAX_SPREAD    200       // Raw max-min within a burst; above means unstable
+#define TOUCH_RAW_EDGE      100       // Raw readings this close to 0/4095 are rejected
+#define TOUCH_IIR_SHIFT     1         // Position filter: new = old + (sample - old) >> shift
+#define TOUCH_CAL_MARGIN    30        // Calibration targets inset from the screen edges
+#define TOUCH_CAL_MAX_ERROR_PX 12     // Reject a calibration whose fit misses a target by more
 
 // UI layout constants
 #define CHAR_WIDTH          8
@@ -31,24 +41,84 @@
 #define BRIGHTNESS_MIN      32
 #define BRIGHTNESS_DEFAULT  255
 #define BRIGHTNESS_MAX      255
+#define SLIDER_APPLY_MS     50   // Backlight/LED update interval while dragging a slider
 
-// Touch debounce
-#define TOUCH_DEBOUNCE_MS   200
-#define TOUCH_RELEASE_POLL_MS 50
+// Touch handling
+#define TOUCH_PRESS_MAX_AGE_MS 500    // Unhandled touch-downs older than this are dropped
 
-// Clock polling intervals (ms)
-#define POLL_FAST_MS        2    // Near second boundary (>980ms)
-#define POLL_MID_MS         10   // Approaching boundary (>900ms)
-#define POLL_NORMAL_MS      20   // Normal polling
-#define POLL_THRESHOLD_MS   980  // When to switch to fast polling
+// App events
+#define APP_EVENT_QUEUE_LEN 24
+#define APP_EVENT_TICK_MARGIN_US 500  // Tick lands this far past the second boundary
+
+// Input events
+#define INPUT_SAMPLE_MS     10   // Touch sampling period while pressed (100 Hz)
+#define INPUT_MOVE_MIN_PX   2    // Smaller position changes are not reported
+#define INPUT_BUTTON_DEBOUNCE_MS 20
+
+// Gestures and list scrolling
+#define GESTURE_SLOP_PX     8    // Movement before a press becomes a drag
+#define GESTURE_LONG_PRESS_MS 600
+#define GESTURE_FLING_MIN_PX_S 300   // Release speed that starts inertial scrolling
+#define GESTURE_FLING_IDLE_MS 60     // No fling if the finger rested this long before lifting
+#define UI_LIST_DECAY_MS    350  // Inertia time constant (velocity falls to 1/e)
+#define UI_LIST_STOP_PX_S   20   // Inertia ends below this speed
+#define UI_FRAME_MS         16   // Main loop period while a screen is animating
 
 // NTP defaults
 #define NTP_MIN_INTERVAL_SEC    15
 #define NTP_DEFAULT_INTERVAL_SEC 86400  // 24 hours
+#define NTP_RESPONSE_TIMEOUT_MS 2000
+#define NTP_STEP_THRESHOLD_MS   128     // Larger offsets step the clock, smaller ones slew
+#define NTP_RETRY_MIN_SEC       2       // First retry after a failed sync
+#define NTP_RETRY_MAX_SEC       300     // Retry backoff cap
+#define NTP_BURST_SAMPLES       4       // Queries per sync once synced (lowest delay wins)
+#define NTP_BURST_SPACING_MS    2000    // Gap between burst queries (server rate limits)
+#define NTP_DHCP_MAX_SERVERS    3       // Matches CONFIG_LWIP_SNTP_MAX_SERVERS
+
+// HTTP Date-header time fallback (for networks blocking NTP)
+#define HTTP_TIME_TIMEOUT_MS    3000
+#define HTTP_TIME_RETRY_MIN_SEC 10      // Retry after a failed request
+#define HTTP_TIME_REFRESH_SEC   600     // Re-fetch while NTP is still unsynced
+
+// DNS cache (NTP hostnames)
+#define DNS_CACHE_SIZE          4
+#define DNS_CACHE_TTL_SEC       3600    // lwIP does not expose record TTLs
+#define DNS_CACHE_REFRESH_AHEAD_SEC 300 // Re-resolve this long before expiry
+
+// Peer phase sync (multicast beacons between clocks on the same subnet)
+#define PEER_SYNC_GROUP         "239.255.12.3"
+#define PEER_SYNC_PORT          12123
+#define PEER_SYNC_BEACON_MS     2000    // Leader beacon interval
+#define PEER_SYNC_LEADER_TIMEOUT_MS 7000 // Take over after this long without beacons
+#define PEER_SYNC_MAX_PHASE_MS  500     // Ignore peers further off than this
+#define PEER_SYNC_SLEW_US       5000    // Max phase change per beacon
+
+// Settings storage (RAM cache flushed to NVS in the background)
+#define NVS_FLUSH_QUIET_MS      2000    // Flush once settings stop changing for this long
+#define NVS_FLUSH_MAX_DELAY_MS  10000   // ...or at the latest this long after the first change
+
+// Time persistence across resets
+#define TIMEKEEP_NVS_SAVE_SEC   3600    // Min interval between saving time to flash
+#define TIMEKEEP_DRIFT_MIN_SEC  600     // Min span between syncs to learn RTC drift
 
 // WiFi
 #define WIFI_MAX_RETRY      5
 #define WIFI_CONNECT_TIMEOUT_MS 15000
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000   // Directed connect to the cached AP
+#define WIFI_FAST_CONNECT_RETRY 1
+#define WIFI_RECONNECT_MIN_MS 2000              // First reconnect backoff after losing the link
+#define WIFI_RECONNECT_MAX_MS 300000            // Reconnect backoff cap
+#define WIFI_ROAM_CHECK_MS  10000               // Link RSSI poll period
+#define WIFI_ROAM_RSSI_DBM  -75                 // Look for a better AP below this
+#define WIFI_ROAM_WEAK_CHECKS 3                 // Consecutive weak polls before scanning
+#define WIFI_ROAM_SCAN_INTERVAL_SEC 300         // At most one roaming scan per interval
+#define WIFI_ROAM_HYSTERESIS_DB 8               // A candidate must beat the link by this much
+#define WIFI_ROAM_UNSEEN_PENALTY_DB 30          // Known network missing from the last scan
+#define WIFI_PS_LISTEN_INTERVAL 10             // Beacons between wakeups in the power saver profile
+#define WIFI_PS_UI_BOOST_MS 10000               // Radio stays fully awake after a touch
+#define WIFI_SCAN_CHANNELS  13                  // Channels swept by the incremental scan
+#define WIFI_SCAN_DWELL_MIN_MS 100              // Active scan time per channel
+#define WIFI_SCAN_DWELL_MAX_MS 300
 
 // Gamma correction for perceptually linear brightness (quadratic approximation of gamma 2.2)
 static inline uint8_t gamma_correct(uint8_t linear) {
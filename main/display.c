@@ -434,9 +434,20 @@ void display_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
     display_vline(x + w - 1, y, h, color);
 }
 
-void display_char(int16_t x, int16_t y, char c, uint16_t fg, uint16_t bg) {
+const uint8_t *display_glyph(char c) {
     if (c < 32 || c > 127) c = '?';
-    const uint8_t *glyph = &font_8x16[(c - 32) * 16];
+    return &font_8x16[(c - 32) * 16];
+}
+
+void display_blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) {
+    if (w <= 0 || h <= 0) return;
+    set_addr_window(x, y, w, h);
+    dc_data();
+    spi_write_bytes((const uint8_t *)pixels, (size_t)w * h * 2);
+}
+
+void display_char(int16_t x, int16_t y, char c, uint16_t fg, uint16_t bg) {
+    const uint8_t *glyph = display_glyph(c);
 
     set_addr_window(x, y, 8, 16);
     dc_data();
@@ -44,6 +44,14 @@ void display_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
 // Draw character (8x16 font)
 void display_char(int16_t x, int16_t y, char c, uint16_t fg, uint16_t bg);
 
+// Glyph for c in the 8x16 font: 16 row bytes, MSB is the leftmost pixel
+const uint8_t *display_glyph(char c);
+
+// Copy a block of pixels to the screen. Pixels are RGB565 in panel byte
+// order (high byte first), as produced by DISPLAY_PIXEL().
+#define DISPLAY_PIXEL(color) ((uint16_t)(((color) >> 8) | ((color) << 8)))
+void display_blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels);
+
 // Draw string
 void display_string(int16_t x, int16_t y, const char *str, uint16_t fg, uint16_t bg);
 
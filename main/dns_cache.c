@@ -0,0 +1,147 @@
+#include "dns_cache.h"
+#include "config.h"
+#include "nvs_config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <string.h>
+
+static const char *TAG = "dns_cache";
+
+typedef struct {
+    char name[MAX_NTP_SERVER_LEN];
+    uint32_t ip;                // Network byte order
+    int64_t expires_us;         // esp_timer time; 0 means stale (restored from flash)
+    uint32_t last_used;         // For LRU replacement
+} dns_entry_t;
+
+_Static_assert(DNS_CACHE_SIZE <= DNS_SAVED_MAX, "DNS cache larger than its saved table");
+
+static dns_entry_t entries[DNS_CACHE_SIZE];
+static uint32_t use_counter = 0;
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds cache_lock
+static dns_entry_t *find_entry(const char *name) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (entries[i].name[0] && strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Caller holds cache_lock
+static void store_entry(const char *name, uint32_t ip, int64_t expires_us) {
+    dns_entry_t *entry = find_entry(name);
+    if (!entry) {
+        // Empty slot or least recently used
+        entry = &entries[0];
+        for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+            if (!entries[i].name[0]) {
+                entry = &entries[i];
+                break;
+            }
+            if (entries[i].last_used < entry->last_used) entry = &entries[i];
+        }
+        strncpy(entry->name, name, sizeof(entry->name) - 1);
+        entry->name[sizeof(entry->name) - 1] = '\0';
+    }
+    entry->ip = ip;
+    entry->expires_us = expires_us;
+    entry->last_used = ++use_counter;
+}
+
+// Caller holds cache_lock
+static void snapshot_table(dns_saved_t *saved) {
+    memset(saved, 0, sizeof(dns_saved_t) * DNS_SAVED_MAX);
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        memcpy(saved[i].name, entries[i].name, sizeof(saved[i].name));
+        saved[i].ip = entries[i].ip;
+    }
+}
+
+// Blocking DNS lookup; lwIP does not report the record TTL, so a fixed
+// lifetime is used
+static bool lookup(const char *name, uint32_t *ip) {
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res = NULL;
+
+    if (getaddrinfo(name, NULL, &hints, &res) != 0 || !res) {
+        ESP_LOGW(TAG, "DNS lookup failed for %s", name);
+        return false;
+    }
+
+    *ip = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+
+    // Every host keeps its slot on flash, so the NTP and HTTP time hosts do
+    // not evict each other there
+    dns_saved_t saved[DNS_SAVED_MAX];
+    uint32_t old_ip = 0;
+    portENTER_CRITICAL(&cache_lock);
+    dns_entry_t *entry = find_entry(name);
+    if (entry) old_ip = entry->ip;
+    store_entry(name, *ip, esp_timer_get_time() + (int64_t)DNS_CACHE_TTL_SEC * 1000000);
+    bool changed = *ip != old_ip;
+    if (changed) snapshot_table(saved);
+    portEXIT_CRITICAL(&cache_lock);
+
+    // Only write flash when an address actually changed
+    if (changed) {
+        nvs_config_set_dns_table(saved);
+    }
+    return true;
+}
+
+void dns_cache_init(void) {
+    dns_saved_t saved[DNS_SAVED_MAX];
+    if (!nvs_config_get_dns_table(saved)) return;
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (!saved[i].name[0]) continue;
+        saved[i].name[sizeof(saved[i].name) - 1] = '\0';
+        portENTER_CRITICAL(&cache_lock);
+        store_entry(saved[i].name, saved[i].ip, 0);
+        portEXIT_CRITICAL(&cache_lock);
+        ESP_LOGI(TAG, "Restored cached address for %s", saved[i].name);
+    }
+}
+
+bool dns_cache_resolve(const char *name, uint32_t *ip) {
+    portENTER_CRITICAL(&cache_lock);
+    dns_entry_t *entry = find_entry(name);
+    if (entry) {
+        *ip = entry->ip;
+        entry->last_used = ++use_counter;
+    }
+    portEXIT_CRITICAL(&cache_lock);
+
+    return entry ? true : lookup(name, ip);
+}
+
+void dns_cache_refresh(const char *name) {
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&cache_lock);
+    dns_entry_t *entry = find_entry(name);
+    bool due = !entry || entry->expires_us - now < (int64_t)DNS_CACHE_REFRESH_AHEAD_SEC * 1000000;
+    portEXIT_CRITICAL(&cache_lock);
+
+    if (due) {
+        uint32_t ip;
+        lookup(name, &ip);
+    }
+}
+
+void dns_cache_expire(const char *name) {
+    portENTER_CRITICAL(&cache_lock);
+    dns_entry_t *entry = find_entry(name);
+    if (entry) entry->expires_us = 0;
+    portEXIT_CRITICAL(&cache_lock);
+}
@@ -0,0 +1,26 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Small IPv4 hostname cache so time syncs never wait on DNS. Entries are
+// served even after they expire (stale-while-revalidate) and the whole
+// table is kept in NVS so the first sync after boot can skip DNS too.
+
+// Restore the persisted entries (call after nvs_config_init)
+void dns_cache_init(void);
+
+// Resolve name to an IPv4 address (network byte order). Returns a cached
+// address of any age without blocking; only a cache miss does a DNS lookup.
+bool dns_cache_resolve(const char *name, uint32_t *ip);
+
+// Re-resolve name if its entry is stale or close to expiry. Blocking; call
+// after the time-critical work is done. A failed lookup keeps the old address.
+void dns_cache_refresh(const char *name);
+
+// Mark an address that stopped answering as stale so the next refresh
+// re-resolves it (the old address is still served if DNS is down)
+void dns_cache_expire(const char *name);
+
+#endif // DNS_CACHE_H
@@ -0,0 +1,168 @@
+#include "gesture.h"
+#include "config.h"
+#include "app_event.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+
+#define GESTURE_QUEUE_LEN   8
+
+static gesture_t queue[GESTURE_QUEUE_LEN];
+static int queue_head = 0;
+static int queue_count = 0;
+
+// Current press
+static bool down = false;
+static bool dragging = false;
+static bool long_pressed = false;
+static int16_t start_x, start_y;
+static int64_t start_us;
+static int16_t last_x, last_y;
+static int64_t last_us;
+static int32_t vel_x, vel_y;
+
+static void push(const gesture_t *g) {
+    // Merge into a drag still waiting in the queue so a slow consumer sees
+    // one jump to the latest position instead of a backlog
+    if (g->type == GESTURE_DRAG && queue_count > 0) {
+        gesture_t *tail = &queue[(queue_head + queue_count - 1) % GESTURE_QUEUE_LEN];
+        if (tail->type == GESTURE_DRAG) {
+            tail->x = g->x;
+            tail->y = g->y;
+            tail->dx += g->dx;
+            tail->dy += g->dy;
+            tail->vx = g->vx;
+            tail->vy = g->vy;
+            return;
+        }
+    }
+
+    if (queue_count == GESTURE_QUEUE_LEN) {
+        // Full: drop the oldest
+        queue_head = (queue_head + 1) % GESTURE_QUEUE_LEN;
+        queue_count--;
+    }
+    queue[(queue_head + queue_count) % GESTURE_QUEUE_LEN] = *g;
+    queue_count++;
+}
+
+static void push_at(gesture_type_t type, int16_t x, int16_t y) {
+    gesture_t g = { .type = type, .x = x, .y = y };
+    push(&g);
+}
+
+// Smoothed finger velocity from consecutive samples
+static void track_velocity(int16_t x, int16_t y, int64_t time_us) {
+    int64_t dt = time_us - last_us;
+    if (dt < 1000) dt = 1000;
+    int32_t inst_x = (int32_t)((int64_t)(x - last_x) * 1000000 / dt);
+    int32_t inst_y = (int32_t)((int64_t)(y - last_y) * 1000000 / dt);
+    vel_x = (vel_x + inst_x) / 2;
+    vel_y = (vel_y + inst_y) / 2;
+}
+
+static void handle_press(const input_event_t *event) {
+    down = true;
+    dragging = false;
+    long_pressed = false;
+    start_x = last_x = event->x;
+    start_y = last_y = event->y;
+    start_us = last_us = event->time_us;
+    vel_x = vel_y = 0;
+}
+
+static void handle_move(const input_event_t *event) {
+    if (!dragging) {
+        if (long_pressed ||
+            (abs(event->x - start_x) < GESTURE_SLOP_PX && abs(event->y - start_y) < GESTURE_SLOP_PX)) {
+            return;
+        }
+        dragging = true;
+        push_at(GESTURE_DRAG_START, start_x, start_y);
+        // The slop distance is part of the drag, so content tracks the finger
+        last_x = start_x;
+        last_y = start_y;
+    }
+
+    track_velocity(event->x, event->y, event->time_us);
+    gesture_t g = {
+        .type = GESTURE_DRAG,
+        .x = event->x,
+        .y = event->y,
+        .dx = event->x - last_x,
+        .dy = event->y - last_y,
+        .vx = vel_x,
+        .vy = vel_y,
+    };
+    push(&g);
+    last_x = event->x;
+    last_y = event->y;
+    last_us = event->time_us;
+}
+
+static void handle_release(const input_event_t *event) {
+    down = false;
+    if (!dragging) {
+        if (!long_pressed) {
+            push_at(GESTURE_TAP, start_x, start_y);
+        }
+        return;
+    }
+
+    push_at(GESTURE_DRAG_END, last_x, last_y);
+
+    // A finger that stopped before lifting should not throw the content
+    if (event->time_us - last_us > (int64_t)GESTURE_FLING_IDLE_MS * 1000) return;
+    if (abs(vel_x) < GESTURE_FLING_MIN_PX_S && abs(vel_y) < GESTURE_FLING_MIN_PX_S) return;
+
+    gesture_t g = {
+        .type = GESTURE_FLING,
+        .x = last_x,
+        .y = last_y,
+        .vx = vel_x,
+        .vy = vel_y,
+    };
+    push(&g);
+}
+
+void gesture_feed(const input_event_t *event) {
+    switch (event->type) {
+        case INPUT_TOUCH_PRESS:
+            handle_press(event);
+            break;
+        case INPUT_TOUCH_MOVE:
+            if (down) handle_move(event);
+            break;
+        case INPUT_TOUCH_RELEASE:
+            if (down) handle_release(event);
+            break;
+        default:
+            break;
+    }
+}
+
+bool gesture_get(gesture_t *gesture) {
+    // A still finger produces no events, so the long-press timeout is checked
+    // here, with a wake-up to come back when it is due
+    if (down && !dragging && !long_pressed) {
+        int64_t held_ms = (esp_timer_get_time() - start_us) / 1000;
+        if (held_ms >= GESTURE_LONG_PRESS_MS) {
+            long_pressed = true;
+            push_at(GESTURE_LONG_PRESS, start_x, start_y);
+        } else {
+            app_event_wake_after(GESTURE_LONG_PRESS_MS - held_ms);
+        }
+    }
+
+    if (queue_count == 0) return false;
+    *gesture = queue[queue_head];
+    queue_head = (queue_head + 1) % GESTURE_QUEUE_LEN;
+    queue_count--;
+    return true;
+}
+
+void gesture_reset(void) {
+    queue_head = 0;
+    queue_count = 0;
+    down = false;
+    dragging = false;
+}
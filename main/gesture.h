@@ -0,0 +1,40 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "input.h"
+
+// Tap, long-press, drag and fling recognition on top of the input event
+// stream. The main loop feeds every input event; screens that want gestures
+// pull them with gesture_get(). Runs entirely on the UI task.
+
+typedef enum {
+    GESTURE_TAP,            // Press and release without moving past the slop
+    GESTURE_LONG_PRESS,     // Held still for GESTURE_LONG_PRESS_MS (no tap follows)
+    GESTURE_DRAG_START,     // Finger moved past the slop; x/y is the press point
+    GESTURE_DRAG,           // dx/dy since the previous drag gesture
+    GESTURE_DRAG_END,       // Released after dragging
+    GESTURE_FLING,          // Released while moving fast; vx/vy in px/s
+} gesture_type_t;
+
+typedef struct {
+    gesture_type_t type;
+    int16_t x;              // Press point for tap/long-press/drag start, else current
+    int16_t y;
+    int16_t dx;
+    int16_t dy;
+    int32_t vx;             // Finger velocity, px/s
+    int32_t vy;
+} gesture_t;
+
+// Feed one input event (button events are ignored)
+void gesture_feed(const input_event_t *event);
+
+// Next recognized gesture; consecutive drags are merged. Returns false if none.
+bool gesture_get(gesture_t *gesture);
+
+// Drop pending gestures and forget the current press (call on screen entry)
+void gesture_reset(void);
+
+#endif // GESTURE_H
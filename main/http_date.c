@@ -0,0 +1,136 @@
+#include "http_date.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#ifdef ESP_PLATFORM
+#include "lwip/sockets.h"
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static int64_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + doe - 719468;
+}
+
+bool http_date_parse(const char *s, time_t *out) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char mon[4];
+    int day, year, hour, min, sec;
+
+    if (sscanf(s, "%*3s, %d %3s %d %d:%d:%d GMT", &day, mon, &year, &hour, &min, &sec) != 6) {
+        return false;
+    }
+
+    const char *p = strstr(months, mon);
+    if (!p || (p - months) % 3 != 0) return false;
+    int month = (p - months) / 3 + 1;
+
+    if (day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60 || year < 2025) {
+        return false;
+    }
+
+    *out = (time_t)(days_from_civil(year, month, day) * 86400 + hour * 3600 + min * 60 + sec);
+    return true;
+}
+
+const char *http_find_header(const char *response, const char *name) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(response, "\r\n"); line; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, name, name_len) == 0 && line[2 + name_len] == ':') {
+            const char *value = line + 3 + name_len;
+            while (*value == ' ') value++;
+            return value;
+        }
+    }
+    return NULL;
+}
+
+bool http_date_estimate(const char *response, int64_t t1, int64_t t4, int64_t *utc_us, uint32_t *err_ms) {
+    const char *date = http_find_header(response, "Date");
+    time_t date_sec;
+    if (!date || !http_date_parse(date, &date_sec)) {
+        return false;
+    }
+
+    int64_t rtt_us = t4 - t1;
+    // Date is truncated to the second, so its midpoint is the best guess
+    *utc_us = (int64_t)date_sec * 1000000 + 500000 + rtt_us / 2;
+    *err_ms = 500 + (uint32_t)(rtt_us / 2000);
+    return true;
+}
+
+http_date_result_t http_date_fetch(const char *host_port, const http_date_hooks_t *hooks,
+                                   int64_t *utc_us, int64_t *local_us, uint32_t *err_ms) {
+    char host[HTTP_DATE_HOST_MAX];
+    strncpy(host, host_port, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+
+    int port = 80;
+    char *colon = strchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+        if (port <= 0 || port > 65535) return HTTP_DATE_BAD_HOST;
+    }
+
+    uint32_t ip;
+    if (!hooks->resolve(host, &ip)) {
+        return HTTP_DATE_NO_ADDRESS;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        return HTTP_DATE_NO_SOCKET;
+    }
+
+    struct timeval timeout = {
+        .tv_sec = hooks->timeout_ms / 1000,
+        .tv_usec = (hooks->timeout_ms % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = ip,
+    };
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return HTTP_DATE_NO_CONNECT;
+    }
+
+    char buf[HTTP_DATE_RESPONSE_MAX + 1];
+    int len = 0;
+    int req_len = snprintf(buf, sizeof(buf),
+                           "HEAD / HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", host);
+
+    // Time only the request/response, not the TCP handshake
+    int64_t t1 = hooks->now_us(), t4 = 0;
+    if (send(sock, buf, req_len, 0) == req_len) {
+        while (len < HTTP_DATE_RESPONSE_MAX) {
+            int n = recv(sock, buf + len, HTTP_DATE_RESPONSE_MAX - len, 0);
+            if (n <= 0) break;
+            if (len == 0) t4 = hooks->now_us();
+            len += n;
+            buf[len] = '\0';
+            if (strstr(buf, "\r\n\r\n")) break;
+        }
+    }
+    close(sock);
+
+    if (len == 0) return HTTP_DATE_NO_RESPONSE;
+    if (!http_date_estimate(buf, t1, t4, utc_us, err_ms)) return HTTP_DATE_NO_DATE;
+    *local_us = t4;
+    return HTTP_DATE_OK;
+}
@@ -0,0 +1,52 @@
+#ifndef HTTP_DATE_H
+#define HTTP_DATE_H
+
+// HTTP Date header parsing, time estimate and the HEAD request that fetches
+// it (plain C over BSD sockets, no ESP-IDF dependencies)
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Parse an RFC 7231 IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT".
+// Dates before 2025 are rejected as a misconfigured server.
+bool http_date_parse(const char *s, time_t *out);
+
+// Find a header value (case-insensitive name) in a NUL-terminated response.
+// Returns a pointer to the value inside response, or NULL.
+const char *http_find_header(const char *response, const char *name);
+
+// Estimate UTC (us) at local time t4 from a response whose request was sent
+// at t1 and whose first byte arrived at t4, with its error bound (ms).
+// Returns false if the response has no usable Date header.
+bool http_date_estimate(const char *response, int64_t t1, int64_t t4, int64_t *utc_us, uint32_t *err_ms);
+
+#define HTTP_DATE_HOST_MAX      64      // "host" or "host:port"
+#define HTTP_DATE_RESPONSE_MAX  768     // Headers past this are not needed
+
+typedef enum {
+    HTTP_DATE_OK,
+    HTTP_DATE_BAD_HOST,         // Port out of range
+    HTTP_DATE_NO_ADDRESS,       // Name did not resolve
+    HTTP_DATE_NO_SOCKET,
+    HTTP_DATE_NO_CONNECT,
+    HTTP_DATE_NO_RESPONSE,      // Send failed, or nothing came back in time
+    HTTP_DATE_NO_DATE,          // Response without a usable Date header
+} http_date_result_t;
+
+// What the request needs from the platform
+typedef struct {
+    // Resolve a host name to an IPv4 address (network byte order)
+    bool (*resolve)(const char *host, uint32_t *ip);
+    // Monotonic clock in us; request and response are timed with it
+    int64_t (*now_us)(void);
+    uint32_t timeout_ms;        // Per socket operation
+} http_date_hooks_t;
+
+// Send one HEAD request to host_port (port 80 by default) and estimate UTC
+// from the Date header of the response. On success *utc_us is the estimate
+// at monotonic time *local_us, when the response arrived.
+http_date_result_t http_date_fetch(const char *host_port, const http_date_hooks_t *hooks,
+                                   int64_t *utc_us, int64_t *local_us, uint32_t *err_ms);
+
+#endif // HTTP_DATE_H
@@ -0,0 +1,108 @@
+#include "http_time.h"
+#include "http_date.h"
+#include "config.h"
+#include "dns_cache.h"
+#include "timekeep.h"
+#include "app_event.h"
+#include "wifi.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <sys/time.h>
+
+static const char *TAG = "http_time";
+
+#define HTTP_TIME_TASK_STACK    4096
+#define HTTP_TIME_TASK_PRIORITY 4
+
+static char host_setting[MAX_HTTP_TIME_HOST_LEN] = "";
+static TaskHandle_t http_task_handle = NULL;
+
+_Static_assert(MAX_HTTP_TIME_HOST_LEN <= HTTP_DATE_HOST_MAX, "HTTP time host longer than a fetch accepts");
+
+static const http_date_hooks_t fetch_hooks = {
+    .resolve = dns_cache_resolve,
+    .now_us = esp_timer_get_time,
+    .timeout_ms = HTTP_TIME_TIMEOUT_MS,
+};
+
+// One HEAD request. On success returns the estimated UTC (us) at esp_timer
+// time *local_us, when the response arrived, and the error bound (ms).
+static bool fetch_date(const char *host_port, int64_t *utc_us, int64_t *local_us, uint32_t *err_ms) {
+    http_date_result_t result = http_date_fetch(host_port, &fetch_hooks, utc_us, local_us, err_ms);
+    switch (result) {
+        case HTTP_DATE_OK:
+            return true;
+        case HTTP_DATE_NO_SOCKET:
+            ESP_LOGE(TAG, "Failed to create socket");
+            break;
+        case HTTP_DATE_NO_CONNECT:
+            ESP_LOGW(TAG, "Could not connect to %s", host_port);
+            break;
+        case HTTP_DATE_NO_DATE:
+            ESP_LOGW(TAG, "No usable Date header from %s", host_port);
+            break;
+        default:
+            break;
+    }
+    return false;
+}
+
+static void http_time_task(void *arg) {
+    while (!wifi_time_is_synced()) {
+        if (!host_setting[0] || !wifi_is_connected()) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+
+        int64_t utc_us, local_us;
+        uint32_t err_ms;
+        wifi_power_hold();
+        bool fetched = fetch_date(host_setting, &utc_us, &local_us, &err_ms);
+        wifi_power_release();
+        if (!fetched) {
+            vTaskDelay(pdMS_TO_TICKS(HTTP_TIME_RETRY_MIN_SEC * 1000));
+            continue;
+        }
+
+        // NTP may have won the race meanwhile; never replace a better estimate
+        uint32_t current_err = timekeep_get_uncertainty_ms();
+        if (!wifi_time_is_synced() && err_ms < current_err) {
+            // Carried forward on the monotonic clock; wall time is only written
+            int64_t now_us = utc_us + (esp_timer_get_time() - local_us);
+            struct timeval tv = {
+                .tv_sec = now_us / 1000000,
+                .tv_usec = now_us % 1000000,
+            };
+            settimeofday(&tv, NULL);
+            timekeep_on_coarse_sync(&tv, err_ms);
+            app_event_post(APP_EVENT_SYNC);
+            ESP_LOGI(TAG, "Time set from HTTP Date header (+/-%lu ms)", (unsigned long)err_ms);
+        }
+
+        // Keep the coarse time fresh until NTP gets through
+        vTaskDelay(pdMS_TO_TICKS(HTTP_TIME_REFRESH_SEC * 1000));
+    }
+
+    ESP_LOGI(TAG, "NTP synced, HTTP time fallback done");
+    http_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+void http_time_start(void) {
+    if (!http_task_handle && !wifi_time_is_synced()) {
+        xTaskCreate(http_time_task, "http_time", HTTP_TIME_TASK_STACK, NULL,
+                    HTTP_TIME_TASK_PRIORITY, &http_task_handle);
+    }
+}
+
+void http_time_set_host(const char *host) {
+    strncpy(host_setting, host, sizeof(host_setting) - 1);
+    host_setting[sizeof(host_setting) - 1] = '\0';
+}
+
+const char *http_time_get_host(void) {
+    return host_setting;
+}
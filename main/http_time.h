@@ -0,0 +1,19 @@
+#ifndef HTTP_TIME_H
+#define HTTP_TIME_H
+
+#include <stdbool.h>
+
+#define MAX_HTTP_TIME_HOST_LEN 64
+
+// Fallback time source for networks that block NTP: sends an HTTP HEAD
+// request to a local host and sets the clock from the Date header, compensated
+// for half the round trip. Runs only until NTP syncs, which then takes over.
+
+// Start the fallback task (does nothing until a host is set and WiFi is up)
+void http_time_start(void);
+
+// Host to query, as "host" or "host:port" (empty string disables)
+void http_time_set_host(const char *host);
+const char *http_time_get_host(void);
+
+#endif // HTTP_TIME_H
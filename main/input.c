@@ -0,0 +1,208 @@
+#include "input.h"
+#include "app_event.h"
+#include "config.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+
+static const char *TAG = "input";
+
+#define INPUT_TASK_STACK    3072
+#define INPUT_TASK_PRIORITY 6       // Above the UI so samples keep their timing
+
+// Notification bits from the ISRs
+#define NOTIFY_TOUCH        (1 << 0)
+#define NOTIFY_BUTTON       (1 << 1)
+
+static TaskHandle_t input_task_handle = NULL;
+
+static volatile int64_t touch_edge_us = 0;
+static volatile int64_t button_edge_us = 0;
+static volatile bool touch_down = false;
+static volatile bool button_down = false;
+
+// PENIRQ is masked from its first edge until the panel reads untouched; every
+// sampling burst ends with a command that re-arms PENIRQ, which would fire
+// again under the finger. Input task only.
+static bool touch_masked = false;
+
+static touch_point_t last_touch = {0};
+static portMUX_TYPE touch_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Recent touch-downs, so a poller sees each one even if several land
+// between polls. Indexed by sequence number; guarded by touch_lock.
+static struct {
+    touch_point_t point;
+    int64_t time_us;
+} presses[INPUT_PRESS_HISTORY];
+static uint32_t press_count = 0;
+
+static void IRAM_ATTR touch_isr(void *arg) {
+    touch_edge_us = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(input_task_handle, NOTIFY_TOUCH, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void IRAM_ATTR button_isr(void *arg) {
+    button_edge_us = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(input_task_handle, NOTIFY_BUTTON, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void post(input_event_type_t type, int16_t x, int16_t y, int64_t time_us) {
+    input_event_t event = {
+        .type = type,
+        .x = x,
+        .y = y,
+        .time_us = time_us,
+    };
+    app_event_post_input(&event);
+}
+
+// Read the panel once and turn the change into an event
+static void sample_touch(void) {
+    touch_point_t point;
+    bool pressed = touch_read(&point);
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&touch_lock);
+    touch_point_t prev = last_touch;
+    if (pressed) {
+        last_touch = point;
+    } else {
+        last_touch.pressed = false;
+    }
+    portEXIT_CRITICAL(&touch_lock);
+
+    if (pressed && !touch_down) {
+        touch_down = true;
+        portENTER_CRITICAL(&touch_lock);
+        press_count++;
+        presses[press_count % INPUT_PRESS_HISTORY].point = point;
+        presses[press_count % INPUT_PRESS_HISTORY].time_us = now;
+        portEXIT_CRITICAL(&touch_lock);
+        post(INPUT_TOUCH_PRESS, point.x, point.y, touch_edge_us ? touch_edge_us : now);
+    } else if (pressed) {
+        if (abs(point.x - prev.x) >= INPUT_MOVE_MIN_PX || abs(point.y - prev.y) >= INPUT_MOVE_MIN_PX) {
+            post(INPUT_TOUCH_MOVE, point.x, point.y, now);
+        }
+    } else if (touch_down) {
+        touch_down = false;
+        post(INPUT_TOUCH_RELEASE, prev.x, prev.y, now);
+    }
+}
+
+static void input_task(void *arg) {
+    int64_t button_check_us = 0;    // Debounced button read due, 0 if none
+    int64_t touch_sample_us = 0;    // Next sample of a tracked touch
+
+    while (1) {
+        // Sleep until an interrupt unless a touch is being tracked or a
+        // button edge is settling
+        TickType_t wait = portMAX_DELAY;
+        if (touch_masked) {
+            int64_t remaining_ms = (touch_sample_us - esp_timer_get_time()) / 1000;
+            wait = remaining_ms > 0 ? pdMS_TO_TICKS(remaining_ms) : 0;
+        }
+        if (button_check_us) {
+            int64_t remaining_ms = (button_check_us - esp_timer_get_time()) / 1000;
+            TickType_t button_wait = remaining_ms > 0 ? pdMS_TO_TICKS(remaining_ms) : 0;
+            if (button_wait < wait) wait = button_wait;
+        }
+
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+
+        if (bits & NOTIFY_BUTTON) {
+            button_check_us = button_edge_us + INPUT_BUTTON_DEBOUNCE_MS * 1000;
+        }
+        if (button_check_us && esp_timer_get_time() >= button_check_us) {
+            button_check_us = 0;
+            bool down = gpio_get_level(BOOT_BUTTON_GPIO) == 0;
+            if (down != button_down) {
+                button_down = down;
+                post(down ? INPUT_BUTTON_PRESS : INPUT_BUTTON_RELEASE, 0, 0, button_edge_us);
+            }
+        }
+
+        // PENIRQ starts tracking; after that only the sample timer paces reads,
+        // so a stray edge from a sampling burst cannot trigger another burst
+        bool sample_due = touch_masked ? esp_timer_get_time() >= touch_sample_us
+                                       : (bits & NOTIFY_TOUCH) != 0;
+        if (sample_due) {
+            if (!touch_masked) {
+                touch_masked = true;
+                touch_irq_enable(false);
+            }
+            sample_touch();
+            touch_sample_us = esp_timer_get_time() + INPUT_SAMPLE_MS * 1000;
+
+            // A contact too light or unstable to register as a press keeps
+            // PENIRQ low too, so keep polling until the finger is gone
+            if (!touch_down && !touch_is_pressed()) {
+                touch_masked = false;
+                touch_irq_enable(true);
+            }
+        }
+    }
+}
+
+void input_init(void) {
+    xTaskCreate(input_task, "input", INPUT_TASK_STACK, NULL, INPUT_TASK_PRIORITY, &input_task_handle);
+
+    // BOOT button (active low), both edges
+    gpio_config_t boot_btn_cfg = {
+        .pin_bit_mask = (1ULL << BOOT_BUTTON_GPIO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    gpio_config(&boot_btn_cfg);
+    button_down = gpio_get_level(BOOT_BUTTON_GPIO) == 0;  // Held since reset: no edge to catch
+
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    gpio_isr_handler_add(BOOT_BUTTON_GPIO, button_isr, NULL);
+    touch_set_irq_handler(touch_isr, NULL);
+
+    ESP_LOGI(TAG, "Input events initialized");
+}
+
+bool input_get_touch(touch_point_t *point) {
+    portENTER_CRITICAL(&touch_lock);
+    *point = last_touch;
+    portEXIT_CRITICAL(&touch_lock);
+    return point->pressed;
+}
+
+bool input_touch_is_down(void) {
+    return touch_down;
+}
+
+bool input_button_is_down(void) {
+    return button_down;
+}
+
+uint32_t input_press_count(void) {
+    portENTER_CRITICAL(&touch_lock);
+    uint32_t count = press_count;
+    portEXIT_CRITICAL(&touch_lock);
+    return count;
+}
+
+bool input_get_press(uint32_t seq, touch_point_t *point, int64_t *time_us) {
+    bool found = false;
+    portENTER_CRITICAL(&touch_lock);
+    if (seq != 0 && press_count - seq < INPUT_PRESS_HISTORY) {
+        *point = presses[seq % INPUT_PRESS_HISTORY].point;
+        *time_us = presses[seq % INPUT_PRESS_HISTORY].time_us;
+        found = true;
+    }
+    portEXIT_CRITICAL(&touch_lock);
+    return found;
+}
@@ -0,0 +1,45 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "touch.h"
+
+// Touch and BOOT button events. GPIO interrupts wake an input task, which
+// samples the touch controller while the panel is pressed and posts
+// timestamped events to the app event queue.
+
+typedef enum {
+    INPUT_TOUCH_PRESS,
+    INPUT_TOUCH_MOVE,
+    INPUT_TOUCH_RELEASE,
+    INPUT_BUTTON_PRESS,
+    INPUT_BUTTON_RELEASE,
+} input_event_type_t;
+
+typedef struct {
+    input_event_type_t type;
+    int16_t x;                // Screen coordinates (touch events only)
+    int16_t y;
+    int64_t time_us;          // esp_timer time of the edge or sample
+} input_event_t;
+
+// Install the ISRs and start the input task (call after touch_init and
+// app_event_init)
+void input_init(void);
+
+// Latest touch sample; returns true while the panel is pressed
+bool input_get_touch(touch_point_t *point);
+
+// Touch-downs since boot. Each has a sequence number (1, 2, ...); the last
+// INPUT_PRESS_HISTORY can be fetched with input_get_press(), which returns
+// false once one has been overwritten.
+#define INPUT_PRESS_HISTORY 4
+uint32_t input_press_count(void);
+bool input_get_press(uint32_t seq, touch_point_t *point, int64_t *time_us);
+
+bool input_touch_is_down(void);
+bool input_button_is_down(void);
+
+#endif // INPUT_H
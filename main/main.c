@@ -10,16 +10,26 @@
 #include "display.h"
 #include "led.h"
 #include "touch.h"
+#include "input.h"
+#include "app_event.h"
+#include "gesture.h"
 #include "wifi.h"
 #include "nvs_config.h"
+#include "wifi_roam.h"
+#include "timekeep.h"
+#include "dns_cache.h"
+#include "ntp_server.h"
+#include "peer_sync.h"
+#include "http_time.h"
 #include "ui_common.h"
-#include "driver/gpio.h"
 #include "ui_clock.h"
 #include "ui_wifi_setup.h"
 #include "ui_timezone.h"
 #include "ui_settings.h"
 #include "ui_about.h"
+#include "ui_touch_cal.h"
 #include "ui_ntp.h"
+#include "ui_ntp_graph.h"
 
 static const char *TAG = "main";
 
@@ -33,15 +43,19 @@ typedef enum {
     APP_STATE_TIMEZONE,
     APP_STATE_ABOUT,
     APP_STATE_NTP,
+    APP_STATE_NTP_GRAPH,
+    APP_STATE_TOUCH_CAL,
 } app_state_t;
 
 static app_state_t app_state = APP_STATE_INIT;
 static bool wifi_setup_from_settings = false;
 static bool initial_setup = false;
-static char stored_ssid[MAX_SSID_LEN];
-static char stored_password[MAX_PASSWORD_LEN];
+static wifi_cred_t stored_networks[WIFI_CRED_MAX];   // Best candidate first
+static int stored_network_count = 0;
+static int stored_network_next = 0;
 static char stored_tz[MAX_TIMEZONE_LEN];
 static bool ntp_started = false;
+static wifi_connect_state_t connect_drawn_state = WIFI_CONNECT_IDLE;
 
 static void show_splash(void) {
     display_fill(COLOR_BLACK);
@@ -51,15 +65,52 @@ static void show_splash(void) {
     vTaskDelay(pdMS_TO_TICKS(1500));
 }
 
-static void try_connect_stored_credentials(void) {
+static void run_boot_calibration(void) {
+    ESP_LOGI(TAG, "BOOT held at startup, calibrating touch");
+    ui_draw_centered_string(170, "Release BOOT to calibrate", COLOR_WHITE, COLOR_BLACK, false);
+    app_event_t event;
+    while (input_button_is_down()) {
+        app_event_wait(&event, portMAX_DELAY);
+    }
+
+    ui_touch_cal_init();
+    while (ui_touch_cal_update() == TOUCH_CAL_RESULT_NONE) {
+        app_event_wait(&event, portMAX_DELAY);
+    }
+}
+
+// Try the next known network; returns false when all have been tried
+static bool try_connect_stored_credentials(void) {
+    if (stored_network_next >= stored_network_count) {
+        return false;
+    }
+    const wifi_cred_t *net = &stored_networks[stored_network_next++];
     app_state = APP_STATE_CONNECTING;
 
     display_fill(COLOR_BLACK);
     ui_draw_centered_string(100, "Connecting to", COLOR_WHITE, COLOR_BLACK, false);
-    ui_draw_centered_string(130, stored_ssid, COLOR_CYAN, COLOR_BLACK, false);
+    ui_draw_centered_string(130, net->ssid, COLOR_CYAN, COLOR_BLACK, false);
+    ui_draw_centered_string(200, "Tap to cancel", COLOR_DARKGRAY, COLOR_BLACK, false);
 
     wifi_init();
-    if (wifi_connect(stored_ssid, stored_password)) {
+    connect_drawn_state = WIFI_CONNECT_IDLE;
+    return wifi_connect_async(net->ssid, net->password, NULL, NULL);
+}
+
+// Boot-time connect with stored credentials; the screen stays responsive
+static void update_connecting(void) {
+    touch_point_t touch;
+    if (ui_read_touch(&touch)) {
+        wifi_connect_cancel();
+    }
+
+    wifi_connect_state_t state = wifi_get_connect_state();
+    if (state != connect_drawn_state) {
+        ui_draw_connect_progress(160, state);
+        connect_drawn_state = state;
+    }
+
+    if (state == WIFI_CONNECT_DONE) {
         ESP_LOGI(TAG, "Connected with stored credentials");
         app_state = APP_STATE_CLOCK;
         ui_clock_init();
@@ -68,10 +119,187 @@ static void try_connect_stored_credentials(void) {
         // Start NTP
         wifi_start_ntp();
         ntp_started = true;
-    } else {
+    } else if (state == WIFI_CONNECT_FAILED && try_connect_stored_credentials()) {
+        ESP_LOGW(TAG, "Failed to connect, trying the next known network");
+    } else if (state == WIFI_CONNECT_FAILED || state == WIFI_CONNECT_CANCELLED) {
         ESP_LOGW(TAG, "Failed to connect with stored credentials");
         app_state = APP_STATE_WIFI_SETUP;
         ui_wifi_setup_init(false);
+        ui_wait_for_touch_release();
+    }
+}
+
+// Let the current screen react to one event
+static void handle_event(const app_event_t *event) {
+    switch (app_state) {
+        case APP_STATE_INIT:
+            // Should not reach here
+            break;
+
+        case APP_STATE_CONNECTING:
+            update_connecting();
+            break;
+
+        case APP_STATE_WIFI_SETUP: {
+            wifi_setup_result_t result = ui_wifi_setup_update();
+            if (result == WIFI_SETUP_CONNECTED) {
+                // Save credentials
+                char ssid[33], password[64];
+                ui_wifi_setup_get_credentials(ssid, password);
+                wifi_roam_remember(ssid, password);
+
+                // Start NTP if not already started
+                if (!ntp_started) {
+                    wifi_start_ntp();
+                    ntp_started = true;
+                }
+
+                if (initial_setup) {
+                    // First boot: prompt for timezone before showing clock
+                    app_state = APP_STATE_TIMEZONE;
+                    ui_timezone_init(stored_tz, false);
+                } else {
+                    // From settings: go straight to clock
+                    app_state = APP_STATE_CLOCK;
+                    ui_clock_init();
+                    ui_clock_redraw();
+                }
+                wifi_setup_from_settings = false;
+            } else if (result == WIFI_SETUP_CANCELLED) {
+                if (wifi_setup_from_settings) {
+                    // Return to settings
+                    app_state = APP_STATE_SETTINGS;
+                    wifi_setup_from_settings = false;
+                    ui_settings_init();
+                    ui_wait_for_touch_release();
+                }
+                // If not from settings, stay in WiFi setup (no stored credentials)
+            }
+            break;
+        }
+
+        case APP_STATE_CLOCK:
+            if (event->type != APP_EVENT_INPUT) {
+                // Ticks land just past each second boundary; sync and WiFi
+                // changes refresh the status lines
+                ui_clock_update();
+            } else if (ui_clock_check_touch(&event->input) == CLOCK_TOUCH_SETTINGS) {
+                app_state = APP_STATE_SETTINGS;
+                ui_settings_init();
+                // Wait for BOOT button release
+                app_event_t next;
+                while (input_button_is_down()) {
+                    app_event_wait(&next, portMAX_DELAY);
+                }
+            }
+            break;
+
+        case APP_STATE_SETTINGS: {
+            settings_result_t result = ui_settings_update();
+            if (result == SETTINGS_RESULT_TIMEZONE) {
+                app_state = APP_STATE_TIMEZONE;
+                ui_timezone_init(stored_tz, true);
+                ui_wait_for_touch_release();
+            } else if (result == SETTINGS_RESULT_WIFI) {
+                app_state = APP_STATE_WIFI_SETUP;
+                wifi_setup_from_settings = true;
+                ui_wifi_setup_init(true);
+                ui_wait_for_touch_release();
+            } else if (result == SETTINGS_RESULT_NTP) {
+                app_state = APP_STATE_NTP;
+                ui_ntp_init();
+                ui_wait_for_touch_release();
+            } else if (result == SETTINGS_RESULT_ABOUT) {
+                app_state = APP_STATE_ABOUT;
+                ui_about_init();
+                ui_wait_for_touch_release();
+            } else if (result == SETTINGS_RESULT_DONE) {
+                app_state = APP_STATE_CLOCK;
+                ui_clock_init();
+                ui_clock_redraw();
+                ui_wait_for_touch_release();
+            }
+            break;
+        }
+
+        case APP_STATE_TIMEZONE: {
+            tz_select_result_t result = ui_timezone_update();
+            if (result == TZ_SELECT_DONE) {
+                // Save and apply new timezone
+                const char *tz = ui_timezone_get_selected();
+                strncpy(stored_tz, tz, sizeof(stored_tz) - 1);
+                stored_tz[sizeof(stored_tz) - 1] = '\0';
+                nvs_config_set_timezone(tz);
+                wifi_set_timezone(tz);
+                ESP_LOGI(TAG, "Timezone set to: %s", ui_timezone_get_name());
+            }
+            if (result == TZ_SELECT_DONE || result == TZ_SELECT_CANCELLED) {
+                if (initial_setup) {
+                    // First boot: go to clock
+                    initial_setup = false;
+                    app_state = APP_STATE_CLOCK;
+                    ui_clock_init();
+                    ui_clock_redraw();
+                } else {
+                    // From settings: return to settings
+                    app_state = APP_STATE_SETTINGS;
+                    ui_settings_init();
+                }
+            }
+            break;
+        }
+
+        case APP_STATE_ABOUT: {
+            about_result_t result = ui_about_update();
+            if (result == ABOUT_RESULT_BACK) {
+                app_state = APP_STATE_SETTINGS;
+                ui_settings_init();
+                ui_wait_for_touch_release();
+            } else if (result == ABOUT_RESULT_CALIBRATE) {
+                ui_wait_for_touch_release();
+                app_state = APP_STATE_TOUCH_CAL;
+                ui_touch_cal_init();
+            }
+            break;
+        }
+
+        case APP_STATE_TOUCH_CAL: {
+            touch_cal_result_t result = ui_touch_cal_update();
+            if (result != TOUCH_CAL_RESULT_NONE) {
+                app_state = APP_STATE_ABOUT;
+                ui_about_init();
+                ui_wait_for_touch_release();
+            }
+            break;
+        }
+
+        case APP_STATE_NTP: {
+            ntp_result_t result = ui_ntp_update();
+            if (result == NTP_RESULT_BACK) {
+                app_state = APP_STATE_SETTINGS;
+                ui_settings_init();
+                ui_wait_for_touch_release();
+            } else if (result == NTP_RESULT_SYNCED) {
+                app_state = APP_STATE_CLOCK;
+                ui_clock_init();
+                ui_clock_redraw();
+            } else if (result == NTP_RESULT_GRAPH) {
+                app_state = APP_STATE_NTP_GRAPH;
+                ui_ntp_graph_init();
+                ui_wait_for_touch_release();
+            }
+            break;
+        }
+
+        case APP_STATE_NTP_GRAPH: {
+            ntp_graph_result_t result = ui_ntp_graph_update();
+            if (result == NTP_GRAPH_RESULT_BACK) {
+                app_state = APP_STATE_NTP;
+                ui_ntp_init();
+                ui_wait_for_touch_release();
+            }
+            break;
+        }
     }
 }
 
@@ -80,26 +308,27 @@ void app_main(void) {
 
     // Initialize hardware
     nvs_config_init();
+    timekeep_init();  // Restore estimated time so the clock is usable before NTP
+    dns_cache_init();
+    wifi_roam_init();
     display_init();
     touch_init();
+    app_event_init();   // UI event queue and second tick
+    input_init();       // Touch and BOOT button interrupts
     led_init();
 
-    // Configure BOOT button as input with pull-up
-    gpio_config_t boot_btn_cfg = {
-        .pin_bit_mask = (1ULL << BOOT_BUTTON_GPIO),
-        .mode = GPIO_MODE_INPUT,
-        .pull_up_en = GPIO_PULLUP_ENABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    gpio_config(&boot_btn_cfg);
-
     // Load and apply saved brightness (minimum 32)
     uint8_t brightness;
     if (nvs_config_get_brightness(&brightness) && brightness >= BRIGHTNESS_MIN) {
         display_set_backlight(brightness);
     }
 
+    // Load and apply saved touch calibration
+    touch_cal_t touch_cal;
+    if (nvs_config_get_touch_cal(&touch_cal)) {
+        touch_set_calibration(&touch_cal);
+    }
+
     // Load and apply saved rotation
     bool rotated;
     if (nvs_config_get_rotation(&rotated)) {
@@ -108,6 +337,11 @@ void app_main(void) {
 
     show_splash();
 
+    // BOOT held through the splash: recalibrate before anything needs touch
+    if (input_button_is_down()) {
+        run_boot_calibration();
+    }
+
     // Load timezone (default to UTC)
     if (!nvs_config_get_timezone(stored_tz)) {
         strncpy(stored_tz, "UTC0", sizeof(stored_tz) - 1);
@@ -115,6 +349,12 @@ void app_main(void) {
     }
     wifi_set_timezone(stored_tz);
 
+    // Load WiFi power profile (applied once WiFi starts)
+    uint8_t power_profile;
+    if (nvs_config_get_wifi_power(&power_profile)) {
+        wifi_set_power_profile(power_profile);
+    }
+
     // Load NTP settings
     char custom_ntp[MAX_NTP_SERVER_LEN];
     if (nvs_config_get_custom_ntp_server(custom_ntp)) {
@@ -124,186 +364,55 @@ void app_main(void) {
     if (nvs_config_get_ntp_interval(&ntp_interval)) {
         wifi_set_ntp_interval(ntp_interval);
     }
-
-    // Check for stored WiFi credentials
-    if (nvs_config_get_wifi(stored_ssid, stored_password)) {
-        try_connect_stored_credentials();
+    bool ntp_serve;
+    if (nvs_config_get_ntp_serve(&ntp_serve) && ntp_serve) {
+        ntp_server_start();
+    }
+    char http_host[MAX_NTP_SERVER_LEN];
+    if (nvs_config_get_http_time_host(http_host)) {
+        http_time_set_host(http_host);
+    }
+    http_time_start();
+    bool peer_sync;
+    if (nvs_config_get_peer_sync(&peer_sync) && peer_sync) {
+        peer_sync_start();
+    }
+    wifi_roam_start();
+
+    // Check for stored WiFi credentials, best candidate first
+    stored_network_count = wifi_roam_candidates(stored_networks, WIFI_CRED_MAX);
+    if (stored_network_count > 0) {
+        if (!try_connect_stored_credentials()) {
+            app_state = APP_STATE_WIFI_SETUP;
+            ui_wifi_setup_init(false);
+        }
     } else {
         app_state = APP_STATE_WIFI_SETUP;
         initial_setup = true;
         ui_wifi_setup_init(false);
     }
 
-    // Main loop
+    // Main loop: sleep until something happens, then hand it to the screen
+    ui_request_frame();
     while (1) {
-        switch (app_state) {
-            case APP_STATE_INIT:
-                // Should not reach here
-                break;
-
-            case APP_STATE_WIFI_SETUP: {
-                wifi_setup_result_t result = ui_wifi_setup_update();
-                if (result == WIFI_SETUP_CONNECTED) {
-                    // Save credentials
-                    char ssid[33], password[64];
-                    ui_wifi_setup_get_credentials(ssid, password);
-                    nvs_config_set_wifi(ssid, password);
-
-                    // Start NTP if not already started
-                    if (!ntp_started) {
-                        wifi_start_ntp();
-                        ntp_started = true;
-                    }
-
-                    if (initial_setup) {
-                        // First boot: prompt for timezone before showing clock
-                        app_state = APP_STATE_TIMEZONE;
-                        ui_timezone_init(stored_tz, false);
-                    } else {
-                        // From settings: go straight to clock
-                        app_state = APP_STATE_CLOCK;
-                        ui_clock_init();
-                        ui_clock_redraw();
-                    }
-                    wifi_setup_from_settings = false;
-                } else if (result == WIFI_SETUP_CANCELLED) {
-                    if (wifi_setup_from_settings) {
-                        // Return to settings
-                        app_state = APP_STATE_SETTINGS;
-                        wifi_setup_from_settings = false;
-                        ui_settings_init();
-                        ui_wait_for_touch_release();
-                    }
-                    // If not from settings, stay in WiFi setup (no stored credentials)
-                }
-                break;
-            }
-
-            case APP_STATE_CONNECTING:
-                // Handled in try_connect_stored_credentials()
-                break;
-
-            case APP_STATE_CLOCK: {
-                static int last_sec = -1;
-
-                // Check for touch input first
-                clock_touch_zone_t zone = ui_clock_check_touch();
-                if (zone == CLOCK_TOUCH_SETTINGS) {
-                    app_state = APP_STATE_SETTINGS;
-                    ui_settings_init();
-                    last_sec = -1;  // Reset on return
-                    // Wait for BOOT button release
-                    while (gpio_get_level(BOOT_BUTTON_GPIO) == 0) {
-                        vTaskDelay(pdMS_TO_TICKS(TOUCH_RELEASE_POLL_MS));
-                    }
-                    continue;
-                }
-
-                // Get current time
-                struct timeval tv;
-                gettimeofday(&tv, NULL);
-                struct tm timeinfo;
-                localtime_r(&tv.tv_sec, &timeinfo);
-
-                // Update display when second changes
-                if (timeinfo.tm_sec != last_sec) {
-                    ui_clock_update();
-                    last_sec = timeinfo.tm_sec;
-                }
-
-                // Poll faster near second boundary for responsiveness
-                int ms_in_sec = tv.tv_usec / 1000;
-                if (ms_in_sec > POLL_THRESHOLD_MS) {
-                    vTaskDelay(pdMS_TO_TICKS(POLL_FAST_MS));
-                } else if (ms_in_sec > 900) {
-                    vTaskDelay(pdMS_TO_TICKS(POLL_MID_MS));
-                } else {
-                    vTaskDelay(pdMS_TO_TICKS(POLL_NORMAL_MS));
-                }
+        app_event_t event;
+        app_event_wait(&event, portMAX_DELAY);
+
+        if (event.type == APP_EVENT_INPUT) {
+            gesture_feed(&event.input);
+            // Moves arrive at the sample rate; gestures need every one, but
+            // the screen only needs the latest of a run
+            app_event_t next;
+            if (event.input.type == INPUT_TOUCH_MOVE && app_event_peek(&next) &&
+                next.type == APP_EVENT_INPUT && next.input.type == INPUT_TOUCH_MOVE) {
                 continue;
             }
-
-            case APP_STATE_SETTINGS: {
-                settings_result_t result = ui_settings_update();
-                if (result == SETTINGS_RESULT_TIMEZONE) {
-                    app_state = APP_STATE_TIMEZONE;
-                    ui_timezone_init(stored_tz, true);
-                    ui_wait_for_touch_release();
-                } else if (result == SETTINGS_RESULT_WIFI) {
-                    app_state = APP_STATE_WIFI_SETUP;
-                    wifi_setup_from_settings = true;
-                    ui_wifi_setup_init(true);
-                    ui_wait_for_touch_release();
-                } else if (result == SETTINGS_RESULT_NTP) {
-                    app_state = APP_STATE_NTP;
-                    ui_ntp_init();
-                    ui_wait_for_touch_release();
-                } else if (result == SETTINGS_RESULT_ABOUT) {
-                    app_state = APP_STATE_ABOUT;
-                    ui_about_init();
-                    ui_wait_for_touch_release();
-                } else if (result == SETTINGS_RESULT_DONE) {
-                    app_state = APP_STATE_CLOCK;
-                    ui_clock_init();
-                    ui_clock_redraw();
-                    ui_wait_for_touch_release();
-                }
-                break;
-            }
-
-            case APP_STATE_TIMEZONE: {
-                tz_select_result_t result = ui_timezone_update();
-                if (result == TZ_SELECT_DONE) {
-                    // Save and apply new timezone
-                    const char *tz = ui_timezone_get_selected();
-                    strncpy(stored_tz, tz, sizeof(stored_tz) - 1);
-                    stored_tz[sizeof(stored_tz) - 1] = '\0';
-                    nvs_config_set_timezone(tz);
-                    wifi_set_timezone(tz);
-                    ESP_LOGI(TAG, "Timezone set to: %s", ui_timezone_get_name());
-                }
-                if (result == TZ_SELECT_DONE || result == TZ_SELECT_CANCELLED) {
-                    if (initial_setup) {
-                        // First boot: go to clock
-                        initial_setup = false;
-                        app_state = APP_STATE_CLOCK;
-                        ui_clock_init();
-                        ui_clock_redraw();
-                    } else {
-                        // From settings: return to settings
-                        app_state = APP_STATE_SETTINGS;
-                        ui_settings_init();
-                    }
-                }
-                break;
-            }
-
-            case APP_STATE_ABOUT: {
-                about_result_t result = ui_about_update();
-                if (result == ABOUT_RESULT_BACK) {
-                    app_state = APP_STATE_SETTINGS;
-                    ui_settings_init();
-                    ui_wait_for_touch_release();
-                }
-                break;
-            }
-
-            case APP_STATE_NTP: {
-                ntp_result_t result = ui_ntp_update();
-                if (result == NTP_RESULT_BACK) {
-                    app_state = APP_STATE_SETTINGS;
-                    ui_settings_init();
-                    ui_wait_for_touch_release();
-                } else if (result == NTP_RESULT_SYNCED) {
-                    app_state = APP_STATE_CLOCK;
-                    ui_clock_init();
-                    ui_clock_redraw();
-                }
-                break;
-            }
         }
 
-        // Small delay to prevent tight loop
-        vTaskDelay(pdMS_TO_TICKS(TOUCH_RELEASE_POLL_MS));
+        app_state_t prev_state = app_state;
+        handle_event(&event);
+        if (app_state != prev_state) {
+            ui_request_frame();     // New screen gets its first update promptly
+        }
     }
 }
@@ -0,0 +1,144 @@
+#include "ntp_client.h"
+#include <stdlib.h>
+#ifdef ESP_PLATFORM
+#include "lwip/sockets.h"
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+ntp_reply_t ntp_client_query(const ntp_client_t *client, uint32_t ip, uint16_t port,
+                             ntp_measurement_t *m) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        if (client->on_query) client->on_query(ip, NTP_REPLY_INVALID, NULL);
+        return NTP_REPLY_INVALID;
+    }
+
+    struct timeval timeout = {
+        .tv_sec = client->timeout_ms / 1000,
+        .tv_usec = (client->timeout_ms % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = ip,
+    };
+    ntp_packet_t request = {
+        .version = NTP_VERSION,
+        .mode = NTP_MODE_CLIENT,
+    };
+    ntp_packet_t reply;
+    bool decoded = false;
+    uint8_t buf[NTP_PACKET_SIZE];
+    ntp_reply_t result = NTP_REPLY_INVALID;
+
+    request.xmit_ts = ntp_ts_from_unix_us(client->now_us());
+    ntp_packet_encode(&request, buf);
+
+    if (sendto(sock, buf, sizeof(buf), 0, (const struct sockaddr *)&addr, sizeof(addr)) == sizeof(buf)) {
+        int len = recvfrom(sock, buf, sizeof(buf), 0, NULL, NULL);
+        int64_t t4 = client->now_us();
+
+        decoded = len >= 0 && ntp_packet_decode(buf, (size_t)len, &reply);
+        if (decoded) {
+            result = ntp_check_reply(&request, &reply);
+            if (result == NTP_REPLY_OK) {
+                ntp_compute_offset_delay(ntp_ts_to_unix_us(request.xmit_ts),
+                                         ntp_ts_to_unix_us(reply.recv_ts),
+                                         ntp_ts_to_unix_us(reply.xmit_ts),
+                                         t4, &m->offset_us, &m->delay_us);
+                m->server_ip = ip;
+                m->reply = reply;
+            }
+        }
+    }
+    close(sock);
+
+    if (client->on_query) client->on_query(ip, result, decoded ? &reply : NULL);
+    return result;
+}
+
+ntp_reply_t ntp_client_sample(const ntp_client_t *client, uint32_t ip, uint16_t port, bool synced,
+                              ntp_measurement_t *best) {
+    int burst = synced ? client->burst_samples : 1;
+    ntp_reply_t result = NTP_REPLY_INVALID;
+
+    for (int i = 0; i < burst; i++) {
+        if (i > 0) {
+            client->sleep_ms(client->burst_spacing_ms);
+        }
+
+        ntp_measurement_t sample;
+        ntp_reply_t reply = ntp_client_query(client, ip, port, &sample);
+        if (reply == NTP_REPLY_OK) {
+            if (result != NTP_REPLY_OK || sample.delay_us < best->delay_us) {
+                *best = sample;
+            }
+            result = NTP_REPLY_OK;
+        } else if (reply == NTP_REPLY_KOD_RATE || reply == NTP_REPLY_KOD_DENY) {
+            // Server asked us to back off: stop the burst immediately
+            if (result != NTP_REPLY_OK) result = reply;
+            break;
+        }
+    }
+    return result;
+}
+
+ntp_reply_t ntp_client_sync(const ntp_client_t *client, const ntp_server_addr_t *servers, int count,
+                            bool synced, ntp_measurement_t *best, int *tried) {
+    ntp_reply_t result = NTP_REPLY_INVALID;
+    *tried = -1;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t ip = servers[i].ip;
+        if (servers[i].name && !client->resolve(servers[i].name, &ip)) {
+            result = NTP_REPLY_INVALID;
+            continue;
+        }
+
+        *tried = i;
+        result = ntp_client_sample(client, ip, servers[i].port, synced, best);
+        if (result == NTP_REPLY_OK) break;
+    }
+    return result;
+}
+
+bool ntp_client_apply(const ntp_client_t *client, int64_t offset_us, bool synced) {
+    if (!synced || llabs(offset_us) >= (int64_t)client->step_threshold_us) {
+        client->step(offset_us);
+        return true;
+    }
+    client->slew(offset_us);
+    return false;
+}
+
+void ntp_backoff_init(ntp_backoff_t *backoff, uint32_t min_sec, uint32_t max_sec) {
+    backoff->min_sec = min_sec;
+    backoff->max_sec = max_sec;
+    backoff->retry_sec = min_sec;
+}
+
+uint32_t ntp_backoff_next(ntp_backoff_t *backoff, ntp_reply_t result, uint32_t interval_sec) {
+    if (result == NTP_REPLY_OK) {
+        backoff->retry_sec = backoff->min_sec;
+        return interval_sec;
+    }
+    if (result == NTP_REPLY_KOD_DENY) {
+        // Nothing usable: recheck at the sync interval
+        return interval_sec;
+    }
+
+    if (result == NTP_REPLY_KOD_RATE) {
+        backoff->retry_sec = backoff->max_sec;
+    }
+    if (backoff->retry_sec > interval_sec) backoff->retry_sec = interval_sec;
+    uint32_t wait = backoff->retry_sec;
+    backoff->retry_sec *= 2;
+    if (backoff->retry_sec > backoff->max_sec) backoff->retry_sec = backoff->max_sec;
+    return wait;
+}
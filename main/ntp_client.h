@@ -0,0 +1,83 @@
+#ifndef NTP_CLIENT_H
+#define NTP_CLIENT_H
+
+// SNTP client: request/response exchange, burst sampling, server fallback,
+// clock correction and retry backoff (plain C over BSD sockets, no ESP-IDF
+// dependencies). The clock and the name lookup come in as hooks, so the
+// host tests run the same code against a loopback server.
+
+#include "ntp_proto.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    // Clock being disciplined, in us since the Unix epoch
+    int64_t (*now_us)(void);
+    // Correct that clock by offset_us: at once, or gradually
+    void (*step)(int64_t offset_us);
+    void (*slew)(int64_t offset_us);
+    void (*sleep_ms)(uint32_t ms);
+    // Resolve a server name to an IPv4 address (network byte order)
+    bool (*resolve)(const char *name, uint32_t *ip);
+    // Optional: called after every query (reply is NULL if none was decoded)
+    void (*on_query)(uint32_t ip, ntp_reply_t result, const ntp_packet_t *reply);
+
+    uint32_t timeout_ms;            // Wait for a reply this long
+    int burst_samples;              // Queries per sync once synced
+    uint32_t burst_spacing_ms;      // Gap between them (server rate limits)
+    uint32_t step_threshold_us;     // Larger offsets step, smaller ones slew
+} ntp_client_t;
+
+// A server to try: a literal address, or a name resolved when it is reached
+typedef struct {
+    const char *name;               // NULL to use ip
+    uint32_t ip;                    // Network byte order
+    uint16_t port;
+} ntp_server_addr_t;
+
+// One usable measurement
+typedef struct {
+    int64_t offset_us;              // Server clock minus ours
+    int64_t delay_us;               // Round trip without the server's hold time
+    uint32_t server_ip;
+    ntp_packet_t reply;
+} ntp_measurement_t;
+
+// Single exchange with a server. Fills *m when the result is NTP_REPLY_OK.
+ntp_reply_t ntp_client_query(const ntp_client_t *client, uint32_t ip, uint16_t port,
+                             ntp_measurement_t *m);
+
+// Query one server: a single exchange until synced, then a burst whose
+// lowest-delay sample wins, since queuing delay only ever adds asymmetric
+// error. A kiss code ends the burst at once. NTP_REPLY_OK if any sample was
+// usable; otherwise the kiss code, or NTP_REPLY_INVALID.
+ntp_reply_t ntp_client_sample(const ntp_client_t *client, uint32_t ip, uint16_t port, bool synced,
+                              ntp_measurement_t *best);
+
+// Try servers in order until one gives a usable measurement. Returns the
+// result of the last server tried, where a name that does not resolve counts
+// as NTP_REPLY_INVALID, and the index of the last one actually queried in
+// *tried (-1 if none was).
+ntp_reply_t ntp_client_sync(const ntp_client_t *client, const ntp_server_addr_t *servers, int count,
+                            bool synced, ntp_measurement_t *best, int *tried);
+
+// Correct the clock by a measured offset. Until the first sync, and for
+// offsets at or beyond the step threshold, the clock is stepped; otherwise
+// it is slewed so the seconds never jump. Returns true if it stepped.
+bool ntp_client_apply(const ntp_client_t *client, int64_t offset_us, bool synced);
+
+// Poll scheduling after a sync attempt
+typedef struct {
+    uint32_t min_sec;
+    uint32_t max_sec;
+    uint32_t retry_sec;             // Wait after the next failure
+} ntp_backoff_t;
+
+void ntp_backoff_init(ntp_backoff_t *backoff, uint32_t min_sec, uint32_t max_sec);
+
+// Seconds until the next attempt: the sync interval after a success or a
+// DENY (nothing to retry), otherwise a doubling retry that starts at
+// min_sec, jumps to max_sec on a RATE kiss, and never exceeds the interval.
+uint32_t ntp_backoff_next(ntp_backoff_t *backoff, ntp_reply_t result, uint32_t interval_sec);
+
+#endif // NTP_CLIENT_H
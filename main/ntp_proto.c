@@ -0,0 +1,178 @@
+#include "ntp_proto.h"
+
+// Seconds between the NTP epoch (1900) and the Unix epoch (1970)
+#define NTP_UNIX_OFFSET     2208988800ULL
+
+// Seconds in one 32-bit NTP era (2^32)
+#define NTP_ERA_SECONDS     4294967296LL
+
+// Kiss codes (ASCII in the reference ID field)
+#define KISS_CODE(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (d))
+#define KISS_RATE           KISS_CODE('R', 'A', 'T', 'E')
+#define KISS_DENY           KISS_CODE('D', 'E', 'N', 'Y')
+#define KISS_RSTR           KISS_CODE('R', 'S', 'T', 'R')
+
+// Served replies
+#define SERVER_PRECISION    -20     // ~1 us clock reading resolution (2^-20 s)
+#define SERVER_PHI_PPM      15      // RFC 5905 frequency tolerance for dispersion growth
+
+ntp_ts_t ntp_ts_from_unix_us(int64_t unix_us) {
+    int64_t sec = unix_us / 1000000;
+    int64_t usec = unix_us % 1000000;
+    if (usec < 0) {
+        usec += 1000000;
+        sec--;
+    }
+
+    ntp_ts_t ts = {
+        .sec = (uint32_t)(sec + NTP_UNIX_OFFSET),
+        .frac = (uint32_t)(((uint64_t)usec << 32) / 1000000),
+    };
+    return ts;
+}
+
+int64_t ntp_ts_to_unix_us(ntp_ts_t ts) {
+    int64_t sec = (int64_t)ts.sec - (int64_t)NTP_UNIX_OFFSET;
+
+    // Era 1 starts in 2036: small raw values are after the rollover, not 1900
+    if (ts.sec < 0x80000000u) {
+        sec += NTP_ERA_SECONDS;
+    }
+
+    int64_t usec = (int64_t)(((uint64_t)ts.frac * 1000000) >> 32);
+    return sec * 1000000 + usec;
+}
+
+uint32_t ntp_short_from_us(uint32_t us) {
+    return (uint32_t)(((uint64_t)us << 16) / 1000000);
+}
+
+uint32_t ntp_short_to_us(uint32_t ntp_short) {
+    uint64_t us = ((uint64_t)ntp_short * 1000000) >> 16;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put_ts(uint8_t *p, ntp_ts_t ts) {
+    put_u32(p, ts.sec);
+    put_u32(p + 4, ts.frac);
+}
+
+static ntp_ts_t get_ts(const uint8_t *p) {
+    ntp_ts_t ts = {get_u32(p), get_u32(p + 4)};
+    return ts;
+}
+
+void ntp_packet_encode(const ntp_packet_t *pkt, uint8_t *buf) {
+    buf[0] = (uint8_t)((pkt->leap << 6) | ((pkt->version & 0x07) << 3) | (pkt->mode & 0x07));
+    buf[1] = pkt->stratum;
+    buf[2] = (uint8_t)pkt->poll;
+    buf[3] = (uint8_t)pkt->precision;
+    put_u32(buf + 4, pkt->root_delay);
+    put_u32(buf + 8, pkt->root_dispersion);
+    put_u32(buf + 12, pkt->ref_id);
+    put_ts(buf + 16, pkt->ref_ts);
+    put_ts(buf + 24, pkt->orig_ts);
+    put_ts(buf + 32, pkt->recv_ts);
+    put_ts(buf + 40, pkt->xmit_ts);
+}
+
+bool ntp_packet_decode(const uint8_t *buf, size_t len, ntp_packet_t *pkt) {
+    if (len < NTP_PACKET_SIZE) return false;
+
+    pkt->leap = buf[0] >> 6;
+    pkt->version = (buf[0] >> 3) & 0x07;
+    pkt->mode = buf[0] & 0x07;
+    pkt->stratum = buf[1];
+    pkt->poll = (int8_t)buf[2];
+    pkt->precision = (int8_t)buf[3];
+    pkt->root_delay = get_u32(buf + 4);
+    pkt->root_dispersion = get_u32(buf + 8);
+    pkt->ref_id = get_u32(buf + 12);
+    pkt->ref_ts = get_ts(buf + 16);
+    pkt->orig_ts = get_ts(buf + 24);
+    pkt->recv_ts = get_ts(buf + 32);
+    pkt->xmit_ts = get_ts(buf + 40);
+    return true;
+}
+
+ntp_reply_t ntp_check_reply(const ntp_packet_t *request, const ntp_packet_t *reply) {
+    if (reply->mode != NTP_MODE_SERVER || reply->version < 1 || reply->version > NTP_VERSION) {
+        return NTP_REPLY_INVALID;
+    }
+    if (!ntp_ts_equal(reply->orig_ts, request->xmit_ts)) {
+        return NTP_REPLY_INVALID;
+    }
+
+    if (reply->stratum == NTP_STRATUM_KOD) {
+        switch (reply->ref_id) {
+            case KISS_RATE:
+                return NTP_REPLY_KOD_RATE;
+            case KISS_DENY:
+            case KISS_RSTR:
+                return NTP_REPLY_KOD_DENY;
+            default:
+                return NTP_REPLY_KOD_OTHER;
+        }
+    }
+
+    if (reply->leap == NTP_LI_ALARM || reply->stratum > NTP_STRATUM_MAX) {
+        return NTP_REPLY_UNSYNCED;
+    }
+    if (reply->xmit_ts.sec == 0 && reply->xmit_ts.frac == 0) {
+        return NTP_REPLY_INVALID;
+    }
+    return NTP_REPLY_OK;
+}
+
+bool ntp_make_reply(const ntp_packet_t *request, int64_t recv_us, const ntp_reference_t *ref,
+                    ntp_packet_t *reply) {
+    if (request->mode != NTP_MODE_CLIENT || request->version < 1 || request->version > NTP_VERSION) {
+        return false;
+    }
+
+    *reply = (ntp_packet_t){
+        .version = request->version,
+        .mode = NTP_MODE_SERVER,
+        .poll = request->poll,
+        .precision = SERVER_PRECISION,
+        .orig_ts = request->xmit_ts,
+        .recv_ts = ntp_ts_from_unix_us(recv_us),
+    };
+
+    if (!ref->synced) {
+        reply->leap = NTP_LI_ALARM;
+        reply->stratum = NTP_STRATUM_UNSYNC;
+        return true;
+    }
+
+    // Dispersion grows with time since our last sync
+    int64_t since_sync_us = recv_us - ref->sync_us;
+    if (since_sync_us < 0) since_sync_us = 0;
+    uint64_t disp_us = ref->root_dispersion_us + (uint64_t)since_sync_us * SERVER_PHI_PPM / 1000000;
+
+    reply->stratum = ref->stratum < NTP_STRATUM_MAX ? ref->stratum + 1 : NTP_STRATUM_MAX;
+    reply->root_delay = ntp_short_from_us(ref->root_delay_us);
+    reply->root_dispersion = ntp_short_from_us(disp_us > UINT32_MAX ? UINT32_MAX : (uint32_t)disp_us);
+    reply->ref_id = ref->ref_id;    // Upstream IPv4 address for stratum > 1
+    reply->ref_ts = ntp_ts_from_unix_us(ref->sync_us);
+    return true;
+}
+
+void ntp_compute_offset_delay(int64_t t1, int64_t t2, int64_t t3, int64_t t4,
+                              int64_t *offset, int64_t *delay) {
+    // RFC 5905: offset = ((t2 - t1) + (t3 - t4)) / 2, delay = (t4 - t1) - (t3 - t2)
+    *offset = ((t2 - t1) + (t3 - t4)) / 2;
+    *delay = (t4 - t1) - (t3 - t2);
+    if (*delay < 0) *delay = 0;
+}
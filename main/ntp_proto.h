@@ -0,0 +1,96 @@
+#ifndef NTP_PROTO_H
+#define NTP_PROTO_H
+
+// NTP wire format and offset/delay math (plain C, no ESP-IDF dependencies)
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NTP_PORT            123
+#define NTP_PACKET_SIZE     48
+
+// LI/VN/Mode fields
+#define NTP_VERSION         4
+#define NTP_MODE_CLIENT     3
+#define NTP_MODE_SERVER     4
+#define NTP_LI_ALARM        3   // Leap indicator: clock not synchronized
+
+#define NTP_STRATUM_KOD     0   // Kiss-o'-Death message
+#define NTP_STRATUM_MAX     15  // 16 and above means unsynchronized
+#define NTP_STRATUM_UNSYNC  16
+
+// Result of validating a server reply against the request that was sent
+typedef enum {
+    NTP_REPLY_OK,
+    NTP_REPLY_INVALID,      // Malformed, wrong mode or not an answer to our request
+    NTP_REPLY_UNSYNCED,     // Server has no usable time (leap alarm or bad stratum)
+    NTP_REPLY_KOD_RATE,     // Kiss-o'-Death RATE: poll less often
+    NTP_REPLY_KOD_DENY,     // Kiss-o'-Death DENY/RSTR: stop using this server
+    NTP_REPLY_KOD_OTHER,    // Any other kiss code: treat as no reply
+} ntp_reply_t;
+
+// NTP timestamp: seconds since 1900 plus 32-bit binary fraction
+typedef struct {
+    uint32_t sec;
+    uint32_t frac;
+} ntp_ts_t;
+
+typedef struct {
+    uint8_t leap;
+    uint8_t version;
+    uint8_t mode;
+    uint8_t stratum;
+    int8_t poll;
+    int8_t precision;
+    uint32_t root_delay;       // 16.16 fixed point seconds
+    uint32_t root_dispersion;  // 16.16 fixed point seconds
+    uint32_t ref_id;
+    ntp_ts_t ref_ts;
+    ntp_ts_t orig_ts;
+    ntp_ts_t recv_ts;
+    ntp_ts_t xmit_ts;
+} ntp_packet_t;
+
+// Convert between NTP timestamps and Unix time in microseconds
+ntp_ts_t ntp_ts_from_unix_us(int64_t unix_us);
+int64_t ntp_ts_to_unix_us(ntp_ts_t ts);
+
+// Convert between 16.16 fixed point seconds (root delay/dispersion) and microseconds
+uint32_t ntp_short_from_us(uint32_t us);
+uint32_t ntp_short_to_us(uint32_t ntp_short);
+
+static inline bool ntp_ts_equal(ntp_ts_t a, ntp_ts_t b) {
+    return a.sec == b.sec && a.frac == b.frac;
+}
+
+// Serialize/parse a 48-byte packet (network byte order)
+void ntp_packet_encode(const ntp_packet_t *pkt, uint8_t *buf);
+bool ntp_packet_decode(const uint8_t *buf, size_t len, ntp_packet_t *pkt);
+
+// Classify a decoded reply. Kiss codes are only honored when the reply
+// echoes our transmit timestamp, so spoofed packets cannot silence the client.
+ntp_reply_t ntp_check_reply(const ntp_packet_t *request, const ntp_packet_t *reply);
+
+// Our own time source, for the header of replies we serve
+typedef struct {
+    bool synced;
+    uint8_t stratum;            // Stratum of the server we last synced to
+    uint32_t ref_id;            // Its IPv4 address (host byte order)
+    int64_t sync_us;            // Unix time of that sync
+    uint32_t root_delay_us;     // Root delay and dispersion at that sync
+    uint32_t root_dispersion_us;
+} ntp_reference_t;
+
+// Build the reply to a request that arrived at recv_us (Unix time). Returns
+// false if the request is not a client request of a version we speak. The
+// caller sets xmit_ts as late as possible before encoding.
+bool ntp_make_reply(const ntp_packet_t *request, int64_t recv_us, const ntp_reference_t *ref,
+                    ntp_packet_t *reply);
+
+// Clock offset and round-trip delay (all in microseconds) from the four
+// timestamps: client send t1, server receive t2, server send t3, client receive t4
+void ntp_compute_offset_delay(int64_t t1, int64_t t2, int64_t t3, int64_t t4,
+                              int64_t *offset, int64_t *delay);
+
+#endif // NTP_PROTO_H
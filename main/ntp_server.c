@@ -0,0 +1,146 @@
+#include "ntp_server.h"
+#include "ntp_proto.h"
+#include "wifi.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include <string.h>
+#include <sys/time.h>
+
+static const char *TAG = "ntp_server";
+
+#define NTP_SERVER_TASK_STACK       3072
+#define NTP_SERVER_TASK_PRIORITY    6       // Above the client so replies go out promptly
+
+// The task clears its handle under the lock as it decides to exit, so a
+// start racing with that exit either keeps it running or creates a new one
+static portMUX_TYPE server_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t server_task_handle = NULL;
+static volatile bool server_running = false;
+static volatile uint32_t request_count = 0;
+
+static int64_t get_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int open_socket(void) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket");
+        return -1;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(NTP_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Failed to bind UDP port %d", NTP_PORT);
+        close(sock);
+        return -1;
+    }
+
+    // Periodic timeout so a stop request is noticed
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return sock;
+}
+
+// Our own sync state, for the reply header
+static void get_reference(ntp_reference_t *ref) {
+    ntp_stats_t stats;
+    wifi_get_ntp_stats(&stats);
+
+    ref->synced = stats.synced;
+    ref->stratum = stats.stratum;
+    ref->ref_id = ntohl(stats.server_ip);
+    ref->sync_us = (int64_t)stats.last_sync_time * 1000000;
+    ref->root_delay_us = stats.root_delay_us;
+    ref->root_dispersion_us = stats.root_dispersion_us;
+}
+
+static void serve_requests(int sock) {
+    uint8_t buf[NTP_PACKET_SIZE];
+
+    while (server_running && wifi_is_connected()) {
+        struct sockaddr_in client;
+        socklen_t client_len = sizeof(client);
+        int len = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&client, &client_len);
+        int64_t recv_us = get_time_us();
+
+        ntp_packet_t request;
+        if (len < 0 || !ntp_packet_decode(buf, len, &request)) continue;
+
+        ntp_reference_t ref;
+        get_reference(&ref);
+        ntp_packet_t reply;
+        if (!ntp_make_reply(&request, recv_us, &ref, &reply)) continue;
+
+        // Transmit timestamp as late as possible
+        reply.xmit_ts = ntp_ts_from_unix_us(get_time_us());
+        ntp_packet_encode(&reply, buf);
+        sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&client, client_len);
+        request_count++;
+    }
+}
+
+static bool keep_serving(void) {
+    portENTER_CRITICAL(&server_lock);
+    bool running = server_running;
+    if (!running) server_task_handle = NULL;
+    portEXIT_CRITICAL(&server_lock);
+    return running;
+}
+
+static void ntp_server_task(void *arg) {
+    ESP_LOGI(TAG, "SNTP server started");
+
+    while (keep_serving()) {
+        if (!wifi_is_connected()) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+
+        int sock = open_socket();
+        if (sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(5000));
+            continue;
+        }
+        // Power save would hold requests until the next beacon we listen to
+        wifi_power_hold();
+        serve_requests(sock);
+        wifi_power_release();
+        close(sock);
+    }
+
+    ESP_LOGI(TAG, "SNTP server stopped");
+    vTaskDelete(NULL);
+}
+
+void ntp_server_start(void) {
+    portENTER_CRITICAL(&server_lock);
+    server_running = true;
+    bool create = !server_task_handle;
+    portEXIT_CRITICAL(&server_lock);
+
+    if (create) {
+        xTaskCreate(ntp_server_task, "ntp_srv", NTP_SERVER_TASK_STACK, NULL,
+                    NTP_SERVER_TASK_PRIORITY, &server_task_handle);
+    }
+}
+
+void ntp_server_stop(void) {
+    server_running = false;
+}
+
+bool ntp_server_is_running(void) {
+    return server_running;
+}
+
+uint32_t ntp_server_get_request_count(void) {
+    return request_count;
+}
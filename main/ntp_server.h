@@ -0,0 +1,20 @@
+#ifndef NTP_SERVER_H
+#define NTP_SERVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Start answering SNTP requests on UDP port 123 with this clock's time.
+// Waits for WiFi before binding; replies carry an alarm leap indicator until
+// the clock has been synchronized by NTP itself.
+void ntp_server_start(void);
+
+// Stop serving (takes effect within one receive timeout)
+void ntp_server_stop(void);
+
+bool ntp_server_is_running(void);
+
+// Number of requests answered since boot
+uint32_t ntp_server_get_request_count(void);
+
+#endif // NTP_SERVER_H
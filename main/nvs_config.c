@@ -1,31 +1,394 @@
 #include "nvs_config.h"
+#include "config.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "nvs_config";
 static const char *NVS_NAMESPACE = "cyd_clock";
 
-// Helper functions to reduce boilerplate
-static bool nvs_open_read(nvs_handle_t *handle) {
-    return nvs_open(NVS_NAMESPACE, NVS_READONLY, handle) == ESP_OK;
+#define FLUSH_TASK_STACK    3072
+#define FLUSH_TASK_PRIORITY 2       // Below the UI and network tasks
+
+// All settings are one struct, stored as a single CRC-protected blob so a
+// write is all-or-nothing. It is read once at boot and served from RAM;
+// setters mark it dirty and a background task rewrites the blob once
+// changes stop, so UI code never waits on a flash commit.
+
+#define CONFIG_KEY      "config"
+#define CONFIG_MAGIC    0x43594443  // "CYDC"
+#define CONFIG_VERSION  1
+
+// Setting bits in config_t.present. Stored on flash: append, never renumber.
+typedef enum {
+    KEY_WIFI_NETS,
+    KEY_WIFI_AP,
+    KEY_TIMEZONE,
+    KEY_BRIGHTNESS,
+    KEY_NTP_INTERVAL,
+    KEY_NTP_CUSTOM,
+    KEY_HTTP_HOST,
+    KEY_DNS_HOST,                   // Single entry before KEY_DNS_TABLE
+    KEY_DNS_IP,
+    KEY_NTP_SERVE,
+    KEY_WIFI_PS,
+    KEY_TOUCH_CAL,
+    KEY_ROTATION,
+    KEY_LED_BRIGHT,
+    KEY_LAST_UTC,
+    KEY_RTC_DRIFT,
+    KEY_DNS_TABLE,
+    KEY_PEER_SYNC,
+    KEY_COUNT,
+} config_key_t;
+
+// Blob payload. Fields may be appended without a version bump: blobs from
+// older builds are shorter and the new fields read as absent. Any other
+// layout change needs a new CONFIG_VERSION and a step in migrate_payload().
+typedef struct {
+    uint32_t present;               // Bits of settings that hold a value
+    uint8_t wifi_net_count;
+    wifi_cred_t wifi_nets[WIFI_CRED_MAX];
+    wifi_ap_cache_t wifi_ap;
+    char timezone[MAX_TIMEZONE_LEN];
+    uint8_t brightness;
+    uint32_t ntp_interval;
+    char ntp_custom[MAX_NTP_SERVER_LEN];
+    char http_host[MAX_NTP_SERVER_LEN];
+    char dns_host[MAX_NTP_SERVER_LEN];
+    uint32_t dns_ip;
+    uint8_t ntp_serve;
+    uint8_t wifi_ps;
+    touch_cal_t touch_cal;
+    uint8_t rotation;
+    uint8_t led_bright;
+    int64_t last_utc;
+    int32_t rtc_drift;
+    dns_saved_t dns_table[DNS_SAVED_MAX];
+    uint8_t peer_sync;
+} config_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;                // Payload bytes after the header
+    uint32_t crc;                   // CRC-32 of the payload
+} config_header_t;
+
+typedef struct {
+    config_header_t header;
+    config_t config;
+} config_blob_t;
+
+// Where each setting lives in config_t, and the loose NVS key it was kept
+// in before the blob existed (for migration)
+typedef struct {
+    const char *legacy_name;
+    nvs_type_t legacy_type;
+    size_t offset;
+    size_t size;                    // Capacity (strings include the terminator)
+} key_def_t;
+
+#define KEY(id, key, nvs_type, field) \
+    [id] = { key, nvs_type, offsetof(config_t, field), sizeof(((config_t *)0)->field) }
+
+static const key_def_t keys[KEY_COUNT] = {
+    KEY(KEY_WIFI_NETS,    "wifi_nets",    NVS_TYPE_BLOB, wifi_nets),
+    KEY(KEY_WIFI_AP,      "wifi_ap",      NVS_TYPE_BLOB, wifi_ap),
+    KEY(KEY_TIMEZONE,     "timezone",     NVS_TYPE_STR,  timezone),
+    KEY(KEY_BRIGHTNESS,   "brightness",   NVS_TYPE_U8,   brightness),
+    KEY(KEY_NTP_INTERVAL, "ntp_interval", NVS_TYPE_U32,  ntp_interval),
+    KEY(KEY_NTP_CUSTOM,   "ntp_custom",   NVS_TYPE_STR,  ntp_custom),
+    KEY(KEY_HTTP_HOST,    "http_host",    NVS_TYPE_STR,  http_host),
+    KEY(KEY_DNS_HOST,     "dns_host",     NVS_TYPE_STR,  dns_host),
+    KEY(KEY_DNS_IP,       "dns_ip",       NVS_TYPE_U32,  dns_ip),
+    KEY(KEY_NTP_SERVE,    "ntp_serve",    NVS_TYPE_U8,   ntp_serve),
+    KEY(KEY_WIFI_PS,      "wifi_ps",      NVS_TYPE_U8,   wifi_ps),
+    KEY(KEY_TOUCH_CAL,    "touch_cal",    NVS_TYPE_BLOB, touch_cal),
+    KEY(KEY_ROTATION,     "rotation",     NVS_TYPE_U8,   rotation),
+    KEY(KEY_LED_BRIGHT,   "led_bright",   NVS_TYPE_U8,   led_bright),
+    KEY(KEY_LAST_UTC,     "last_utc",     NVS_TYPE_I64,  last_utc),
+    KEY(KEY_RTC_DRIFT,    "rtc_drift",    NVS_TYPE_I32,  rtc_drift),
+    KEY(KEY_DNS_TABLE,    "dns_table",    NVS_TYPE_BLOB, dns_table),
+    KEY(KEY_PEER_SYNC,    "peer_sync",    NVS_TYPE_U8,   peer_sync),
+};
+
+// Single network stored before the credential table existed
+#define LEGACY_SSID_KEY     "ssid"
+#define LEGACY_PASSWORD_KEY "password"
+
+// Live settings, guarded by cache_lock (held only for RAM copies)
+static config_t config;
+static bool dirty = false;
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Flush state: the blob is built from a snapshot without holding cache_lock
+static config_blob_t blob;
+static SemaphoreHandle_t flush_mutex = NULL;
+static TaskHandle_t flush_task_handle = NULL;
+
+#define BIT(key) (1UL << (key))
+
+static void *field_ptr(config_t *c, config_key_t key) {
+    return (uint8_t *)c + keys[key].offset;
 }
 
-static bool nvs_open_write(nvs_handle_t *handle) {
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS for writing: %s", esp_err_to_name(err));
+// Convert a payload of the given version into the current layout
+static bool migrate_payload(const uint8_t *payload, uint16_t version, size_t length, config_t *out) {
+    memset(out, 0, sizeof(*out));
+    switch (version) {
+        case CONFIG_VERSION:
+            memcpy(out, payload, length < sizeof(*out) ? length : sizeof(*out));
+            return true;
+        default:
+            ESP_LOGE(TAG, "Unknown config version %u", version);
+            return false;
+    }
+}
+
+static bool decode_blob(const uint8_t *buf, size_t len, config_t *out) {
+    config_header_t header;
+    if (len < sizeof(header)) return false;
+    memcpy(&header, buf, sizeof(header));
+
+    const uint8_t *payload = buf + sizeof(header);
+    if (header.magic != CONFIG_MAGIC || header.length != len - sizeof(header)) {
+        return false;
+    }
+    if (esp_rom_crc32_le(0, payload, header.length) != header.crc) {
+        ESP_LOGE(TAG, "Config CRC mismatch");
+        return false;
+    }
+    return migrate_payload(payload, header.version, header.length, out);
+}
+
+static bool read_config_blob(nvs_handle_t handle, config_t *out) {
+    size_t len = 0;
+    if (nvs_get_blob(handle, CONFIG_KEY, NULL, &len) != ESP_OK) {
         return false;
     }
+
+    // May be larger than ours if written by a newer build
+    uint8_t *buf = malloc(len);
+    if (!buf) return false;
+    bool ok = nvs_get_blob(handle, CONFIG_KEY, buf, &len) == ESP_OK && decode_blob(buf, len, out);
+    free(buf);
+    return ok;
+}
+
+// Read one loose key of the old per-setting layout
+static bool read_legacy_key(nvs_handle_t handle, config_key_t key, config_t *out) {
+    void *ptr = field_ptr(out, key);
+    const char *name = keys[key].legacy_name;
+    size_t len = keys[key].size;
+    esp_err_t err;
+
+    switch (keys[key].legacy_type) {
+        case NVS_TYPE_U8:   err = nvs_get_u8(handle, name, ptr); break;
+        case NVS_TYPE_U32:  err = nvs_get_u32(handle, name, ptr); break;
+        case NVS_TYPE_I32:  err = nvs_get_i32(handle, name, ptr); break;
+        case NVS_TYPE_I64:  err = nvs_get_i64(handle, name, ptr); break;
+        case NVS_TYPE_STR:  err = nvs_get_str(handle, name, ptr, &len); break;
+        case NVS_TYPE_BLOB: err = nvs_get_blob(handle, name, ptr, &len); break;
+        default:            err = ESP_ERR_NOT_SUPPORTED; break;
+    }
+    if (err != ESP_OK) return false;
+
+    if (key == KEY_WIFI_NETS) {
+        if (len % sizeof(wifi_cred_t) != 0) return false;
+        out->wifi_net_count = len / sizeof(wifi_cred_t);
+    }
     return true;
 }
 
-static void nvs_commit_and_close(nvs_handle_t handle) {
-    nvs_commit(handle);
+// Build the config from the loose keys of older firmware. Returns the
+// number of settings found.
+static int import_legacy_keys(nvs_handle_t handle, config_t *out) {
+    memset(out, 0, sizeof(*out));
+    int found = 0;
+    for (int k = 0; k < KEY_COUNT; k++) {
+        if (read_legacy_key(handle, k, out)) {
+            out->present |= BIT(k);
+            found++;
+        }
+    }
+
+    if (!(out->present & BIT(KEY_WIFI_NETS))) {
+        wifi_cred_t *cred = &out->wifi_nets[0];
+        size_t ssid_len = sizeof(cred->ssid);
+        size_t pass_len = sizeof(cred->password);
+        if (nvs_get_str(handle, LEGACY_SSID_KEY, cred->ssid, &ssid_len) == ESP_OK &&
+            nvs_get_str(handle, LEGACY_PASSWORD_KEY, cred->password, &pass_len) == ESP_OK) {
+            cred->successes = 1;
+            cred->last_used = 1;
+            out->wifi_net_count = 1;
+            out->present |= BIT(KEY_WIFI_NETS);
+            found++;
+        } else {
+            memset(cred, 0, sizeof(*cred));
+        }
+    }
+    return found;
+}
+
+static void erase_legacy_keys(nvs_handle_t handle) {
+    for (int k = 0; k < KEY_COUNT; k++) {
+        nvs_erase_key(handle, keys[k].legacy_name);
+    }
+    nvs_erase_key(handle, LEGACY_SSID_KEY);
+    nvs_erase_key(handle, LEGACY_PASSWORD_KEY);
+}
+
+// Write the blob from snapshot c; one set_blob, so it is never half-written
+static esp_err_t write_config_blob(nvs_handle_t handle, const config_t *c) {
+    blob.config = *c;
+    blob.header.magic = CONFIG_MAGIC;
+    blob.header.version = CONFIG_VERSION;
+    blob.header.length = sizeof(blob.config);
+    blob.header.crc = esp_rom_crc32_le(0, (const uint8_t *)&blob.config, sizeof(blob.config));
+    return nvs_set_blob(handle, CONFIG_KEY, &blob, sizeof(blob));
+}
+
+static void load_config(void) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return;
+    }
+
+    if (read_config_blob(handle, &config)) {
+        ESP_LOGI(TAG, "Loaded config (%d settings)", __builtin_popcount(config.present));
+        nvs_close(handle);
+        return;
+    }
+
+    // First boot after an upgrade (or an unreadable blob): carry the loose
+    // keys forward, then store the blob before removing them
+    int found = import_legacy_keys(handle, &config);
+    if (found > 0) {
+        ESP_LOGI(TAG, "Migrating %d settings to the config blob", found);
+        if (write_config_blob(handle, &config) == ESP_OK && nvs_commit(handle) == ESP_OK) {
+            erase_legacy_keys(handle);
+            nvs_commit(handle);
+        } else {
+            ESP_LOGE(TAG, "Failed to write migrated config");
+        }
+    } else {
+        ESP_LOGI(TAG, "No stored settings");
+    }
     nvs_close(handle);
 }
 
+static bool get_value(config_key_t key, void *out, size_t size) {
+    portENTER_CRITICAL(&cache_lock);
+    bool found = (config.present & BIT(key)) != 0;
+    if (found) {
+        memcpy(out, field_ptr(&config, key), size < keys[key].size ? size : keys[key].size);
+    }
+    portEXIT_CRITICAL(&cache_lock);
+    return found;
+}
+
+static void mark_dirty(void) {
+    if (flush_task_handle) {
+        xTaskNotifyGive(flush_task_handle);
+    }
+}
+
+static void set_value(config_key_t key, const void *in, size_t len) {
+    if (len > keys[key].size) len = keys[key].size;
+
+    portENTER_CRITICAL(&cache_lock);
+    uint8_t *ptr = field_ptr(&config, key);
+    bool changed = !(config.present & BIT(key)) || memcmp(ptr, in, len) != 0;
+    if (changed) {
+        memcpy(ptr, in, len);
+        memset(ptr + len, 0, keys[key].size - len);
+        config.present |= BIT(key);
+        dirty = true;
+    }
+    portEXIT_CRITICAL(&cache_lock);
+
+    if (changed) mark_dirty();
+}
+
+static void set_string(config_key_t key, const char *str) {
+    // Keep the terminator even if the string has to be cut
+    char buf[MAX_NTP_SERVER_LEN > MAX_TIMEZONE_LEN ? MAX_NTP_SERVER_LEN : MAX_TIMEZONE_LEN];
+    size_t len = strnlen(str, keys[key].size - 1);
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    set_value(key, buf, len + 1);
+}
+
+static void erase_value(config_key_t key) {
+    portENTER_CRITICAL(&cache_lock);
+    bool changed = (config.present & BIT(key)) != 0;
+    if (changed) {
+        config.present &= ~BIT(key);
+        memset(field_ptr(&config, key), 0, keys[key].size);
+        dirty = true;
+    }
+    portEXIT_CRITICAL(&cache_lock);
+
+    if (changed) mark_dirty();
+}
+
+void nvs_config_flush(void) {
+    static config_t snapshot;
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+
+    portENTER_CRITICAL(&cache_lock);
+    bool pending = dirty;
+    snapshot = config;
+    dirty = false;
+    portEXIT_CRITICAL(&cache_lock);
+
+    if (pending) {
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = write_config_blob(handle, &snapshot);
+            if (err == ESP_OK) err = nvs_commit(handle);
+            nvs_close(handle);
+        }
+
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Saved config");
+        } else {
+            // Retry with the next flush
+            ESP_LOGE(TAG, "Failed to save config: %s", esp_err_to_name(err));
+            portENTER_CRITICAL(&cache_lock);
+            dirty = true;
+            portEXIT_CRITICAL(&cache_lock);
+        }
+    }
+    xSemaphoreGive(flush_mutex);
+}
+
+static void flush_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Let a burst of changes (slider taps, a sync's worth of updates)
+        // settle, but don't hold them back indefinitely
+        TickType_t first = xTaskGetTickCount();
+        while (xTaskGetTickCount() - first < pdMS_TO_TICKS(NVS_FLUSH_MAX_DELAY_MS) &&
+               ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NVS_FLUSH_QUIET_MS)) > 0) {
+        }
+        nvs_config_flush();
+    }
+}
+
 void nvs_config_init(void) {
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -35,181 +398,193 @@ void nvs_config_init(void) {
     }
     ESP_ERROR_CHECK(err);
     ESP_LOGI(TAG, "NVS initialized");
-}
 
-bool nvs_config_get_wifi(char *ssid, char *password) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
-        ESP_LOGW(TAG, "No stored WiFi credentials");
-        return false;
-    }
+    load_config();
 
-    size_t ssid_len = MAX_SSID_LEN;
-    size_t pass_len = MAX_PASSWORD_LEN;
-
-    esp_err_t err = nvs_get_str(handle, "ssid", ssid, &ssid_len);
-    if (err != ESP_OK) {
-        nvs_close(handle);
-        return false;
-    }
+    flush_mutex = xSemaphoreCreateMutex();
+    xTaskCreate(flush_task, "nvs_flush", FLUSH_TASK_STACK, NULL, FLUSH_TASK_PRIORITY, &flush_task_handle);
+}
 
-    err = nvs_get_str(handle, "password", password, &pass_len);
-    nvs_close(handle);
+int nvs_config_get_wifi_creds(wifi_cred_t *creds, int max) {
+    portENTER_CRITICAL(&cache_lock);
+    int count = (config.present & BIT(KEY_WIFI_NETS)) ? config.wifi_net_count : 0;
+    if (count > max) count = max;
+    if (count > WIFI_CRED_MAX) count = WIFI_CRED_MAX;
+    memcpy(creds, config.wifi_nets, count * sizeof(wifi_cred_t));
+    portEXIT_CRITICAL(&cache_lock);
 
-    if (err != ESP_OK) {
-        return false;
+    if (count == 0) {
+        ESP_LOGW(TAG, "No stored WiFi credentials");
     }
-
-    ESP_LOGI(TAG, "Loaded WiFi credentials for SSID: %s", ssid);
-    return true;
+    return count;
 }
 
-void nvs_config_set_wifi(const char *ssid, const char *password) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
-
-    ESP_ERROR_CHECK(nvs_set_str(handle, "ssid", ssid));
-    ESP_ERROR_CHECK(nvs_set_str(handle, "password", password));
-    nvs_commit_and_close(handle);
-    ESP_LOGI(TAG, "Saved WiFi credentials for SSID: %s", ssid);
+void nvs_config_set_wifi_creds(const wifi_cred_t *creds, int count) {
+    if (count > WIFI_CRED_MAX) count = WIFI_CRED_MAX;
+
+    portENTER_CRITICAL(&cache_lock);
+    memset(config.wifi_nets, 0, sizeof(config.wifi_nets));
+    memcpy(config.wifi_nets, creds, count * sizeof(wifi_cred_t));
+    config.wifi_net_count = count;
+    config.present |= BIT(KEY_WIFI_NETS);
+    dirty = true;
+    portEXIT_CRITICAL(&cache_lock);
+    mark_dirty();
 }
 
 void nvs_config_clear_wifi(void) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
-
-    nvs_erase_key(handle, "ssid");
-    nvs_erase_key(handle, "password");
-    nvs_commit_and_close(handle);
+    portENTER_CRITICAL(&cache_lock);
+    config.wifi_net_count = 0;
+    portEXIT_CRITICAL(&cache_lock);
+    erase_value(KEY_WIFI_NETS);
+    erase_value(KEY_WIFI_AP);
     ESP_LOGI(TAG, "Cleared WiFi credentials");
 }
 
-bool nvs_config_get_timezone(char *tz) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
-        return false;
-    }
+bool nvs_config_get_wifi_ap_cache(wifi_ap_cache_t *cache) {
+    return get_value(KEY_WIFI_AP, cache, sizeof(*cache));
+}
 
-    size_t tz_len = MAX_TIMEZONE_LEN;
-    esp_err_t err = nvs_get_str(handle, "timezone", tz, &tz_len);
-    nvs_close(handle);
+void nvs_config_set_wifi_ap_cache(const wifi_ap_cache_t *cache) {
+    set_value(KEY_WIFI_AP, cache, sizeof(*cache));
+}
 
-    if (err != ESP_OK) {
+bool nvs_config_get_timezone(char *tz) {
+    if (!get_value(KEY_TIMEZONE, tz, MAX_TIMEZONE_LEN)) {
         return false;
     }
-
     ESP_LOGI(TAG, "Loaded timezone: %s", tz);
     return true;
 }
 
 void nvs_config_set_timezone(const char *tz) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
-
-    ESP_ERROR_CHECK(nvs_set_str(handle, "timezone", tz));
-    nvs_commit_and_close(handle);
+    set_string(KEY_TIMEZONE, tz);
     ESP_LOGI(TAG, "Saved timezone: %s", tz);
 }
 
 bool nvs_config_get_brightness(uint8_t *brightness) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
-        return false;
-    }
-
-    esp_err_t err = nvs_get_u8(handle, "brightness", brightness);
-    nvs_close(handle);
-    return err == ESP_OK;
+    return get_value(KEY_BRIGHTNESS, brightness, sizeof(*brightness));
 }
 
 void nvs_config_set_brightness(uint8_t brightness) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
-
-    ESP_ERROR_CHECK(nvs_set_u8(handle, "brightness", brightness));
-    nvs_commit_and_close(handle);
+    set_value(KEY_BRIGHTNESS, &brightness, sizeof(brightness));
 }
 
 bool nvs_config_get_ntp_interval(uint32_t *interval) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
-        return false;
-    }
-
-    esp_err_t err = nvs_get_u32(handle, "ntp_interval", interval);
-    nvs_close(handle);
-    return err == ESP_OK;
+    return get_value(KEY_NTP_INTERVAL, interval, sizeof(*interval));
 }
 
 void nvs_config_set_ntp_interval(uint32_t interval) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
-
-    ESP_ERROR_CHECK(nvs_set_u32(handle, "ntp_interval", interval));
-    nvs_commit_and_close(handle);
+    set_value(KEY_NTP_INTERVAL, &interval, sizeof(interval));
 }
 
 bool nvs_config_get_custom_ntp_server(char *server) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
-        return false;
-    }
-
-    size_t len = MAX_NTP_SERVER_LEN;
-    esp_err_t err = nvs_get_str(handle, "ntp_custom", server, &len);
-    nvs_close(handle);
-    return err == ESP_OK;
+    return get_value(KEY_NTP_CUSTOM, server, MAX_NTP_SERVER_LEN);
 }
 
 void nvs_config_set_custom_ntp_server(const char *server) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
+    set_string(KEY_NTP_CUSTOM, server);
+}
 
-    ESP_ERROR_CHECK(nvs_set_str(handle, "ntp_custom", server));
-    nvs_commit_and_close(handle);
+bool nvs_config_get_http_time_host(char *host) {
+    return get_value(KEY_HTTP_HOST, host, MAX_NTP_SERVER_LEN);
 }
 
-bool nvs_config_get_rotation(bool *rotated) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
-        return false;
+void nvs_config_set_http_time_host(const char *host) {
+    set_string(KEY_HTTP_HOST, host);
+}
+
+bool nvs_config_get_dns_table(dns_saved_t *entries) {
+    if (get_value(KEY_DNS_TABLE, entries, sizeof(dns_saved_t) * DNS_SAVED_MAX)) {
+        return true;
     }
 
+    // Older builds kept only the most recent lookup
+    memset(entries, 0, sizeof(dns_saved_t) * DNS_SAVED_MAX);
+    return get_value(KEY_DNS_HOST, entries[0].name, sizeof(entries[0].name)) &&
+           get_value(KEY_DNS_IP, &entries[0].ip, sizeof(entries[0].ip));
+}
+
+void nvs_config_set_dns_table(const dns_saved_t *entries) {
+    set_value(KEY_DNS_TABLE, entries, sizeof(dns_saved_t) * DNS_SAVED_MAX);
+    erase_value(KEY_DNS_HOST);
+    erase_value(KEY_DNS_IP);
+}
+
+bool nvs_config_get_ntp_serve(bool *enabled) {
     uint8_t value;
-    esp_err_t err = nvs_get_u8(handle, "rotation", &value);
-    nvs_close(handle);
+    if (!get_value(KEY_NTP_SERVE, &value, sizeof(value))) {
+        return false;
+    }
+    *enabled = (value != 0);
+    return true;
+}
 
-    if (err == ESP_OK) {
-        *rotated = (value != 0);
-        return true;
+void nvs_config_set_ntp_serve(bool enabled) {
+    uint8_t value = enabled ? 1 : 0;
+    set_value(KEY_NTP_SERVE, &value, sizeof(value));
+}
+
+bool nvs_config_get_peer_sync(bool *enabled) {
+    uint8_t value;
+    if (!get_value(KEY_PEER_SYNC, &value, sizeof(value))) {
+        return false;
     }
-    return false;
+    *enabled = (value != 0);
+    return true;
 }
 
-void nvs_config_set_rotation(bool rotated) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
+void nvs_config_set_peer_sync(bool enabled) {
+    uint8_t value = enabled ? 1 : 0;
+    set_value(KEY_PEER_SYNC, &value, sizeof(value));
+}
 
-    ESP_ERROR_CHECK(nvs_set_u8(handle, "rotation", rotated ? 1 : 0));
-    nvs_commit_and_close(handle);
+bool nvs_config_get_wifi_power(uint8_t *profile) {
+    return get_value(KEY_WIFI_PS, profile, sizeof(*profile));
 }
 
-bool nvs_config_get_led_brightness(uint8_t *brightness) {
-    nvs_handle_t handle;
-    if (!nvs_open_read(&handle)) {
+void nvs_config_set_wifi_power(uint8_t profile) {
+    set_value(KEY_WIFI_PS, &profile, sizeof(profile));
+}
+
+bool nvs_config_get_touch_cal(touch_cal_t *cal) {
+    return get_value(KEY_TOUCH_CAL, cal, sizeof(*cal));
+}
+
+void nvs_config_set_touch_cal(const touch_cal_t *cal) {
+    set_value(KEY_TOUCH_CAL, cal, sizeof(*cal));
+}
+
+bool nvs_config_get_rotation(bool *rotated) {
+    uint8_t value;
+    if (!get_value(KEY_ROTATION, &value, sizeof(value))) {
         return false;
     }
+    *rotated = (value != 0);
+    return true;
+}
 
-    esp_err_t err = nvs_get_u8(handle, "led_bright", brightness);
-    nvs_close(handle);
+void nvs_config_set_rotation(bool rotated) {
+    uint8_t value = rotated ? 1 : 0;
+    set_value(KEY_ROTATION, &value, sizeof(value));
+}
 
-    return (err == ESP_OK);
+bool nvs_config_get_led_brightness(uint8_t *brightness) {
+    return get_value(KEY_LED_BRIGHT, brightness, sizeof(*brightness));
 }
 
 void nvs_config_set_led_brightness(uint8_t brightness) {
-    nvs_handle_t handle;
-    if (!nvs_open_write(&handle)) return;
+    set_value(KEY_LED_BRIGHT, &brightness, sizeof(brightness));
+}
+
+bool nvs_config_get_saved_time(int64_t *utc_us, int32_t *drift_ppb) {
+    if (!get_value(KEY_RTC_DRIFT, drift_ppb, sizeof(*drift_ppb))) {
+        *drift_ppb = 0;
+    }
+    return get_value(KEY_LAST_UTC, utc_us, sizeof(*utc_us));
+}
 
-    ESP_ERROR_CHECK(nvs_set_u8(handle, "led_bright", brightness));
-    nvs_commit_and_close(handle);
+void nvs_config_set_saved_time(int64_t utc_us, int32_t drift_ppb) {
+    set_value(KEY_LAST_UTC, &utc_us, sizeof(utc_us));
+    set_value(KEY_RTC_DRIFT, &drift_ppb, sizeof(drift_ppb));
 }
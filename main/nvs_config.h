@@ -3,19 +3,43 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "touch.h"
 
 #define MAX_SSID_LEN     32
 #define MAX_PASSWORD_LEN 64
 #define MAX_TIMEZONE_LEN 48
 
-// Initialize NVS storage
+// Initialize NVS storage and load all settings into RAM. Getters are served
+// from RAM; setters return immediately and a background task writes the
+// changes to flash once they stop coming (NVS_FLUSH_QUIET_MS).
 void nvs_config_init(void);
 
-// WiFi credentials
-bool nvs_config_get_wifi(char *ssid, char *password);
-void nvs_config_set_wifi(const char *ssid, const char *password);
+// Write pending changes now (e.g. before a deliberate restart)
+void nvs_config_flush(void);
+
+// Known WiFi networks (credential table with per-network connect history)
+#define WIFI_CRED_MAX 8
+typedef struct {
+    char ssid[MAX_SSID_LEN + 1];
+    char password[MAX_PASSWORD_LEN];
+    int8_t last_rssi;       // Signal when last connected (dBm)
+    uint8_t successes;      // Successful connects (saturating)
+    uint8_t failures;       // Failed connects since the last success
+    uint32_t last_used;     // Order of last successful use, higher is more recent
+} wifi_cred_t;
+int nvs_config_get_wifi_creds(wifi_cred_t *creds, int max);
+void nvs_config_set_wifi_creds(const wifi_cred_t *creds, int count);
 void nvs_config_clear_wifi(void);
 
+// Last successful association (directed reconnect without a full scan)
+typedef struct {
+    char ssid[MAX_SSID_LEN + 1];
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_ap_cache_t;
+bool nvs_config_get_wifi_ap_cache(wifi_ap_cache_t *cache);
+void nvs_config_set_wifi_ap_cache(const wifi_ap_cache_t *cache);
+
 // Timezone
 bool nvs_config_get_timezone(char *tz);
 void nvs_config_set_timezone(const char *tz);
@@ -30,6 +54,31 @@ bool nvs_config_get_ntp_interval(uint32_t *interval);
 void nvs_config_set_ntp_interval(uint32_t interval);
 bool nvs_config_get_custom_ntp_server(char *server);
 void nvs_config_set_custom_ntp_server(const char *server);
+bool nvs_config_get_http_time_host(char *host);
+void nvs_config_set_http_time_host(const char *host);
+
+// Resolved addresses kept across reboots (DNS cache), one slot per host;
+// unused slots have an empty name
+#define DNS_SAVED_MAX 4
+typedef struct {
+    char name[MAX_NTP_SERVER_LEN];
+    uint32_t ip;            // Network byte order
+} dns_saved_t;
+bool nvs_config_get_dns_table(dns_saved_t *entries);    // DNS_SAVED_MAX slots
+void nvs_config_set_dns_table(const dns_saved_t *entries);
+
+bool nvs_config_get_ntp_serve(bool *enabled);
+void nvs_config_set_ntp_serve(bool enabled);
+bool nvs_config_get_peer_sync(bool *enabled);
+void nvs_config_set_peer_sync(bool enabled);
+
+// WiFi power profile (wifi_power_profile_t)
+bool nvs_config_get_wifi_power(uint8_t *profile);
+void nvs_config_set_wifi_power(uint8_t profile);
+
+// Touch calibration
+bool nvs_config_get_touch_cal(touch_cal_t *cal);
+void nvs_config_set_touch_cal(const touch_cal_t *cal);
 
 // Display rotation
 bool nvs_config_get_rotation(bool *rotated);
@@ -39,4 +88,8 @@ void nvs_config_set_rotation(bool rotated);
 bool nvs_config_get_led_brightness(uint8_t *brightness);
 void nvs_config_set_led_brightness(uint8_t brightness);
 
+// Last known UTC time (microseconds) and learned RTC drift (ppb)
+bool nvs_config_get_saved_time(int64_t *utc_us, int32_t *drift_ppb);
+void nvs_config_set_saved_time(int64_t utc_us, int32_t drift_ppb);
+
 #endif // NVS_CONFIG_H
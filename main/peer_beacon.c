@@ -0,0 +1,138 @@
+#include "peer_beacon.h"
+
+#define BEACON_MAGIC        0x43594442  // "CYDB"
+#define BEACON_VERSION      1
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void peer_beacon_encode(const peer_beacon_t *beacon, uint8_t *buf) {
+    put_u32(buf, BEACON_MAGIC);
+    buf[4] = BEACON_VERSION;
+    buf[5] = beacon->stratum;
+    buf[6] = 0;
+    buf[7] = 0;
+    put_u32(buf + 8, beacon->node_id);
+    put_u32(buf + 12, (uint32_t)((uint64_t)beacon->time_us >> 32));
+    put_u32(buf + 16, (uint32_t)beacon->time_us);
+}
+
+bool peer_beacon_decode(const uint8_t *buf, size_t len, peer_beacon_t *beacon) {
+    if (len < PEER_BEACON_SIZE || get_u32(buf) != BEACON_MAGIC || buf[4] != BEACON_VERSION) {
+        return false;
+    }
+    beacon->stratum = buf[5];
+    beacon->node_id = get_u32(buf + 8);
+    beacon->time_us = (int64_t)(((uint64_t)get_u32(buf + 12) << 32) | get_u32(buf + 16));
+    return true;
+}
+
+bool peer_beacon_outranks(uint8_t stratum_a, uint32_t id_a, uint8_t stratum_b, uint32_t id_b) {
+    if (stratum_a != stratum_b) return stratum_a < stratum_b;
+    return id_a < id_b;
+}
+
+void peer_phase_reset(peer_phase_t *phase) {
+    phase->count = 0;
+    phase->next = 0;
+}
+
+bool peer_phase_add(peer_phase_t *phase, int64_t sample_us, int64_t max_us, int32_t *estimate_us) {
+    if (sample_us > max_us || sample_us < -max_us) {
+        return false;
+    }
+
+    phase->samples[phase->next] = (int32_t)sample_us;
+    phase->next = (phase->next + 1) % PEER_PHASE_WINDOW;
+    if (phase->count < PEER_PHASE_WINDOW) phase->count++;
+
+    int32_t best = phase->samples[0];
+    for (int i = 1; i < phase->count; i++) {
+        if (phase->samples[i] > best) best = phase->samples[i];
+    }
+    *estimate_us = best;
+    return true;
+}
+
+int32_t peer_phase_slew(int32_t applied, int32_t target, int32_t max_step) {
+    int32_t step = target - applied;
+    if (step > max_step) step = max_step;
+    if (step < -max_step) step = -max_step;
+    return applied + step;
+}
+
+void peer_node_init(peer_node_t *node, uint32_t node_id, uint32_t timeout_ms,
+                    int64_t max_phase_us, int32_t slew_us) {
+    node->node_id = node_id;
+    node->timeout_ms = timeout_ms;
+    node->max_phase_us = max_phase_us;
+    node->slew_us = slew_us;
+    node->leader_id = 0;
+    peer_node_reset(node);
+}
+
+static void forget_leader(peer_node_t *node) {
+    node->leader_stratum = PEER_STRATUM_NONE;
+    peer_phase_reset(&node->phase);
+}
+
+static bool leader_alive(const peer_node_t *node, uint32_t now_ms) {
+    return node->leader_stratum != PEER_STRATUM_NONE &&
+           now_ms - node->leader_seen_ms < node->timeout_ms;
+}
+
+void peer_node_reset(peer_node_t *node) {
+    forget_leader(node);
+    node->applied_us = 0;
+    node->leading = false;
+}
+
+bool peer_node_receive(peer_node_t *node, const peer_beacon_t *beacon, int64_t recv_us,
+                       uint8_t own_stratum, uint32_t now_ms) {
+    if (beacon->node_id == node->node_id || beacon->stratum == PEER_STRATUM_NONE) return false;
+
+    if (own_stratum != PEER_STRATUM_NONE &&
+        !peer_beacon_outranks(beacon->stratum, beacon->node_id, own_stratum, node->node_id)) {
+        return false;
+    }
+    if (leader_alive(node, now_ms) && beacon->node_id != node->leader_id &&
+        !peer_beacon_outranks(beacon->stratum, beacon->node_id, node->leader_stratum, node->leader_id)) {
+        return false;
+    }
+
+    if (beacon->node_id != node->leader_id || node->leader_stratum == PEER_STRATUM_NONE) {
+        forget_leader(node);
+        node->leader_id = beacon->node_id;
+    }
+    node->leader_stratum = beacon->stratum;
+    node->leader_seen_ms = now_ms;
+    node->leading = false;
+
+    int32_t estimate;
+    if (peer_phase_add(&node->phase, beacon->time_us - recv_us, node->max_phase_us, &estimate)) {
+        node->applied_us = peer_phase_slew(node->applied_us, estimate, node->slew_us);
+    }
+    return true;
+}
+
+bool peer_node_tick(peer_node_t *node, uint8_t own_stratum, uint32_t now_ms) {
+    if (leader_alive(node, now_ms) &&
+        !(own_stratum != PEER_STRATUM_NONE &&
+          peer_beacon_outranks(own_stratum, node->node_id, node->leader_stratum, node->leader_id))) {
+        return false;
+    }
+
+    // No better clock around: lead if we can, otherwise drift back to system time
+    forget_leader(node);
+    node->applied_us = peer_phase_slew(node->applied_us, 0, node->slew_us);
+    node->leading = own_stratum != PEER_STRATUM_NONE;
+    return node->leading;
+}
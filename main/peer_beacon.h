@@ -0,0 +1,77 @@
+#ifndef PEER_BEACON_H
+#define PEER_BEACON_H
+
+// Peer sync beacon wire format, leader ranking, phase estimate and leader
+// election (plain C, no ESP-IDF dependencies)
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PEER_BEACON_SIZE        20
+#define PEER_STRATUM_NONE       0xFF    // Not synced, never leads
+#define PEER_PHASE_WINDOW       8       // Beacons considered for the phase estimate
+
+typedef struct {
+    uint8_t stratum;
+    uint32_t node_id;
+    int64_t time_us;            // Sender's system time when the beacon left
+} peer_beacon_t;
+
+// Serialize/parse a beacon (network byte order)
+void peer_beacon_encode(const peer_beacon_t *beacon, uint8_t *buf);
+bool peer_beacon_decode(const uint8_t *buf, size_t len, peer_beacon_t *beacon);
+
+// Lower stratum wins; node ID breaks ties so exactly one clock leads
+bool peer_beacon_outranks(uint8_t stratum_a, uint32_t id_a, uint8_t stratum_b, uint32_t id_b);
+
+// Recent (leader time - local receive time) samples. One-way delay only
+// ever makes the leader look behind, so the largest sample is the best estimate.
+typedef struct {
+    int32_t samples[PEER_PHASE_WINDOW];
+    int count;
+    int next;
+} peer_phase_t;
+
+void peer_phase_reset(peer_phase_t *phase);
+
+// Add a sample and return the current estimate in *estimate_us. Samples
+// beyond +/-max_us are dropped (false): one of the clocks is not really synced.
+bool peer_phase_add(peer_phase_t *phase, int64_t sample_us, int64_t max_us, int32_t *estimate_us);
+
+// Step from applied toward target by at most max_step, so digits never jump
+int32_t peer_phase_slew(int32_t applied, int32_t target, int32_t max_step);
+
+// One clock's view of the group: the leader it follows (or that it leads)
+// and the phase it applies. Times are ms on any monotonic clock.
+typedef struct {
+    uint32_t node_id;
+    uint32_t timeout_ms;        // Take over after this long without beacons
+    int64_t max_phase_us;       // Ignore leaders further off than this
+    int32_t slew_us;            // Max phase change per step
+    uint32_t leader_id;
+    uint8_t leader_stratum;     // PEER_STRATUM_NONE when following no one
+    uint32_t leader_seen_ms;
+    peer_phase_t phase;         // Samples against the leader we follow
+    int32_t applied_us;         // Phase added to the displayed time
+    bool leading;
+} peer_node_t;
+
+void peer_node_init(peer_node_t *node, uint32_t node_id, uint32_t timeout_ms,
+                    int64_t max_phase_us, int32_t slew_us);
+
+// Forget the leader and drop the applied phase (e.g. when the link drops)
+void peer_node_reset(peer_node_t *node);
+
+// Handle a beacon received at local time recv_us. Beacons from clocks that
+// rank below us (own_stratum) or below the leader we follow are ignored.
+// Returns true if the sender is now the leader we follow.
+bool peer_node_receive(peer_node_t *node, const peer_beacon_t *beacon, int64_t recv_us,
+                       uint8_t own_stratum, uint32_t now_ms);
+
+// Once per beacon interval: returns true if this node should send a beacon.
+// A clock takes over when its leader went quiet for timeout_ms or when it
+// now outranks it; without a leader the phase slews back to zero.
+bool peer_node_tick(peer_node_t *node, uint8_t own_stratum, uint32_t now_ms);
+
+#endif // PEER_BEACON_H
@@ -0,0 +1,228 @@
+#include "peer_sync.h"
+#include "peer_beacon.h"
+#include "config.h"
+#include "wifi.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include <string.h>
+
+static const char *TAG = "peer_sync";
+
+#define PEER_SYNC_TASK_STACK    3072
+#define PEER_SYNC_TASK_PRIORITY 5
+
+// Election and phase state, task only; the UI reads the published copies
+static peer_node_t node;
+static uint32_t node_id = 0;
+static volatile bool leading = false;
+static volatile int32_t applied_phase_us = 0;
+
+// The task clears its handle under the lock as it decides to exit, so a
+// start racing with that exit either keeps it running or creates a new one
+static portMUX_TYPE peer_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t peer_task_handle = NULL;
+static volatile bool peer_running = false;
+
+static int64_t get_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static uint8_t own_stratum(void) {
+    ntp_stats_t stats;
+    wifi_get_ntp_stats(&stats);
+    if (!stats.synced || stats.stratum >= PEER_STRATUM_NONE - 1) return PEER_STRATUM_NONE;
+    return stats.stratum + 1;
+}
+
+static void publish(void) {
+    applied_phase_us = node.applied_us;
+    leading = node.leading;
+}
+
+static void handle_beacon(const peer_beacon_t *b, int64_t recv_us) {
+    bool following = node.leader_stratum != PEER_STRATUM_NONE;
+    uint32_t prev_id = node.leader_id;
+    if (!peer_node_receive(&node, b, recv_us, own_stratum(), now_ms())) return;
+
+    if (!following || b->node_id != prev_id) {
+        ESP_LOGI(TAG, "Following peer %08lx (stratum %d)", (unsigned long)b->node_id, b->stratum);
+    }
+    publish();
+}
+
+static int open_socket(struct sockaddr_in *group) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket");
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PEER_SYNC_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Failed to bind UDP port %d", PEER_SYNC_PORT);
+        close(sock);
+        return -1;
+    }
+
+    struct ip_mreq mreq = {
+        .imr_multiaddr.s_addr = inet_addr(PEER_SYNC_GROUP),
+        .imr_interface.s_addr = htonl(INADDR_ANY),
+    };
+    if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        ESP_LOGE(TAG, "Failed to join %s", PEER_SYNC_GROUP);
+        close(sock);
+        return -1;
+    }
+
+    // Stay on the local subnet and don't hear our own beacons
+    uint8_t ttl = 1, loop = 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+    struct timeval timeout = {
+        .tv_sec = PEER_SYNC_BEACON_MS / 1000,
+        .tv_usec = (PEER_SYNC_BEACON_MS % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    memset(group, 0, sizeof(*group));
+    group->sin_family = AF_INET;
+    group->sin_port = htons(PEER_SYNC_PORT);
+    group->sin_addr.s_addr = inet_addr(PEER_SYNC_GROUP);
+    return sock;
+}
+
+static void run_session(int sock, const struct sockaddr_in *group) {
+    uint8_t buf[PEER_BEACON_SIZE];
+    TickType_t last_beacon = 0;
+
+    while (peer_running && wifi_is_connected()) {
+        int len = recvfrom(sock, buf, sizeof(buf), 0, NULL, NULL);
+        int64_t recv_us = get_time_us();
+
+        peer_beacon_t beacon;
+        if (len > 0 && peer_beacon_decode(buf, len, &beacon)) {
+            handle_beacon(&beacon, recv_us);
+        }
+
+        if (xTaskGetTickCount() - last_beacon < pdMS_TO_TICKS(PEER_SYNC_BEACON_MS)) {
+            continue;
+        }
+        last_beacon = xTaskGetTickCount();
+
+        uint8_t mine = own_stratum();
+        bool was_leading = node.leading;
+        bool lead = peer_node_tick(&node, mine, now_ms());
+        publish();
+        if (!lead) continue;
+        if (!was_leading) {
+            ESP_LOGI(TAG, "Leading peer sync (stratum %d)", mine);
+        }
+
+        peer_beacon_t out = {
+            .stratum = mine,
+            .node_id = node.node_id,
+            .time_us = get_time_us(),
+        };
+        peer_beacon_encode(&out, buf);
+        sendto(sock, buf, sizeof(buf), 0, (const struct sockaddr *)group, sizeof(*group));
+    }
+}
+
+static bool keep_running(void) {
+    portENTER_CRITICAL(&peer_lock);
+    bool running = peer_running;
+    if (!running) peer_task_handle = NULL;
+    portEXIT_CRITICAL(&peer_lock);
+    return running;
+}
+
+static void peer_sync_task(void *arg) {
+    ESP_LOGI(TAG, "Peer sync started");
+    peer_node_init(&node, node_id, PEER_SYNC_LEADER_TIMEOUT_MS,
+                   (int64_t)PEER_SYNC_MAX_PHASE_MS * 1000, PEER_SYNC_SLEW_US);
+
+    while (keep_running()) {
+        if (!wifi_is_connected()) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+
+        struct sockaddr_in group;
+        int sock = open_socket(&group);
+        if (sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(5000));
+            continue;
+        }
+
+        run_session(sock, &group);
+        close(sock);
+
+        peer_node_reset(&node);
+        publish();
+    }
+
+    ESP_LOGI(TAG, "Peer sync stopped");
+    vTaskDelete(NULL);
+}
+
+void peer_sync_start(void) {
+    uint8_t mac[6];
+    if (!node_id && esp_read_mac(mac, ESP_MAC_WIFI_STA) == ESP_OK) {
+        node_id = ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    }
+
+    portENTER_CRITICAL(&peer_lock);
+    peer_running = true;
+    bool create = !peer_task_handle;
+    portEXIT_CRITICAL(&peer_lock);
+
+    if (create) {
+        xTaskCreate(peer_sync_task, "peer_sync", PEER_SYNC_TASK_STACK, NULL,
+                    PEER_SYNC_TASK_PRIORITY, &peer_task_handle);
+    }
+}
+
+void peer_sync_stop(void) {
+    peer_running = false;
+}
+
+bool peer_sync_is_running(void) {
+    return peer_running;
+}
+
+void peer_sync_get_time(struct timeval *tv) {
+    gettimeofday(tv, NULL);
+
+    int32_t phase = applied_phase_us;
+    if (phase != 0) {
+        int64_t us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec + phase;
+        tv->tv_sec = us / 1000000;
+        tv->tv_usec = us % 1000000;
+    }
+}
+
+int32_t peer_sync_get_phase_us(void) {
+    return applied_phase_us;
+}
+
+bool peer_sync_is_leader(void) {
+    return leading;
+}
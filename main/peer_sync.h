@@ -0,0 +1,31 @@
+#ifndef PEER_SYNC_H
+#define PEER_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+// Align the displayed second rollover across clocks on the same subnet.
+// The best NTP-synced clock (lowest stratum, then lowest node ID) multicasts
+// beacons; the others measure their phase against it and offset the time
+// they display. The system clock itself is left to NTP.
+
+// Start the beacon task (waits for WiFi before joining the group)
+void peer_sync_start(void);
+
+// Leave the group and show plain system time again (takes effect within
+// one beacon interval)
+void peer_sync_stop(void);
+
+bool peer_sync_is_running(void);
+
+// Current time as it should be displayed (system time plus peer phase)
+void peer_sync_get_time(struct timeval *tv);
+
+// Applied phase correction in microseconds (0 when leading or alone)
+int32_t peer_sync_get_phase_us(void);
+
+// True if this clock is currently sending beacons
+bool peer_sync_is_leader(void);
+
+#endif // PEER_SYNC_H
@@ -0,0 +1,55 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+// Sequence lock for small status structs that one task writes and others
+// poll. Readers never block: they copy the data and retry if a write
+// overlapped the copy. Writers must be serialized by the caller and must not
+// be preempted mid-write (wrap writes in a portMUX critical section), or a
+// higher-priority reader on the same core would spin on the odd sequence.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    atomic_uint seq;    // Odd while a write is in progress
+} seqlock_t;
+
+#define SEQLOCK_INIT { 0 }
+
+static inline void seqlock_write_begin(seqlock_t *sl) {
+    unsigned seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    atomic_store_explicit(&sl->seq, seq + 1, memory_order_relaxed);
+    // Data stores below must not become visible before the odd sequence
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void seqlock_write_end(seqlock_t *sl) {
+    unsigned seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    atomic_store_explicit(&sl->seq, seq + 1, memory_order_release);
+}
+
+static inline unsigned seqlock_read_begin(seqlock_t *sl) {
+    unsigned seq;
+    while ((seq = atomic_load_explicit(&sl->seq, memory_order_acquire)) & 1) {
+        // Writer active; its critical section is a handful of stores
+    }
+    return seq;
+}
+
+static inline bool seqlock_read_retry(seqlock_t *sl, unsigned seq) {
+    // Data loads above must complete before the sequence is rechecked
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&sl->seq, memory_order_relaxed) != seq;
+}
+
+// Copy *src to *dst consistently with respect to writers of sl
+#define SEQLOCK_READ(sl, dst, src) do {                 \
+    unsigned seqlock_seq_;                              \
+    do {                                                \
+        seqlock_seq_ = seqlock_read_begin(sl);          \
+        memcpy((dst), (src), sizeof(*(dst)));           \
+    } while (seqlock_read_retry((sl), seqlock_seq_));   \
+} while (0)
+
+#endif // SEQLOCK_H
@@ -0,0 +1,249 @@
+#include "timekeep.h"
+#include "config.h"
+#include "nvs_config.h"
+#include "seqlock.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_rtc_time.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "timekeep";
+
+#define ANCHOR_MAGIC        0x434C4B31  // "CLK1"
+#define DRIFT_LIMIT_PPB     1000000     // Reject implausible drift (> 1000 ppm)
+#define ERR_BASE_MS         5           // Fixed error of a restored time
+#define ERR_PPM_LEARNED     50          // Error rate once drift is learned
+#define ERR_PPM_UNKNOWN     500         // Error rate of the uncalibrated RTC clock
+
+// Last known UTC paired with the RTC counter at that instant.
+// Lives in RTC memory, which survives soft resets but not power loss.
+typedef struct {
+    uint32_t magic;
+    int64_t utc_us;
+    uint64_t rtc_us;
+    int32_t drift_ppb;
+    bool drift_valid;
+    bool from_ntp;      // Anchor was taken at an NTP sync (usable for drift learning)
+    uint32_t checksum;
+} rtc_anchor_t;
+
+static RTC_NOINIT_ATTR rtc_anchor_t anchor;
+
+// What the UI reads about the current time. Written by the NTP and HTTP
+// tasks, so published through a seqlock like the NTP status; writers
+// serialize on the portMUX.
+typedef struct {
+    time_source_t source;
+    uint64_t restored_rtc_us;   // RTC counter when the estimate was made
+    uint32_t restored_err_ms;   // Error bound at restore time
+    bool drift_valid;
+    int32_t drift_ppb;
+} timekeep_status_t;
+
+static timekeep_status_t status = { .source = TIME_SOURCE_NONE };
+static seqlock_t status_seq = SEQLOCK_INIT;
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t last_nvs_save_us = 0;
+
+static void publish(time_source_t source, uint64_t restored_rtc_us, uint32_t restored_err_ms) {
+    portENTER_CRITICAL(&status_lock);
+    seqlock_write_begin(&status_seq);
+    status.source = source;
+    status.restored_rtc_us = restored_rtc_us;
+    status.restored_err_ms = restored_err_ms;
+    status.drift_valid = anchor.drift_valid;
+    status.drift_ppb = anchor.drift_ppb;
+    seqlock_write_end(&status_seq);
+    portEXIT_CRITICAL(&status_lock);
+}
+
+static void read_status(timekeep_status_t *out) {
+    SEQLOCK_READ(&status_seq, out, &status);
+}
+
+static uint32_t anchor_checksum(const rtc_anchor_t *a) {
+    // FNV-1a over everything before the checksum field
+    const uint8_t *p = (const uint8_t *)a;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(rtc_anchor_t, checksum); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static bool anchor_is_valid(void) {
+    return anchor.magic == ANCHOR_MAGIC && anchor.checksum == anchor_checksum(&anchor);
+}
+
+static void anchor_seal(void) {
+    anchor.magic = ANCHOR_MAGIC;
+    anchor.checksum = anchor_checksum(&anchor);
+}
+
+// Convert an RTC counter interval to true elapsed time using the learned drift
+static int64_t corrected_elapsed_us(uint64_t rtc_elapsed_us) {
+    int64_t elapsed = (int64_t)rtc_elapsed_us;
+    if (anchor.drift_valid) {
+        elapsed += elapsed / 1000 * anchor.drift_ppb / 1000000;
+    }
+    return elapsed;
+}
+
+static void set_system_time_us(int64_t utc_us) {
+    struct timeval tv = {
+        .tv_sec = utc_us / 1000000,
+        .tv_usec = utc_us % 1000000,
+    };
+    settimeofday(&tv, NULL);
+}
+
+static bool system_time_is_valid(void) {
+    time_t now;
+    struct tm timeinfo;
+    time(&now);
+    gmtime_r(&now, &timeinfo);
+    return timeinfo.tm_year + 1900 >= 2025;
+}
+
+void timekeep_init(void) {
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool soft_reset = (reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT);
+    uint64_t rtc_now = esp_rtc_get_time_us();
+    time_source_t source = TIME_SOURCE_NONE;
+    uint32_t restored_err_ms = 0;
+
+    if (!soft_reset || !anchor_is_valid()) {
+        memset(&anchor, 0, sizeof(anchor));
+    }
+
+    // Drift is a property of the board, so keep it across power cycles
+    int64_t saved_utc_us = 0;
+    int32_t saved_drift = 0;
+    bool have_saved = nvs_config_get_saved_time(&saved_utc_us, &saved_drift);
+    if (!anchor.drift_valid && have_saved && saved_drift != 0) {
+        anchor.drift_ppb = saved_drift;
+        anchor.drift_valid = true;
+    }
+
+    if (anchor.magic == ANCHOR_MAGIC && rtc_now >= anchor.rtc_us) {
+        // Soft reset: RTC counter kept running, so extrapolate from the anchor
+        uint64_t rtc_elapsed = rtc_now - anchor.rtc_us;
+        uint32_t err_ppm = anchor.drift_valid ? ERR_PPM_LEARNED : ERR_PPM_UNKNOWN;
+        restored_err_ms = ERR_BASE_MS + (uint32_t)(rtc_elapsed / 1000 * err_ppm / 1000000);
+
+        // ESP-IDF may already have kept system time across the reset
+        if (!system_time_is_valid()) {
+            set_system_time_us(anchor.utc_us + corrected_elapsed_us(rtc_elapsed));
+        }
+        if (anchor.from_ntp) {
+            source = TIME_SOURCE_RTC;
+            ESP_LOGI(TAG, "Restored time from RTC memory (+/-%lu ms, reset reason %d)",
+                     (unsigned long)restored_err_ms, reason);
+        } else {
+            // Anchor itself came from NVS, so the estimate is no better than that
+            restored_err_ms = TIMEKEEP_UNCERTAINTY_UNKNOWN;
+            source = TIME_SOURCE_NVS;
+            ESP_LOGI(TAG, "Restored unsynced time from RTC memory (uncertain)");
+        }
+    } else if (have_saved && saved_utc_us > 0) {
+        // Power cycle: last saved time is only a lower bound
+        set_system_time_us(saved_utc_us);
+        restored_err_ms = TIMEKEEP_UNCERTAINTY_UNKNOWN;
+        source = TIME_SOURCE_NVS;
+
+        anchor.utc_us = saved_utc_us;
+        anchor.rtc_us = rtc_now;
+        anchor.from_ntp = false;
+        ESP_LOGI(TAG, "Restored last saved time from NVS (uncertain)");
+    } else {
+        ESP_LOGI(TAG, "No stored time available");
+    }
+
+    anchor_seal();
+    publish(source, rtc_now, restored_err_ms);
+}
+
+void timekeep_on_sync(const struct timeval *tv) {
+    int64_t utc_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    uint64_t rtc_now = esp_rtc_get_time_us();
+
+    // Learn RTC drift from the span between two NTP-anchored points
+    if (anchor_is_valid() && anchor.from_ntp && rtc_now > anchor.rtc_us) {
+        int64_t rtc_elapsed = (int64_t)(rtc_now - anchor.rtc_us);
+        if (rtc_elapsed >= (int64_t)TIMEKEEP_DRIFT_MIN_SEC * 1000000) {
+            int64_t error_us = (utc_us - anchor.utc_us) - rtc_elapsed;
+            int64_t measured = error_us * 1000 / (rtc_elapsed / 1000000);
+            if (measured > -DRIFT_LIMIT_PPB && measured < DRIFT_LIMIT_PPB) {
+                if (anchor.drift_valid) {
+                    anchor.drift_ppb += (int32_t)((measured - anchor.drift_ppb) / 4);
+                } else {
+                    anchor.drift_ppb = (int32_t)measured;
+                    anchor.drift_valid = true;
+                }
+                ESP_LOGI(TAG, "RTC drift: measured %ld ppb, learned %ld ppb",
+                         (long)measured, (long)anchor.drift_ppb);
+            }
+        }
+    }
+
+    anchor.utc_us = utc_us;
+    anchor.rtc_us = rtc_now;
+    anchor.from_ntp = true;
+    anchor_seal();
+
+    publish(TIME_SOURCE_NTP, rtc_now, 0);
+
+    // Flash writes are rate limited; RTC memory covers soft resets in between
+    if (last_nvs_save_us == 0 ||
+        utc_us - last_nvs_save_us >= (int64_t)TIMEKEEP_NVS_SAVE_SEC * 1000000) {
+        nvs_config_set_saved_time(utc_us, anchor.drift_valid ? anchor.drift_ppb : 0);
+        last_nvs_save_us = utc_us;
+    }
+}
+
+void timekeep_on_coarse_sync(const struct timeval *tv, uint32_t uncertainty_ms) {
+    uint64_t rtc_now = esp_rtc_get_time_us();
+
+    // Keeps soft resets from falling back to an older estimate, but marked
+    // as not NTP so drift is never learned from it
+    anchor.utc_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    anchor.rtc_us = rtc_now;
+    anchor.from_ntp = false;
+    anchor_seal();
+
+    publish(TIME_SOURCE_HTTP, rtc_now, uncertainty_ms);
+}
+
+time_source_t timekeep_get_source(void) {
+    timekeep_status_t current;
+    read_status(&current);
+    return current.source;
+}
+
+bool timekeep_is_estimated(void) {
+    time_source_t source = timekeep_get_source();
+    return source == TIME_SOURCE_RTC || source == TIME_SOURCE_NVS || source == TIME_SOURCE_HTTP;
+}
+
+uint32_t timekeep_get_uncertainty_ms(void) {
+    timekeep_status_t current;
+    read_status(&current);
+    if (current.source == TIME_SOURCE_NTP) return 0;
+    if (current.restored_err_ms == TIMEKEEP_UNCERTAINTY_UNKNOWN) return current.restored_err_ms;
+
+    // Error keeps growing while running free on an unsynced clock
+    uint64_t since_ms = (esp_rtc_get_time_us() - current.restored_rtc_us) / 1000;
+    uint32_t err_ppm = current.drift_valid ? ERR_PPM_LEARNED : ERR_PPM_UNKNOWN;
+    return current.restored_err_ms + (uint32_t)(since_ms * err_ppm / 1000000);
+}
+
+int32_t timekeep_get_drift_ppb(void) {
+    timekeep_status_t current;
+    read_status(&current);
+    return current.drift_valid ? current.drift_ppb : 0;
+}
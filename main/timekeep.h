@@ -0,0 +1,42 @@
+#ifndef TIMEKEEP_H
+#define TIMEKEEP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+// Uncertainty value meaning "unknown" (e.g. time restored after power loss)
+#define TIMEKEEP_UNCERTAINTY_UNKNOWN UINT32_MAX
+
+// Where the current wall-clock time came from
+typedef enum {
+    TIME_SOURCE_NONE,   // No time known yet
+    TIME_SOURCE_RTC,    // Estimated after a soft reset from RTC memory + RTC counter
+    TIME_SOURCE_NVS,    // Last saved time restored after a power cycle (lower bound)
+    TIME_SOURCE_HTTP,   // Coarse time from an HTTP Date header (NTP not reachable yet)
+    TIME_SOURCE_NTP,    // Synchronized by NTP
+} time_source_t;
+
+// Restore an estimated time at boot (call after nvs_config_init)
+void timekeep_init(void);
+
+// Record a successful time sync (UTC that was just applied)
+void timekeep_on_sync(const struct timeval *tv);
+
+// Record a coarse time that was just applied (e.g. HTTP Date header) with
+// its error bound. Not used for drift learning or saved to flash.
+void timekeep_on_coarse_sync(const struct timeval *tv, uint32_t uncertainty_ms);
+
+// Source of the current time
+time_source_t timekeep_get_source(void);
+
+// True if the time is restored or coarse and has not been confirmed by NTP yet
+bool timekeep_is_estimated(void);
+
+// Estimated error bound of the current time in ms (0 once synced)
+uint32_t timekeep_get_uncertainty_ms(void);
+
+// Learned RTC counter drift in parts per billion (0 if not learned yet)
+int32_t timekeep_get_drift_ppb(void);
+
+#endif // TIMEKEEP_H
@@ -6,6 +6,7 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "soc/soc_caps.h"
 
 static const char *TAG = "touch";
 
@@ -16,13 +17,41 @@ static const char *TAG = "touch";
 #define PIN_T_CS    33
 #define PIN_T_IRQ   36
 
-// XPT2046 commands
-#define XPT2046_CMD_X  0xD0  // X position
-#define XPT2046_CMD_Y  0x90  // Y position
+// XPT2046 commands (12-bit, differential reference)
+#define XPT2046_CMD_X   0xD0  // X position
+#define XPT2046_CMD_Y   0x90  // Y position
+#define XPT2046_CMD_Z1  0xB0  // Pressure Z1
+#define XPT2046_CMD_Z2  0xC0  // Pressure Z2
+#define XPT2046_ADC_ON  0x01  // PD0: keep the ADC powered between conversions
+
+// Z1, Z2, the X/Y pairs and a final power-down conversion (which re-enables
+// PENIRQ), overlapped 16 clocks each: the next control byte is shifted out
+// while the previous result is shifted in
+#define BURST_CMDS      (2 + 2 * TOUCH_BURST_SAMPLES + 1)
+#define BURST_BYTES     (2 * BURST_CMDS + 1)
+#define RAW_MAX         4095
+
+// The bus runs without DMA, so a whole burst must fit the SPI data buffer
+_Static_assert(BURST_BYTES <= SOC_SPI_MAXIMUM_BUFFER_SIZE, "TOUCH_BURST_SAMPLES too large for one SPI burst");
 
 
 static spi_device_handle_t touch_spi;
 
+// Active raw-to-screen transform; the default reproduces the linear mapping
+// from TOUCH_MIN/MAX (raw Y drives screen X in landscape)
+#define DEFAULT_SCALE_X (((int32_t)DISPLAY_WIDTH << TOUCH_CAL_SHIFT) / (TOUCH_MAX_Y - TOUCH_MIN_Y))
+#define DEFAULT_SCALE_Y (((int32_t)DISPLAY_HEIGHT << TOUCH_CAL_SHIFT) / (TOUCH_MAX_X - TOUCH_MIN_X))
+static touch_cal_t calibration = {
+    .a = 0, .b = DEFAULT_SCALE_X, .c = -TOUCH_MIN_Y * DEFAULT_SCALE_X,
+    .d = DEFAULT_SCALE_Y, .e = 0, .f = -TOUCH_MIN_X * DEFAULT_SCALE_Y,
+};
+static portMUX_TYPE cal_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Filtered raw position of the current press
+static bool tracking = false;
+static int light_count = 0;      // Consecutive readings below the release pressure
+static int32_t filt_x, filt_y;
+
 void touch_init(void) {
     ESP_LOGI(TAG, "Initializing touch controller");
 
@@ -43,13 +72,13 @@ void touch_init(void) {
         .sclk_io_num = PIN_T_CLK,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = 32,
+        .max_transfer_sz = BURST_BYTES,
     };
     ESP_ERROR_CHECK(spi_bus_initialize(SPI3_HOST, &buscfg, SPI_DMA_DISABLED));
 
     // Add touch device
     spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 1 * 1000 * 1000,  // 1 MHz
+        .clock_speed_hz = TOUCH_SPI_HZ,
         .mode = 0,
         .spics_io_num = PIN_T_CS,
         .queue_size = 1,
@@ -59,20 +88,132 @@ void touch_init(void) {
     ESP_LOGI(TAG, "Touch controller initialized");
 }
 
-static uint16_t touch_read_channel(uint8_t cmd) {
-    uint8_t tx_data[3] = {cmd, 0, 0};
-    uint8_t rx_data[3] = {0};
+// Read Z1, Z2 and TOUCH_BURST_SAMPLES X/Y pairs in one transaction
+static void touch_read_burst(uint16_t *z1, uint16_t *z2, uint16_t *xs, uint16_t *ys) {
+    uint8_t tx_data[BURST_BYTES] = {0};
+    uint8_t rx_data[BURST_BYTES] = {0};
+
+    int n = 0;
+    tx_data[2 * n++] = XPT2046_CMD_Z1 | XPT2046_ADC_ON;
+    tx_data[2 * n++] = XPT2046_CMD_Z2 | XPT2046_ADC_ON;
+    for (int i = 0; i < TOUCH_BURST_SAMPLES; i++) {
+        tx_data[2 * n++] = XPT2046_CMD_X | XPT2046_ADC_ON;
+        tx_data[2 * n++] = XPT2046_CMD_Y | XPT2046_ADC_ON;
+    }
+    tx_data[2 * n++] = XPT2046_CMD_X;   // Result discarded
 
     spi_transaction_t t = {
-        .length = 24,
+        .length = BURST_BYTES * 8,
         .tx_buffer = tx_data,
         .rx_buffer = rx_data,
     };
-
     spi_device_polling_transmit(touch_spi, &t);
 
-    // 12-bit value from bits 1-12 of response
-    return ((rx_data[1] << 8) | rx_data[2]) >> 3;
+    // Result of command i: 12 bits after the busy bit, in bytes 2i+1 and 2i+2
+    #define RESULT(i) ((uint16_t)(((rx_data[2 * (i) + 1] << 8) | rx_data[2 * (i) + 2]) >> 3))
+    *z1 = RESULT(0);
+    *z2 = RESULT(1);
+    for (int i = 0; i < TOUCH_BURST_SAMPLES; i++) {
+        xs[i] = RESULT(2 + 2 * i);
+        ys[i] = RESULT(3 + 2 * i);
+    }
+    #undef RESULT
+}
+
+// Sort in place and return the median; *spread receives max - min
+static uint16_t median(uint16_t *v, int n, uint16_t *spread) {
+    for (int i = 1; i < n; i++) {
+        uint16_t key = v[i];
+        int j = i;
+        while (j > 0 && v[j - 1] > key) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = key;
+    }
+    *spread = v[n - 1] - v[0];
+    return v[n / 2];
+}
+
+static bool near_edge(uint16_t raw) {
+    return raw < TOUCH_RAW_EDGE || raw > RAW_MAX - TOUCH_RAW_EDGE;
+}
+
+void touch_set_calibration(const touch_cal_t *cal) {
+    portENTER_CRITICAL(&cal_lock);
+    calibration = *cal;
+    portEXIT_CRITICAL(&cal_lock);
+}
+
+void touch_cal_apply(const touch_cal_t *cal, uint16_t raw_x, uint16_t raw_y, int32_t *x, int32_t *y) {
+    // 64-bit products: coefficients are not bounded for arbitrary fits
+    *x = (int32_t)(((int64_t)cal->a * raw_x + (int64_t)cal->b * raw_y + cal->c) >> TOUCH_CAL_SHIFT);
+    *y = (int32_t)(((int64_t)cal->d * raw_x + (int64_t)cal->e * raw_y + cal->f) >> TOUCH_CAL_SHIFT);
+}
+
+// Solve the 3x3 system m * v = r by Cramer's rule
+static bool solve3(const double m[3][3], const double r[3], double v[3]) {
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+               - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+               + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (det > -1e-6 && det < 1e-6) return false;
+
+    for (int col = 0; col < 3; col++) {
+        double t[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                t[i][j] = (j == col) ? r[i] : m[i][j];
+            }
+        }
+        v[col] = (t[0][0] * (t[1][1] * t[2][2] - t[1][2] * t[2][1])
+                - t[0][1] * (t[1][0] * t[2][2] - t[1][2] * t[2][0])
+                + t[0][2] * (t[1][0] * t[2][1] - t[1][1] * t[2][0])) / det;
+    }
+    return true;
+}
+
+bool touch_cal_solve(const touch_cal_point_t *points, int n, touch_cal_t *cal) {
+    if (n < 3) return false;
+
+    // Normal equations, shared by both output axes (done once, so floating
+    // point is fine here; the sampling path stays integer)
+    double m[3][3] = {{0}}, rx[3] = {0}, ry[3] = {0};
+    for (int i = 0; i < n; i++) {
+        double u = points[i].raw_x, v = points[i].raw_y;
+        double basis[3] = {u, v, 1.0};
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++) {
+                m[j][k] += basis[j] * basis[k];
+            }
+            rx[j] += basis[j] * points[i].x;
+            ry[j] += basis[j] * points[i].y;
+        }
+    }
+
+    double cx[3], cy[3];
+    if (!solve3(m, rx, cx) || !solve3(m, ry, cy)) return false;
+
+    const double scale = (double)(1 << TOUCH_CAL_SHIFT);
+    cal->a = (int32_t)(cx[0] * scale);
+    cal->b = (int32_t)(cx[1] * scale);
+    cal->c = (int32_t)(cx[2] * scale);
+    cal->d = (int32_t)(cy[0] * scale);
+    cal->e = (int32_t)(cy[1] * scale);
+    cal->f = (int32_t)(cy[2] * scale);
+    return true;
+}
+
+void touch_set_irq_handler(void (*isr)(void *arg), void *arg) {
+    gpio_set_intr_type(PIN_T_IRQ, GPIO_INTR_NEGEDGE);
+    gpio_isr_handler_add(PIN_T_IRQ, isr, arg);
+}
+
+void touch_irq_enable(bool enable) {
+    if (enable) {
+        gpio_intr_enable(PIN_T_IRQ);
+    } else {
+        gpio_intr_disable(PIN_T_IRQ);
+    }
 }
 
 bool touch_is_pressed(void) {
@@ -81,25 +222,56 @@ bool touch_is_pressed(void) {
 
 bool touch_read(touch_point_t *point) {
     if (!touch_is_pressed()) {
+        tracking = false;
         point->pressed = false;
         return false;
     }
 
-    // Take multiple samples and average for stability
-    int32_t sum_x = 0, sum_y = 0;
-    const int samples = 4;
+    uint16_t z1, z2, xs[TOUCH_BURST_SAMPLES], ys[TOUCH_BURST_SAMPLES];
+    touch_read_burst(&z1, &z2, xs, ys);
+
+    uint16_t spread_x, spread_y;
+    uint16_t med_x = median(xs, TOUCH_BURST_SAMPLES, &spread_x);
+    uint16_t med_y = median(ys, TOUCH_BURST_SAMPLES, &spread_y);
+    int32_t pressure = (int32_t)z1 + RAW_MAX - z2;
+    if (z1 == 0) pressure = 0;
+
+    // Pressure hysteresis: a touch starts firm and ends only after several
+    // light readings, so a press that wavers near one threshold can't chatter
+    int32_t threshold = tracking ? TOUCH_RELEASE_PRESSURE : TOUCH_PRESS_PRESSURE;
+    light_count = pressure < threshold ? light_count + 1 : 0;
 
-    for (int i = 0; i < samples; i++) {
-        sum_x += touch_read_channel(XPT2046_CMD_X);
-        sum_y += touch_read_channel(XPT2046_CMD_Y);
+    bool good = pressure >= threshold &&
+                spread_x <= TOUCH_MAX_SPREAD && spread_y <= TOUCH_MAX_SPREAD &&
+                !near_edge(med_x) && !near_edge(med_y);
+    if (!good) {
+        if (!tracking || light_count >= TOUCH_RELEASE_SAMPLES) {
+            // Light contact: not a touch (yet), or the finger has lifted
+            tracking = false;
+            point->pressed = false;
+            return false;
+        }
+        // Unstable or light burst mid-press: keep the last filtered position
+    } else if (!tracking) {
+        filt_x = med_x;
+        filt_y = med_y;
+        tracking = true;
+    } else {
+        filt_x += (med_x - filt_x) >> TOUCH_IIR_SHIFT;
+        filt_y += (med_y - filt_y) >> TOUCH_IIR_SHIFT;
     }
 
-    uint16_t raw_x = sum_x / samples;
-    uint16_t raw_y = sum_y / samples;
+    point->raw_x = filt_x;
+    point->raw_y = filt_y;
+    point->pressure = pressure > 0 ? pressure : 0;
 
-    // Map to screen coordinates (X/Y swapped for landscape orientation)
-    int32_t x = (int32_t)(raw_y - TOUCH_MIN_Y) * DISPLAY_WIDTH / (TOUCH_MAX_Y - TOUCH_MIN_Y);
-    int32_t y = (int32_t)(raw_x - TOUCH_MIN_X) * DISPLAY_HEIGHT / (TOUCH_MAX_X - TOUCH_MIN_X);
+    // Map to screen coordinates
+    touch_cal_t cal;
+    portENTER_CRITICAL(&cal_lock);
+    cal = calibration;
+    portEXIT_CRITICAL(&cal_lock);
+    int32_t x, y;
+    touch_cal_apply(&cal, point->raw_x, point->raw_y, &x, &y);
 
     // Clamp to screen bounds
     if (x < 0) x = 0;
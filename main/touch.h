@@ -8,16 +8,53 @@
 typedef struct {
     int16_t x;
     int16_t y;
+    uint16_t pressure;      // Z1 + 4095 - Z2, larger is firmer
+    uint16_t raw_x;         // Filtered controller readings (for calibration)
+    uint16_t raw_y;
     bool pressed;
 } touch_point_t;
 
+// Raw-to-screen affine transform in 16.16 fixed point, for the unrotated
+// display: x = (a*raw_x + b*raw_y + c) >> 16, y = (d*raw_x + e*raw_y + f) >> 16
+#define TOUCH_CAL_SHIFT 16
+typedef struct {
+    int32_t a, b, c;
+    int32_t d, e, f;
+} touch_cal_t;
+
+// One calibration measurement: raw reading for a known unrotated screen point
+typedef struct {
+    uint16_t raw_x, raw_y;
+    int16_t x, y;
+} touch_cal_point_t;
+
 // Initialize the XPT2046 touch controller
 void touch_init(void);
 
-// Read current touch state (returns true if touched)
+// Sample the panel (one SPI burst) and return the filtered position.
+// Returns true if touched; light or unstable contacts read as not touched
+// until a press is established, then hold the last good position.
 bool touch_read(touch_point_t *point);
 
+// Replace the transform (the default is derived from TOUCH_MIN/MAX in config.h)
+void touch_set_calibration(const touch_cal_t *cal);
+
+// Least-squares fit of the transform to n >= 3 measurements. Returns false if
+// the points are degenerate (e.g. collinear).
+bool touch_cal_solve(const touch_cal_point_t *points, int n, touch_cal_t *cal);
+
+// Apply a transform to a raw reading (unrotated screen coordinates, unclamped)
+void touch_cal_apply(const touch_cal_t *cal, uint16_t raw_x, uint16_t raw_y, int32_t *x, int32_t *y);
+
 // Check if screen is currently being touched (non-blocking)
 bool touch_is_pressed(void);
 
+// Call isr from interrupt context when PENIRQ goes low (a touch starts).
+// The GPIO ISR service must be installed first.
+void touch_set_irq_handler(void (*isr)(void *arg), void *arg);
+
+// Mask PENIRQ while a contact is polled: every sampling burst ends with a
+// command that re-arms PENIRQ, which would fire again under the finger
+void touch_irq_enable(bool enable);
+
 #endif // TOUCH_H
@@ -1,7 +1,7 @@
 #include "ui_about.h"
 #include "config.h"
 #include "display.h"
-#include "touch.h"
+#include "input.h"
 #include "wifi.h"
 #include "ui_common.h"
 #include "esp_log.h"
@@ -13,10 +13,16 @@ static const char *TAG = "ui_about";
 
 #define URL "github.com/timdoug/cyd_clock"
 
+// Touch calibration button, right side of the header
+#define CAL_BTN_W   40
+#define CAL_BTN_X   (DISPLAY_WIDTH - UI_BACK_BTN_X - CAL_BTN_W)
+
 static bool touched_last = false;
 
 static void draw_screen(void) {
     ui_draw_header("About", true);
+    display_fill_rect(CAL_BTN_X, 5, CAL_BTN_W, 20, UI_COLOR_ITEM_BG);
+    display_string(CAL_BTN_X + 8, UI_HEADER_TEXT_Y, "Cal", COLOR_WHITE, UI_COLOR_ITEM_BG);
 
     // Content
     int y = 50;
@@ -49,6 +55,23 @@ static void draw_screen(void) {
     wifi_get_mac_str(mac_str, sizeof(mac_str));
     display_string(20, y, "MAC:", COLOR_GRAY, COLOR_BLACK);
     display_string(90, y, mac_str, COLOR_WHITE, COLOR_BLACK);
+    y += 20;
+
+    char outage_str[32];
+    wifi_outage_stats_t outages;
+    wifi_get_outage_stats(&outages);
+    if (outages.active) {
+        snprintf(outage_str, sizeof(outage_str), "%lu (down %lus)",
+                 (unsigned long)outages.count, (unsigned long)(outages.current_ms / 1000));
+    } else if (outages.count > 0) {
+        snprintf(outage_str, sizeof(outage_str), "%lu (last %lus, max %lus)",
+                 (unsigned long)outages.count, (unsigned long)(outages.last_ms / 1000),
+                 (unsigned long)(outages.longest_ms / 1000));
+    } else {
+        snprintf(outage_str, sizeof(outage_str), "None");
+    }
+    display_string(20, y, "Outages:", COLOR_GRAY, COLOR_BLACK);
+    display_string(90, y, outage_str, COLOR_WHITE, COLOR_BLACK);
 }
 
 void ui_about_init(void) {
@@ -61,7 +84,7 @@ void ui_about_init(void) {
 
 about_result_t ui_about_update(void) {
     touch_point_t touch;
-    bool touched = touch_read(&touch);
+    bool touched = input_get_touch(&touch);
 
     // Only respond on touch down
     if (touched && !touched_last) {
@@ -70,6 +93,11 @@ about_result_t ui_about_update(void) {
             touched_last = touched;
             return ABOUT_RESULT_BACK;
         }
+        // Touch calibration
+        if (touch.y < UI_HEADER_HEIGHT && touch.x >= CAL_BTN_X) {
+            touched_last = touched;
+            return ABOUT_RESULT_CALIBRATE;
+        }
     }
 
     touched_last = touched;
@@ -4,6 +4,7 @@
 typedef enum {
     ABOUT_RESULT_NONE,
     ABOUT_RESULT_BACK,
+    ABOUT_RESULT_CALIBRATE,
 } about_result_t;
 
 void ui_about_init(void);
@@ -4,10 +4,13 @@
 #include "led.h"
 #include "wifi.h"
 #include "nvs_config.h"
+#include "timekeep.h"
+#include "peer_sync.h"
 #include "ui_common.h"
 #include "esp_log.h"
-#include "driver/gpio.h"
+#include "esp_netif.h"
 #include <time.h>
+#include <sys/time.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -38,6 +41,8 @@ static int last_sec = -1;
 static int last_day = -1;
 static bool colon_visible = true;
 static bool last_synced_state = false;
+static bool last_estimated_state = false;
+static uint32_t last_server_ip = 0;
 static int last_stats_sec = -1;
 static uint8_t led_brightness = BRIGHTNESS_DEFAULT;
 static bool last_time_valid = false;
@@ -57,6 +62,8 @@ static void reset_display_state(void) {
     last_sec = -1;
     last_day = -1;
     last_synced_state = false;
+    last_estimated_state = false;
+    last_server_ip = 0;
     last_stats_sec = -1;
     last_time_valid = false;
 }
@@ -120,10 +127,11 @@ static void draw_colon(int position, bool visible) {
 }
 
 void ui_clock_update(void) {
-    time_t now;
+    struct timeval tv;
     struct tm timeinfo;
 
-    time(&now);
+    peer_sync_get_time(&tv);
+    time_t now = tv.tv_sec;
     localtime_r(&now, &timeinfo);
 
     // Check if time is valid (year >= 2025)
@@ -207,16 +215,30 @@ void ui_clock_update(void) {
     wifi_get_ntp_stats(&stats);
 
     // Line 1: Sync status with server
-    if (stats.synced != last_synced_state || last_stats_sec < 0) {
+    bool estimated = timekeep_is_estimated();
+    if (stats.synced != last_synced_state || estimated != last_estimated_state ||
+        stats.server_ip != last_server_ip || last_stats_sec < 0) {
         char status_str[48];
-        if (stats.synced) {
+        if (stats.synced && stats.server_from_dhcp) {
+            esp_ip4_addr_t ip = { .addr = stats.server_ip };
+            snprintf(status_str, sizeof(status_str), "NTP: " IPSTR " (DHCP)", IP2STR(&ip));
+            ui_draw_centered_string(STATS_Y, status_str, COLOR_SYNC_OK, COLOR_BLACK, false);
+        } else if (stats.synced) {
             snprintf(status_str, sizeof(status_str), "NTP: %s", stats.server);
             ui_draw_centered_string(STATS_Y, status_str, COLOR_SYNC_OK, COLOR_BLACK, false);
         } else {
-            snprintf(status_str, sizeof(status_str), "Syncing: %s", wifi_get_custom_ntp_server());
+            char server[NTP_SERVER_NAME_LEN];
+            wifi_get_custom_ntp_server(server, sizeof(server));
+            if (estimated) {
+                snprintf(status_str, sizeof(status_str), "Estimated, syncing: %s", server);
+            } else {
+                snprintf(status_str, sizeof(status_str), "Syncing: %s", server);
+            }
             ui_draw_centered_string(STATS_Y, status_str, COLOR_SYNC_WAIT, COLOR_BLACK, false);
         }
         last_synced_state = stats.synced;
+        last_estimated_state = estimated;
+        last_server_ip = stats.server_ip;
     }
 
     // Line 2 & 3: Update stats display every second
@@ -263,16 +285,27 @@ void ui_clock_update(void) {
             // Not synced - show elapsed time on line 2
             char line2[48];
             uint32_t elapsed_sec = stats.sync_elapsed_ms / 1000;
-            snprintf(line2, sizeof(line2), "Waiting: %lus", (unsigned long)elapsed_sec);
+            if (estimated) {
+                uint32_t err_ms = timekeep_get_uncertainty_ms();
+                if (err_ms == TIMEKEEP_UNCERTAINTY_UNKNOWN) {
+                    snprintf(line2, sizeof(line2), "Waiting: %lus  Error: unknown",
+                             (unsigned long)elapsed_sec);
+                } else {
+                    snprintf(line2, sizeof(line2), "Waiting: %lus  Error: +/-%lums",
+                             (unsigned long)elapsed_sec, (unsigned long)err_ms);
+                }
+            } else {
+                snprintf(line2, sizeof(line2), "Waiting: %lus", (unsigned long)elapsed_sec);
+            }
             ui_draw_centered_string(STATS_LINE2, line2, COLOR_STATS, COLOR_BLACK, false);
             ui_draw_centered_string(STATS_LINE3, "", COLOR_BLACK, COLOR_BLACK, false);
         }
     }
 }
 
-clock_touch_zone_t ui_clock_check_touch(void) {
-    // BOOT button (active low) opens settings
-    if (gpio_get_level(BOOT_BUTTON_GPIO) == 0) {
+clock_touch_zone_t ui_clock_check_touch(const input_event_t *event) {
+    // BOOT button opens settings
+    if (event->type == INPUT_BUTTON_PRESS) {
         return CLOCK_TOUCH_SETTINGS;
     }
     return CLOCK_TOUCH_NONE;
@@ -2,6 +2,7 @@
 #define UI_CLOCK_H
 
 #include <stdbool.h>
+#include "input.h"
 
 // Touch zone identifiers
 typedef enum {
@@ -18,7 +19,7 @@ void ui_clock_update(void);
 // Force full redraw of clock
 void ui_clock_redraw(void);
 
-// Check for touch and return which zone was touched
-clock_touch_zone_t ui_clock_check_touch(void);
+// Map an input event to the zone it activates
+clock_touch_zone_t ui_clock_check_touch(const input_event_t *event);
 
 #endif // UI_CLOCK_H
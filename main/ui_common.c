@@ -1,7 +1,9 @@
 #include "ui_common.h"
 #include "display.h"
-#include "touch.h"
+#include "input.h"
+#include "app_event.h"
 #include "config.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
@@ -45,72 +47,64 @@ void ui_draw_centered_string(int16_t y, const char *str, uint16_t fg, uint16_t b
     }
 }
 
-void ui_draw_list(const char **labels, int count, int scroll_offset, int selected) {
-    display_fill_rect(0, UI_LIST_START_Y, DISPLAY_WIDTH, DISPLAY_HEIGHT - UI_LIST_START_Y, COLOR_BLACK);
-
-    for (int i = 0; i < UI_LIST_VISIBLE && (i + scroll_offset) < count; i++) {
-        int idx = i + scroll_offset;
-        int y = UI_LIST_START_Y + i * UI_LIST_ITEM_H;
-
-        uint16_t bg = (idx == selected) ? UI_COLOR_SELECTED : COLOR_BLACK;
-        uint16_t fg = (idx == selected) ? COLOR_BLACK : COLOR_WHITE;
-
-        display_fill_rect(0, y, DISPLAY_WIDTH, UI_LIST_ITEM_H - 2, bg);
-        display_string(10, y + 6, labels[idx], fg, bg);
-    }
-
-    // Scroll indicators
-    if (scroll_offset > 0) {
-        display_string(DISPLAY_WIDTH / 2 - 4, UI_LIST_START_Y - 8, "^", COLOR_GRAY, COLOR_BLACK);
+void ui_wait_for_touch_release(void) {
+    // Input from the held touch is dropped; status events that arrive
+    // meanwhile are posted again afterwards (coalesced, so once per type)
+    unsigned deferred = 0;
+    app_event_t event;
+    while (input_touch_is_down()) {
+        if (app_event_wait(&event, portMAX_DELAY) && event.type != APP_EVENT_INPUT) {
+            deferred |= 1u << event.type;
+        }
     }
-    if (scroll_offset + UI_LIST_VISIBLE < count) {
-        display_string(DISPLAY_WIDTH / 2 - 4, UI_LIST_START_Y + UI_LIST_VISIBLE * UI_LIST_ITEM_H, "v", COLOR_GRAY, COLOR_BLACK);
+    for (unsigned type = 0; deferred; type++, deferred >>= 1) {
+        if (deferred & 1) app_event_post((app_event_type_t)type);
     }
 }
 
-void ui_wait_for_touch_release(void) {
-    while (touch_is_pressed()) {
-        vTaskDelay(pdMS_TO_TICKS(TOUCH_RELEASE_POLL_MS));
-    }
+void ui_request_frame(void) {
+    app_event_wake_after(UI_FRAME_MS);
 }
 
-bool ui_should_debounce(uint32_t last_time_ticks) {
-    uint32_t now = xTaskGetTickCount();
-    return (now - last_time_ticks) < pdMS_TO_TICKS(TOUCH_DEBOUNCE_MS);
-}
+// Last touch-down handed out by ui_read_touch(); shared by every screen so a
+// press is consumed once, by whichever screen was showing when it happened
+static uint32_t press_seen = 0;
+
+bool ui_read_touch(touch_point_t *touch) {
+    uint32_t count = input_press_count();
+    int64_t now = esp_timer_get_time();
 
-bool ui_read_touch(touch_point_t *touch, uint32_t *last_time_ticks) {
-    bool touched = touch_read(touch);
-    if (touched && ui_should_debounce(*last_time_ticks)) {
-        return false;
+    if (count - press_seen > INPUT_PRESS_HISTORY) {
+        press_seen = count - INPUT_PRESS_HISTORY;
     }
-    if (touched) {
-        *last_time_ticks = xTaskGetTickCount();
+    while (press_seen != count) {
+        press_seen++;
+        int64_t time_us;
+        if (input_get_press(press_seen, touch, &time_us) &&
+            now - time_us < (int64_t)TOUCH_PRESS_MAX_AGE_MS * 1000) {
+            wifi_power_boost();
+            return true;
+        }
     }
-    return touched;
-}
-
-void ui_draw_menu_item(int y, const char *label) {
-    display_fill_rect(0, y, DISPLAY_WIDTH, UI_ITEM_HEIGHT - 3, UI_COLOR_ITEM_BG);
-    display_string(10, y + UI_TEXT_Y_OFFSET, label, UI_COLOR_ITEM_FG, UI_COLOR_ITEM_BG);
-    display_string(DISPLAY_WIDTH - 18, y + UI_TEXT_Y_OFFSET, ">", UI_COLOR_ITEM_FG, UI_COLOR_ITEM_BG);
+    return false;
 }
 
-void ui_draw_slider(int y, const char *label, uint8_t value, uint8_t max_value, uint16_t fill_color) {
-    display_fill_rect(0, y, DISPLAY_WIDTH, UI_ITEM_HEIGHT - 3, UI_COLOR_ITEM_BG);
-    display_string(10, y + UI_TEXT_Y_OFFSET, label, UI_COLOR_ITEM_FG, UI_COLOR_ITEM_BG);
-
-    int bar_y = y + UI_TEXT_Y_OFFSET;
-    display_fill_rect(UI_SLIDER_BAR_X, bar_y, UI_SLIDER_BAR_W, UI_SLIDER_BAR_H, COLOR_BLACK);
-    display_rect(UI_SLIDER_BAR_X, bar_y, UI_SLIDER_BAR_W, UI_SLIDER_BAR_H, COLOR_GRAY);
-    int fill_w = (value * (UI_SLIDER_BAR_W - 4)) / max_value;
-    display_fill_rect(UI_SLIDER_BAR_X + 2, bar_y + 2, fill_w, UI_SLIDER_BAR_H - 4, fill_color);
-
-    // Minus button
-    display_fill_rect(UI_SLIDER_BTN_X1, y + 3, UI_SLIDER_BTN_W, UI_SLIDER_BTN_H, COLOR_GRAY);
-    display_string(UI_SLIDER_BTN_X1 + 6, y + 4, "-", COLOR_WHITE, COLOR_GRAY);
-
-    // Plus button
-    display_fill_rect(UI_SLIDER_BTN_X2, y + 3, UI_SLIDER_BTN_W, UI_SLIDER_BTN_H, COLOR_GRAY);
-    display_string(UI_SLIDER_BTN_X2 + 6, y + 4, "+", COLOR_WHITE, COLOR_GRAY);
+void ui_draw_connect_progress(int16_t y, wifi_connect_state_t state) {
+    switch (state) {
+        case WIFI_CONNECT_ASSOCIATING:
+            ui_draw_centered_string(y, "Joining network...", COLOR_GRAY, COLOR_BLACK, false);
+            break;
+        case WIFI_CONNECT_DHCP:
+            ui_draw_centered_string(y, "Getting IP address...", COLOR_GRAY, COLOR_BLACK, false);
+            break;
+        case WIFI_CONNECT_DONE:
+            ui_draw_centered_string(y, "Connected!", COLOR_GREEN, COLOR_BLACK, false);
+            break;
+        case WIFI_CONNECT_FAILED:
+            ui_draw_centered_string(y, "Connection failed", COLOR_RED, COLOR_BLACK, false);
+            break;
+        default:
+            ui_draw_centered_string(y, "", COLOR_GRAY, COLOR_BLACK, false);
+            break;
+    }
 }
@@ -3,7 +3,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"
 #include "touch.h"
+#include "wifi.h"
 
 // Common UI layout constants
 #define UI_HEADER_HEIGHT    30
@@ -34,39 +36,27 @@
 #define VKEY_ENTER      '\x0D'
 #define VKEY_ESCAPE     '\x1B'
 
-// Slider layout constants (for hit-testing in callers)
-#define UI_SLIDER_BAR_X     100
-#define UI_SLIDER_BAR_W     150
-#define UI_SLIDER_BAR_H     14
-#define UI_SLIDER_BTN_X1    260   // Minus button x
-#define UI_SLIDER_BTN_X2    288   // Plus button x
-#define UI_SLIDER_BTN_W     22
-#define UI_SLIDER_BTN_H     18
-
 // Draw a standard header bar with centered title
 // If show_back is true, shows a "Back" button on the left
 void ui_draw_header(const char *title, bool show_back);
 
-// Draw a menu item with label and ">" arrow
-void ui_draw_menu_item(int y, const char *label);
-
-// Draw a labeled slider with +/- buttons
-void ui_draw_slider(int y, const char *label, uint8_t value, uint8_t max_value, uint16_t fill_color);
-
 // Draw a centered string with full-width background (no pre-clear needed)
 // height: 16 for 1x scale, 32 for 2x scale
 void ui_draw_centered_string(int16_t y, const char *str, uint16_t fg, uint16_t bg, bool scale_2x);
 
-// Draw a scrollable list with selection highlight and scroll indicators
-void ui_draw_list(const char **labels, int count, int scroll_offset, int selected);
+// Draw a one-line description of WiFi connect progress, centered at y
+void ui_draw_connect_progress(int16_t y, wifi_connect_state_t state);
 
-// Wait for touch release (blocks until finger lifted)
+// Wait for touch release (blocks until finger lifted); other events stay pending
 void ui_wait_for_touch_release(void);
 
-// Check if touch should be debounced (returns true if too soon since last_time)
-bool ui_should_debounce(uint32_t last_time_ticks);
+// Have the current screen updated again after one frame even if nothing
+// else happens (for animations). Requests last for one update.
+void ui_request_frame(void);
 
-// Read touch with debouncing. Updates last_time_ticks and returns debounced touch state.
-bool ui_read_touch(touch_point_t *touch, uint32_t *last_time_ticks);
+// Edge-triggered touch: returns true once per touch-down, with the position
+// where the finger landed. Touch-downs that arrived since the last call are
+// returned one per call, in order, unless they are stale.
+bool ui_read_touch(touch_point_t *touch);
 
 #endif // UI_COMMON_H
@@ -0,0 +1,207 @@
+#include "ui_list.h"
+#include "ui_common.h"
+#include "config.h"
+#include "display.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+
+#define LIST_TOP        UI_LIST_START_Y
+#define LIST_HEIGHT     (UI_LIST_VISIBLE * UI_LIST_ITEM_H)
+#define STRIP_ROWS      16
+#define SCROLLBAR_W     3
+
+// One strip of the list window, reused for every band
+static uint16_t strip[DISPLAY_WIDTH * STRIP_ROWS];
+
+void ui_canvas_fill_rect(ui_canvas_t *canvas, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    int16_t y0 = y < canvas->y ? canvas->y : y;
+    int16_t y1 = y + h > canvas->y + canvas->h ? canvas->y + canvas->h : y + h;
+    int16_t x0 = x < 0 ? 0 : x;
+    int16_t x1 = x + w > DISPLAY_WIDTH ? DISPLAY_WIDTH : x + w;
+    uint16_t px = DISPLAY_PIXEL(color);
+
+    for (int16_t row = y0; row < y1; row++) {
+        uint16_t *line = &canvas->pixels[(row - canvas->y) * DISPLAY_WIDTH];
+        for (int16_t col = x0; col < x1; col++) {
+            line[col] = px;
+        }
+    }
+}
+
+void ui_canvas_string(ui_canvas_t *canvas, int16_t x, int16_t y, const char *str, uint16_t fg, uint16_t bg) {
+    int16_t y0 = y < canvas->y ? canvas->y : y;
+    int16_t y1 = y + CHAR_HEIGHT > canvas->y + canvas->h ? canvas->y + canvas->h : y + CHAR_HEIGHT;
+    uint16_t fg_px = DISPLAY_PIXEL(fg);
+    uint16_t bg_px = DISPLAY_PIXEL(bg);
+
+    for (; *str && x + CHAR_WIDTH <= DISPLAY_WIDTH; str++, x += CHAR_WIDTH) {
+        if (x < 0) continue;
+        const uint8_t *glyph = display_glyph(*str);
+        for (int16_t row = y0; row < y1; row++) {
+            uint8_t bits = glyph[row - y];
+            uint16_t *p = &canvas->pixels[(row - canvas->y) * DISPLAY_WIDTH + x];
+            for (int col = 0; col < CHAR_WIDTH; col++, bits <<= 1) {
+                p[col] = (bits & 0x80) ? fg_px : bg_px;
+            }
+        }
+    }
+}
+
+static int32_t max_scroll(const ui_list_t *list) {
+    int32_t max = list->count * UI_LIST_ITEM_H - LIST_HEIGHT;
+    return max > 0 ? max : 0;
+}
+
+static int32_t scroll_px(const ui_list_t *list) {
+    return list->scroll_q8 >> 8;
+}
+
+// Move by delta list pixels; returns false if it hit either end
+static bool scroll_by_q8(ui_list_t *list, int32_t delta_q8) {
+    int32_t limit = max_scroll(list) << 8;
+    list->scroll_q8 += delta_q8;
+    if (list->scroll_q8 < 0) {
+        list->scroll_q8 = 0;
+        return false;
+    }
+    if (list->scroll_q8 > limit) {
+        list->scroll_q8 = limit;
+        return false;
+    }
+    return true;
+}
+
+static void draw_scrollbar(ui_canvas_t *canvas, const ui_list_t *list, int32_t scroll) {
+    int32_t total = list->count * UI_LIST_ITEM_H;
+    if (total <= LIST_HEIGHT) return;
+
+    int16_t thumb_h = LIST_HEIGHT * LIST_HEIGHT / total;
+    if (thumb_h < 10) thumb_h = 10;
+    int16_t thumb_y = LIST_TOP + (int32_t)(LIST_HEIGHT - thumb_h) * scroll / max_scroll(list);
+    ui_canvas_fill_rect(canvas, DISPLAY_WIDTH - SCROLLBAR_W, thumb_y, SCROLLBAR_W, thumb_h, COLOR_GRAY);
+}
+
+static void render(ui_list_t *list) {
+    int32_t scroll = scroll_px(list);
+
+    for (int16_t band = LIST_TOP; band < LIST_TOP + LIST_HEIGHT; band += STRIP_ROWS) {
+        ui_canvas_t canvas = {
+            .pixels = strip,
+            .y = band,
+            .h = LIST_TOP + LIST_HEIGHT - band < STRIP_ROWS ? LIST_TOP + LIST_HEIGHT - band : STRIP_ROWS,
+        };
+        ui_canvas_fill_rect(&canvas, 0, canvas.y, DISPLAY_WIDTH, canvas.h, COLOR_BLACK);
+
+        // Rows overlapping this band
+        int first = (band - LIST_TOP + scroll) / UI_LIST_ITEM_H;
+        int last = (band + canvas.h - 1 - LIST_TOP + scroll) / UI_LIST_ITEM_H;
+        for (int idx = first; idx <= last && idx < list->count; idx++) {
+            int16_t y = LIST_TOP + idx * UI_LIST_ITEM_H - scroll;
+            uint16_t bg = (idx == list->selected) ? UI_COLOR_SELECTED : COLOR_BLACK;
+            uint16_t fg = (idx == list->selected) ? COLOR_BLACK : COLOR_WHITE;
+
+            ui_canvas_fill_rect(&canvas, 0, y, DISPLAY_WIDTH, UI_LIST_ITEM_H - 2, bg);
+            ui_canvas_string(&canvas, 10, y + 6, list->labels[idx], fg, bg);
+            if (list->decorate) {
+                list->decorate(&canvas, idx, y, fg, bg);
+            }
+        }
+
+        draw_scrollbar(&canvas, list, scroll);
+        display_blit(0, canvas.y, DISPLAY_WIDTH, canvas.h, strip);
+    }
+
+    list->drawn_scroll = scroll;
+}
+
+void ui_list_init(ui_list_t *list, const char *const *labels, int count, int selected,
+                  ui_list_decorate_fn decorate) {
+    list->labels = labels;
+    list->count = count;
+    list->selected = selected;
+    list->decorate = decorate;
+    list->velocity = 0;
+    list->last_frame_us = 0;
+
+    // Center the selected row if possible
+    list->scroll_q8 = 0;
+    if (selected >= 0) {
+        scroll_by_q8(list, ((selected - UI_LIST_VISIBLE / 2) * UI_LIST_ITEM_H) << 8);
+    }
+
+    gesture_reset();
+    render(list);
+}
+
+void ui_list_set_items(ui_list_t *list, const char *const *labels, int count) {
+    list->labels = labels;
+    list->count = count;
+    if (list->selected >= count) list->selected = -1;
+    scroll_by_q8(list, 0);  // Re-clamp
+    list->drawn_scroll = -1;
+}
+
+void ui_list_invalidate(ui_list_t *list) {
+    list->drawn_scroll = -1;
+}
+
+int ui_list_handle(ui_list_t *list, const gesture_t *gesture) {
+    switch (gesture->type) {
+        case GESTURE_DRAG_START:
+            list->velocity = 0;     // Catch a list that is still coasting
+            break;
+
+        case GESTURE_DRAG:
+            // Content follows the finger
+            scroll_by_q8(list, -(int32_t)gesture->dy << 8);
+            break;
+
+        case GESTURE_FLING:
+            list->velocity = -gesture->vy;
+            list->last_frame_us = esp_timer_get_time();
+            break;
+
+        case GESTURE_TAP:
+            if (list->velocity != 0) {
+                list->velocity = 0;     // First tap only stops the list
+                break;
+            }
+            if (gesture->y >= LIST_TOP && gesture->y < LIST_TOP + LIST_HEIGHT) {
+                int idx = (gesture->y - LIST_TOP + scroll_px(list)) / UI_LIST_ITEM_H;
+                if (idx < list->count) return idx;
+            } else if (gesture->y >= LIST_TOP + LIST_HEIGHT) {
+                scroll_by_q8(list, (int32_t)UI_LIST_ITEM_H << 8);
+            } else if (gesture->y >= UI_HEADER_HEIGHT) {
+                scroll_by_q8(list, -((int32_t)UI_LIST_ITEM_H << 8));
+            }
+            break;
+
+        default:
+            break;
+    }
+    return -1;
+}
+
+void ui_list_update(ui_list_t *list) {
+    if (list->velocity != 0) {
+        int64_t now = esp_timer_get_time();
+        int64_t dt = now - list->last_frame_us;
+        if (dt > UI_FRAME_MS * 4000) dt = UI_FRAME_MS * 4000;  // After a stall, don't jump
+        list->last_frame_us = now;
+
+        bool moving = scroll_by_q8(list, (int32_t)((int64_t)list->velocity * 256 * dt / 1000000));
+
+        // Exponential decay: dv = -v * dt / tau
+        list->velocity -= (int32_t)((int64_t)list->velocity * dt / (UI_LIST_DECAY_MS * 1000));
+        if (!moving || abs(list->velocity) < UI_LIST_STOP_PX_S) {
+            list->velocity = 0;
+        } else {
+            ui_request_frame();
+        }
+    }
+
+    // Only latest position is drawn; drags that arrived meanwhile were merged
+    if (scroll_px(list) != list->drawn_scroll) {
+        render(list);
+    }
+}
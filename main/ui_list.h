@@ -0,0 +1,53 @@
+#ifndef UI_LIST_H
+#define UI_LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gesture.h"
+
+// Pixel-scrolled list with drag and inertial scrolling. Rows are composed in
+// a RAM strip and sent to the panel in a few transfers per frame, so moving
+// content never flickers through a cleared background.
+
+// A band of full-width screen rows [y, y + h) being composed
+typedef struct {
+    uint16_t *pixels;       // Panel byte order, DISPLAY_WIDTH per row
+    int16_t y;
+    int16_t h;
+} ui_canvas_t;
+
+void ui_canvas_fill_rect(ui_canvas_t *canvas, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+void ui_canvas_string(ui_canvas_t *canvas, int16_t x, int16_t y, const char *str, uint16_t fg, uint16_t bg);
+
+// Extra per-row drawing; y is the row's top in screen coordinates
+typedef void (*ui_list_decorate_fn)(ui_canvas_t *canvas, int index, int16_t y, uint16_t fg, uint16_t bg);
+
+typedef struct {
+    const char *const *labels;
+    int count;
+    int selected;                   // Highlighted row, -1 for none
+    ui_list_decorate_fn decorate;   // Optional
+    int32_t scroll_q8;              // Window top in list pixels, 24.8 fixed point
+    int32_t velocity;               // Inertial scroll speed, list px/s
+    int64_t last_frame_us;
+    int32_t drawn_scroll;           // Scroll position on screen, -1 to force a redraw
+} ui_list_t;
+
+// Set up the list with the selected row centered if possible, and draw it
+void ui_list_init(ui_list_t *list, const char *const *labels, int count, int selected,
+                  ui_list_decorate_fn decorate);
+
+// Replace the items (e.g. new scan results), keeping the scroll position
+void ui_list_set_items(ui_list_t *list, const char *const *labels, int count);
+
+// Apply a gesture. Returns the tapped row index, or -1.
+int ui_list_handle(ui_list_t *list, const gesture_t *gesture);
+
+// Advance inertia and redraw if the content moved. Call every update;
+// requests fast frames while the list is still moving.
+void ui_list_update(ui_list_t *list);
+
+// Force a full redraw on the next update
+void ui_list_invalidate(ui_list_t *list);
+
+#endif // UI_LIST_H
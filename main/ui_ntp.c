@@ -1,10 +1,14 @@
 #include "ui_ntp.h"
 #include "ui_common.h"
 #include "ui_keyboard.h"
+#include "ui_widget.h"
 #include "config.h"
 #include "display.h"
 #include "touch.h"
 #include "wifi.h"
+#include "ntp_server.h"
+#include "peer_sync.h"
+#include "http_time.h"
 #include "nvs_config.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -25,7 +29,7 @@ static const char *keyboard_rows[] = {
     "1234567890",
     "qwertyuiop",
     "asdfghjkl.",
-    "zxcvbnm-_",
+    "zxcvbnm-_:",
 };
 
 // UI state
@@ -34,10 +38,16 @@ typedef enum {
     NTP_STATE_KEYBOARD,
 } ntp_ui_state_t;
 
+// Which setting the keyboard is editing
+typedef enum {
+    EDIT_NTP_SERVER,
+    EDIT_HTTP_HOST,
+} ntp_edit_field_t;
+
 static ntp_ui_state_t ui_state = NTP_STATE_MAIN;
-static uint32_t last_touch_time = 0;
-static char custom_server[64] = {0};
-static int custom_server_len = 0;
+static ntp_edit_field_t edit_field = EDIT_NTP_SERVER;
+static char edit_buf[64] = {0};
+static int edit_len = 0;
 
 static int find_interval_idx(uint32_t interval) {
     for (int i = 0; i < NUM_INTERVALS; i++) {
@@ -67,22 +77,32 @@ static void draw_keyboard(void) {
     display_string(254, y + 3, "Done", COLOR_BLACK, COLOR_GREEN);
 }
 
+static void load_edit_buf(void) {
+    if (edit_field == EDIT_HTTP_HOST) {
+        strncpy(edit_buf, http_time_get_host(), sizeof(edit_buf) - 1);
+        edit_buf[sizeof(edit_buf) - 1] = '\0';
+    } else {
+        wifi_get_custom_ntp_server(edit_buf, sizeof(edit_buf));
+    }
+    edit_len = strlen(edit_buf);
+}
+
 static void draw_server_input(void) {
     display_fill_rect(0, 35, DISPLAY_WIDTH, 30, COLOR_BLACK);
-    display_string(10, 38, "Server:", COLOR_GRAY, COLOR_BLACK);
+    display_string(10, 38, edit_field == EDIT_HTTP_HOST ? "Host[:port]:" : "Server:", COLOR_GRAY, COLOR_BLACK);
 
     display_fill_rect(10, 55, DISPLAY_WIDTH - 20, 20, COLOR_DARKGRAY);
 
-    if (custom_server_len > 0) {
-        const char *display_str = custom_server;
-        if (custom_server_len > 35) {
-            display_str = custom_server + custom_server_len - 35;
+    if (edit_len > 0) {
+        const char *display_str = edit_buf;
+        if (edit_len > 35) {
+            display_str = edit_buf + edit_len - 35;
         }
         display_string(15, 59, display_str, COLOR_WHITE, COLOR_DARKGRAY);
     }
 
     // Show cursor
-    int cursor_x = 15 + (custom_server_len > 35 ? 35 : custom_server_len) * CHAR_WIDTH;
+    int cursor_x = 15 + (edit_len > 35 ? 35 : edit_len) * CHAR_WIDTH;
     if (cursor_x < DISPLAY_WIDTH - 20) {
         display_string(cursor_x, 59, "_", COLOR_CYAN, COLOR_DARKGRAY);
     }
@@ -104,55 +124,116 @@ static char get_key_at(int16_t x, int16_t y) {
     return 0;
 }
 
-static void draw_main_screen(void) {
-    display_fill(COLOR_BLACK);
-
-    ui_draw_header("NTP Settings", true);
-
-    int y = 40;
-
-    // Server display
-    display_string(10, y, "Server:", COLOR_GRAY, COLOR_BLACK);
-    y += 20;
+// Main screen
+enum {
+    W_SERVER_LABEL,
+    W_SERVER,               // Tap to edit
+    W_INTERVAL_LABEL,
+    W_INTERVAL,             // NUM_INTERVALS buttons in a row
+    W_SYNC = W_INTERVAL + NUM_INTERVALS,
+    W_GRAPH,
+    W_SERVE,
+    W_HTTP_LABEL,
+    W_HTTP,                 // Tap to edit
+    W_PEERS,
+    W_COUNT,
+};
 
-    // Show current server in a tappable box
-    display_fill_rect(10, y, DISPLAY_WIDTH - 20, 28, COLOR_DARKGRAY);
-    char display_server[38];
-    strncpy(display_server, wifi_get_custom_ntp_server(), sizeof(display_server) - 1);
-    display_server[37] = '\0';
-    display_string(15, y + 7, display_server, COLOR_WHITE, COLOR_DARKGRAY);
-    display_string(DISPLAY_WIDTH - 30, y + 7, ">", COLOR_WHITE, COLOR_DARKGRAY);
-    y += 40;
+#define INTERVAL_BUTTON(i) { .type = UI_WIDGET_BUTTON, .flags = (i) ? UI_WIDGET_SAME_ROW : 0, \
+                             .w = 72, .h = 24, .gap = (i) ? 4 : 6 }
+
+static ui_widget_t widgets[W_COUNT] = {
+    [W_SERVER_LABEL]    = { .type = UI_WIDGET_LABEL, .h = 16, .text = "Server:",
+                            .fg = COLOR_GRAY, .bg = COLOR_BLACK },
+    [W_SERVER]          = { .type = UI_WIDGET_MENU_ITEM, .h = 28, .gap = 4,
+                            .fg = COLOR_WHITE, .bg = COLOR_DARKGRAY },
+    [W_INTERVAL_LABEL]  = { .type = UI_WIDGET_LABEL, .h = 16, .gap = 12, .text = "Sync Interval:",
+                            .fg = COLOR_GRAY, .bg = COLOR_BLACK },
+    [W_INTERVAL + 0]    = INTERVAL_BUTTON(0),
+    [W_INTERVAL + 1]    = INTERVAL_BUTTON(1),
+    [W_INTERVAL + 2]    = INTERVAL_BUTTON(2),
+    [W_INTERVAL + 3]    = INTERVAL_BUTTON(3),
+    [W_SYNC]            = { .type = UI_WIDGET_BUTTON, .w = 80, .h = 28, .gap = 12, .text = "Sync Now",
+                            .fg = COLOR_BLACK, .bg = COLOR_GREEN },
+    [W_GRAPH]           = { .type = UI_WIDGET_BUTTON, .flags = UI_WIDGET_SAME_ROW, .w = 80, .h = 28,
+                            .gap = 10, .text = "Graph", .fg = COLOR_WHITE, .bg = COLOR_DARKGRAY },
+    [W_SERVE]           = { .type = UI_WIDGET_BUTTON, .flags = UI_WIDGET_SAME_ROW, .w = 120, .h = 28,
+                            .gap = 10 },
+    [W_HTTP_LABEL]      = { .type = UI_WIDGET_LABEL, .w = 50, .h = 28, .gap = 10, .text = "HTTP:",
+                            .fg = COLOR_GRAY, .bg = COLOR_BLACK },
+    [W_HTTP]            = { .type = UI_WIDGET_MENU_ITEM, .flags = UI_WIDGET_SAME_ROW, .w = 150, .h = 28,
+                            .bg = COLOR_DARKGRAY },
+    [W_PEERS]           = { .type = UI_WIDGET_BUTTON, .flags = UI_WIDGET_SAME_ROW, .w = 90, .h = 28,
+                            .gap = 10 },
+};
 
-    // Interval section
-    display_string(10, y, "Sync Interval:", COLOR_GRAY, COLOR_BLACK);
-    y += 22;
+static ui_panel_t panel = {
+    .widgets = widgets,
+    .count = W_COUNT,
+    .top = 40,
+    .margin = 10,
+};
 
-    uint32_t current_interval = wifi_get_ntp_interval();
-    int current_interval_idx = find_interval_idx(current_interval);
+static char server_text[38];
+static char http_text[16];     // What fits beside the peer sync button
+
+// Bring the widgets in line with the current settings
+static void show_settings(void) {
+    char server[NTP_SERVER_NAME_LEN];
+    wifi_get_custom_ntp_server(server, sizeof(server));
+    if (strncmp(server_text, server, sizeof(server_text) - 1) != 0) {
+        strncpy(server_text, server, sizeof(server_text) - 1);
+        server_text[sizeof(server_text) - 1] = '\0';
+        ui_widget_invalidate(&widgets[W_SERVER]);
+    }
+    widgets[W_SERVER].text = server_text;
+
+    const char *http_host = http_time_get_host();
+    const char *http_shown = http_host[0] ? http_host : "(off)";
+    if (strncmp(http_text, http_shown, sizeof(http_text) - 1) != 0) {
+        strncpy(http_text, http_shown, sizeof(http_text) - 1);
+        http_text[sizeof(http_text) - 1] = '\0';
+        widgets[W_HTTP].fg = http_host[0] ? COLOR_WHITE : COLOR_GRAY;
+        ui_widget_invalidate(&widgets[W_HTTP]);
+    }
+    widgets[W_HTTP].text = http_text;
 
+    int current_interval_idx = find_interval_idx(wifi_get_ntp_interval());
     for (int i = 0; i < NUM_INTERVALS; i++) {
-        uint16_t bg = (i == current_interval_idx) ? COLOR_CYAN : COLOR_DARKGRAY;
-        uint16_t fg = (i == current_interval_idx) ? COLOR_BLACK : COLOR_WHITE;
+        ui_widget_t *w = &widgets[W_INTERVAL + i];
+        bool selected = i == current_interval_idx;
+        w->text = interval_names[i];
+        if (w->bg != (selected ? COLOR_CYAN : COLOR_DARKGRAY)) {
+            w->bg = selected ? COLOR_CYAN : COLOR_DARKGRAY;
+            w->fg = selected ? COLOR_BLACK : COLOR_WHITE;
+            ui_widget_invalidate(w);
+        }
+    }
 
-        int btn_w = 72;
-        int btn_x = 10 + i * (btn_w + 4);
+    bool serving = ntp_server_is_running();
+    ui_widget_set_text(&widgets[W_SERVE], serving ? "Serve LAN: On" : "Serve LAN:Off");
+    widgets[W_SERVE].bg = serving ? COLOR_CYAN : COLOR_DARKGRAY;
+    widgets[W_SERVE].fg = serving ? COLOR_BLACK : COLOR_WHITE;
 
-        display_fill_rect(btn_x, y, btn_w, 24, bg);
-        int text_x = btn_x + (btn_w - strlen(interval_names[i]) * CHAR_WIDTH) / 2;
-        display_string(text_x, y + 5, interval_names[i], fg, bg);
-    }
-    y += 36;
+    bool peers = peer_sync_is_running();
+    ui_widget_set_text(&widgets[W_PEERS], peers ? "Peers: On" : "Peers:Off");
+    widgets[W_PEERS].bg = peers ? COLOR_CYAN : COLOR_DARKGRAY;
+    widgets[W_PEERS].fg = peers ? COLOR_BLACK : COLOR_WHITE;
+}
+
+static void draw_main_screen(void) {
+    display_fill(COLOR_BLACK);
+    ui_draw_header("NTP Settings", true);
 
-    // Sync Now button
-    display_fill_rect(10, y, 80, 28, COLOR_GREEN);
-    display_string(18, y + 7, "Sync Now", COLOR_BLACK, COLOR_GREEN);
+    show_settings();
+    ui_panel_layout(&panel);
+    ui_panel_draw(&panel);
 }
 
 static void draw_keyboard_screen(void) {
     display_fill(COLOR_BLACK);
 
-    ui_draw_header("NTP Server", false);
+    ui_draw_header(edit_field == EDIT_HTTP_HOST ? "HTTP Time Host" : "NTP Server", false);
 
     draw_server_input();
     draw_keyboard();
@@ -160,20 +241,17 @@ static void draw_keyboard_screen(void) {
 
 void ui_ntp_init(void) {
     ESP_LOGI(TAG, "Initializing NTP settings UI");
-    last_touch_time = 0;
     ui_state = NTP_STATE_MAIN;
 
-    // Load current custom server
-    strncpy(custom_server, wifi_get_custom_ntp_server(), sizeof(custom_server) - 1);
-    custom_server[sizeof(custom_server) - 1] = '\0';
-    custom_server_len = strlen(custom_server);
+    edit_field = EDIT_NTP_SERVER;
+    load_edit_buf();
 
     draw_main_screen();
 }
 
 ntp_result_t ui_ntp_update(void) {
     touch_point_t touch;
-    bool touched = ui_read_touch(&touch, &last_touch_time);
+    bool touched = ui_read_touch(&touch);
 
     if (touched) {
         if (ui_state == NTP_STATE_MAIN) {
@@ -182,57 +260,70 @@ ntp_result_t ui_ntp_update(void) {
                 return NTP_RESULT_BACK;
             }
 
-            // Server box (tap to edit)
-            if (touch.y >= 60 && touch.y < 88) {
+            int hit = ui_panel_hit(&panel, touch.x, touch.y);
+            if (hit >= W_INTERVAL && hit < W_INTERVAL + NUM_INTERVALS) {
+                uint32_t interval = intervals[hit - W_INTERVAL];
+                wifi_set_ntp_interval(interval);
+                nvs_config_set_ntp_interval(interval);
+            } else if (hit == W_SERVER || hit == W_HTTP) {
+                edit_field = hit == W_HTTP ? EDIT_HTTP_HOST : EDIT_NTP_SERVER;
+                load_edit_buf();
                 ui_state = NTP_STATE_KEYBOARD;
                 draw_keyboard_screen();
-            }
-
-            // Interval buttons
-            int interval_y = 40 + 20 + 40 + 22;
-            if (touch.y >= interval_y && touch.y < interval_y + 24) {
-                int btn_w = 72;
-                int col = (touch.x - 10) / (btn_w + 4);
-                if (col >= 0 && col < NUM_INTERVALS) {
-                    wifi_set_ntp_interval(intervals[col]);
-                    nvs_config_set_ntp_interval(intervals[col]);
-                    draw_main_screen();
-                }
-            }
-
-            // Sync Now button
-            int sync_y = interval_y + 36;
-            if (touch.y >= sync_y && touch.y < sync_y + 28 && touch.x >= 10 && touch.x < 90) {
+                return NTP_RESULT_NONE;
+            } else if (hit == W_SYNC) {
                 wifi_force_ntp_sync();
                 return NTP_RESULT_SYNCED;
+            } else if (hit == W_GRAPH) {
+                return NTP_RESULT_GRAPH;
+            } else if (hit == W_SERVE) {
+                bool serve = !ntp_server_is_running();
+                if (serve) {
+                    ntp_server_start();
+                } else {
+                    ntp_server_stop();
+                }
+                nvs_config_set_ntp_serve(serve);
+            } else if (hit == W_PEERS) {
+                bool peers = !peer_sync_is_running();
+                if (peers) {
+                    peer_sync_start();
+                } else {
+                    peer_sync_stop();
+                }
+                nvs_config_set_peer_sync(peers);
             }
+            show_settings();
+            ui_panel_draw(&panel);
         } else if (ui_state == NTP_STATE_KEYBOARD) {
             char key = get_key_at(touch.x, touch.y);
 
             if (key == VKEY_ESCAPE) {  // Cancel
                 // Restore from saved
-                strncpy(custom_server, wifi_get_custom_ntp_server(), sizeof(custom_server) - 1);
-                custom_server[sizeof(custom_server) - 1] = '\0';
-                custom_server_len = strlen(custom_server);
+                load_edit_buf();
                 ui_state = NTP_STATE_MAIN;
                 draw_main_screen();
             } else if (key == VKEY_ENTER) {  // Done
-                if (custom_server_len > 0) {
-                    wifi_set_custom_ntp_server(custom_server);
-                    nvs_config_set_custom_ntp_server(custom_server);
+                if (edit_field == EDIT_HTTP_HOST) {
+                    // Empty host turns the fallback off
+                    http_time_set_host(edit_buf);
+                    nvs_config_set_http_time_host(edit_buf);
+                } else if (edit_len > 0) {
+                    wifi_set_custom_ntp_server(edit_buf);
+                    nvs_config_set_custom_ntp_server(edit_buf);
                     wifi_force_ntp_sync();
                 }
                 ui_state = NTP_STATE_MAIN;
                 draw_main_screen();
             } else if (key == VKEY_BACKSPACE) {  // Delete
-                if (custom_server_len > 0) {
-                    custom_server_len--;
-                    custom_server[custom_server_len] = '\0';
+                if (edit_len > 0) {
+                    edit_len--;
+                    edit_buf[edit_len] = '\0';
                     draw_server_input();
                 }
-            } else if (key >= ' ' && key <= '~' && custom_server_len < (int)(sizeof(custom_server) - 1)) {
-                custom_server[custom_server_len++] = key;
-                custom_server[custom_server_len] = '\0';
+            } else if (key >= ' ' && key <= '~' && edit_len < (int)(sizeof(edit_buf) - 1)) {
+                edit_buf[edit_len++] = key;
+                edit_buf[edit_len] = '\0';
                 draw_server_input();
             }
         }
@@ -5,6 +5,7 @@ typedef enum {
     NTP_RESULT_NONE,
     NTP_RESULT_BACK,
     NTP_RESULT_SYNCED,  // Sync triggered, return to clock
+    NTP_RESULT_GRAPH,   // Show measurement history
 } ntp_result_t;
 
 void ui_ntp_init(void);
@@ -0,0 +1,221 @@
+#include "ui_ntp_graph.h"
+#include "ui_common.h"
+#include "config.h"
+#include "display.h"
+#include "touch.h"
+#include "wifi.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "ui_ntp_graph";
+
+// Plot layout: one column per sample, sweeping left to right like a scope
+#define GRAPH_X         48
+#define GRAPH_COL_W     4
+#define GRAPH_W         (NTP_HISTORY_LEN * GRAPH_COL_W)
+
+#define OFFSET_LABEL_Y  34
+#define OFFSET_Y        52
+#define OFFSET_H        70
+#define OFFSET_MID_Y    (OFFSET_Y + OFFSET_H / 2)
+
+#define DELAY_LABEL_Y   126
+#define DELAY_Y         144
+#define DELAY_H         60
+
+#define FOOTER_Y        218
+
+#define COLOR_AXIS      COLOR_DARKGRAY
+#define COLOR_OFFSET    COLOR_CYAN
+#define COLOR_DELAY     COLOR_YELLOW
+#define COLOR_CLIPPED   COLOR_RED
+#define COLOR_CURSOR    COLOR_GRAY
+
+// Full-scale choices (microseconds); values beyond the last are drawn clipped
+static const uint32_t offset_scales[] = {1000, 5000, 20000, 100000, 500000, 1000000};
+static const uint32_t delay_scales[] = {10000, 50000, 200000, 1000000};
+#define NUM_OFFSET_SCALES (sizeof(offset_scales) / sizeof(offset_scales[0]))
+#define NUM_DELAY_SCALES (sizeof(delay_scales) / sizeof(delay_scales[0]))
+
+static ntp_sample_t samples[NTP_HISTORY_LEN];
+static uint32_t drawn_total = 0;    // Sample count reflected on screen
+static uint32_t offset_scale = 0;
+static uint32_t delay_scale = 0;
+
+static uint32_t pick_scale(const uint32_t *scales, int num, uint32_t value) {
+    for (int i = 0; i < num; i++) {
+        if (value <= scales[i]) return scales[i];
+    }
+    return scales[num - 1];
+}
+
+static void format_us(char *buf, size_t len, uint32_t us) {
+    if (us >= 1000000) {
+        snprintf(buf, len, "%lus", (unsigned long)(us / 1000000));
+    } else {
+        snprintf(buf, len, "%lums", (unsigned long)(us / 1000));
+    }
+}
+
+// Draw a single sample column in its ring slot
+static void draw_column(int slot, const ntp_sample_t *sample) {
+    int x = GRAPH_X + slot * GRAPH_COL_W;
+    int w = GRAPH_COL_W - 1;
+
+    // Offset: bar from the center line up (positive) or down (negative)
+    display_fill_rect(x, OFFSET_Y, GRAPH_COL_W, OFFSET_H, COLOR_BLACK);
+    display_hline(x, OFFSET_MID_Y, GRAPH_COL_W, COLOR_AXIS);
+    if (sample) {
+        uint32_t mag = (uint32_t)llabs(sample->offset_us);
+        bool clipped = mag > offset_scale;
+        int h = clipped ? OFFSET_H / 2 : (int)((uint64_t)mag * (OFFSET_H / 2) / offset_scale);
+        if (h < 1) h = 1;
+        uint16_t color = clipped ? COLOR_CLIPPED : COLOR_OFFSET;
+        if (sample->offset_us >= 0) {
+            display_fill_rect(x, OFFSET_MID_Y - h, w, h, color);
+        } else {
+            display_fill_rect(x, OFFSET_MID_Y + 1, w, h, color);
+        }
+    }
+
+    // Delay: bar from the bottom edge up
+    display_fill_rect(x, DELAY_Y, GRAPH_COL_W, DELAY_H, COLOR_BLACK);
+    display_hline(x, DELAY_Y + DELAY_H - 1, GRAPH_COL_W, COLOR_AXIS);
+    if (sample) {
+        bool clipped = sample->delay_us > delay_scale;
+        int h = clipped ? DELAY_H : (int)((uint64_t)sample->delay_us * DELAY_H / delay_scale);
+        if (h < 1) h = 1;
+        display_fill_rect(x, DELAY_Y + DELAY_H - h, w, h, clipped ? COLOR_CLIPPED : COLOR_DELAY);
+    }
+}
+
+// Sweep cursor marks the slot that will be overwritten next
+static void draw_cursor(int slot) {
+    int x = GRAPH_X + slot * GRAPH_COL_W;
+    display_fill_rect(x, OFFSET_Y, GRAPH_COL_W, OFFSET_H, COLOR_BLACK);
+    display_fill_rect(x, DELAY_Y, GRAPH_COL_W, DELAY_H, COLOR_BLACK);
+    display_vline(x + 1, OFFSET_Y, OFFSET_H, COLOR_CURSOR);
+    display_vline(x + 1, DELAY_Y, DELAY_H, COLOR_CURSOR);
+}
+
+static void draw_footer(const ntp_sample_t *latest) {
+    char line[48];
+    if (latest) {
+        int32_t off = latest->offset_us;
+        uint32_t mag = (uint32_t)llabs(off);
+        snprintf(line, sizeof(line), "Off %c%lu.%03lums  Dly %lu.%lums  %ddBm",
+                 off < 0 ? '-' : '+',
+                 (unsigned long)(mag / 1000), (unsigned long)(mag % 1000),
+                 (unsigned long)(latest->delay_us / 1000),
+                 (unsigned long)(latest->delay_us % 1000 / 100),
+                 latest->rssi);
+        ui_draw_centered_string(FOOTER_Y, line, COLOR_WHITE, COLOR_BLACK, false);
+    } else {
+        ui_draw_centered_string(FOOTER_Y, "No samples yet", COLOR_GRAY, COLOR_BLACK, false);
+    }
+}
+
+static void draw_labels(void) {
+    char scale_str[8];
+
+    display_string(GRAPH_X, OFFSET_LABEL_Y, "Offset", COLOR_OFFSET, COLOR_BLACK);
+    display_fill_rect(0, OFFSET_Y, GRAPH_X, OFFSET_H, COLOR_BLACK);
+    format_us(scale_str, sizeof(scale_str), offset_scale);
+    display_char(0, OFFSET_Y, '+', COLOR_GRAY, COLOR_BLACK);
+    display_string(CHAR_WIDTH, OFFSET_Y, scale_str, COLOR_GRAY, COLOR_BLACK);
+    display_char(0, OFFSET_Y + OFFSET_H - CHAR_HEIGHT, '-', COLOR_GRAY, COLOR_BLACK);
+    display_string(CHAR_WIDTH, OFFSET_Y + OFFSET_H - CHAR_HEIGHT, scale_str, COLOR_GRAY, COLOR_BLACK);
+
+    display_string(GRAPH_X, DELAY_LABEL_Y, "Delay", COLOR_DELAY, COLOR_BLACK);
+    display_fill_rect(0, DELAY_Y, GRAPH_X, DELAY_H, COLOR_BLACK);
+    format_us(scale_str, sizeof(scale_str), delay_scale);
+    display_string(CHAR_WIDTH, DELAY_Y, scale_str, COLOR_GRAY, COLOR_BLACK);
+    display_string(CHAR_WIDTH, DELAY_Y + DELAY_H - CHAR_HEIGHT, "0", COLOR_GRAY, COLOR_BLACK);
+}
+
+// Scales that fit every sample in the history
+static void compute_scales(int count, uint32_t *off_scale, uint32_t *dly_scale) {
+    uint32_t max_off = 0, max_dly = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t mag = (uint32_t)llabs(samples[i].offset_us);
+        // Initial clock steps are huge; let them clip instead of flattening the plot
+        if (mag <= offset_scales[NUM_OFFSET_SCALES - 1] && mag > max_off) max_off = mag;
+        if (samples[i].delay_us > max_dly) max_dly = samples[i].delay_us;
+    }
+    *off_scale = pick_scale(offset_scales, NUM_OFFSET_SCALES, max_off);
+    *dly_scale = pick_scale(delay_scales, NUM_DELAY_SCALES, max_dly);
+}
+
+static void draw_all(int count, uint32_t total) {
+    draw_labels();
+
+    uint32_t first = total - count;
+    for (int slot = 0; slot < NTP_HISTORY_LEN; slot++) {
+        draw_column(slot, NULL);
+    }
+    for (int i = 0; i < count; i++) {
+        draw_column((first + i) % NTP_HISTORY_LEN, &samples[i]);
+    }
+    if (count > 0) {
+        draw_cursor(total % NTP_HISTORY_LEN);
+    }
+    draw_footer(count > 0 ? &samples[count - 1] : NULL);
+}
+
+void ui_ntp_graph_init(void) {
+    ESP_LOGI(TAG, "Initializing NTP history graph");
+
+    display_fill(COLOR_BLACK);
+    ui_draw_header("NTP History", true);
+
+    uint32_t total = 0;
+    int count = wifi_get_ntp_history(samples, NTP_HISTORY_LEN, &total);
+    compute_scales(count, &offset_scale, &delay_scale);
+    draw_all(count, total);
+    drawn_total = total;
+}
+
+ntp_graph_result_t ui_ntp_graph_update(void) {
+    touch_point_t touch;
+    if (ui_read_touch(&touch)) {
+        // Back button
+        if (touch.y < UI_HEADER_HEIGHT && touch.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
+            return NTP_GRAPH_RESULT_BACK;
+        }
+    }
+
+    ntp_stats_t stats;
+    wifi_get_ntp_stats(&stats);
+    if (stats.sync_count == drawn_total) {
+        return NTP_GRAPH_RESULT_NONE;
+    }
+
+    uint32_t total = 0;
+    int count = wifi_get_ntp_history(samples, NTP_HISTORY_LEN, &total);
+    if (total == drawn_total) {
+        return NTP_GRAPH_RESULT_NONE;
+    }
+
+    uint32_t new_off_scale, new_dly_scale;
+    compute_scales(count, &new_off_scale, &new_dly_scale);
+
+    if (new_off_scale != offset_scale || new_dly_scale != delay_scale ||
+        total - drawn_total >= NTP_HISTORY_LEN) {
+        // Rescale: every column changes
+        offset_scale = new_off_scale;
+        delay_scale = new_dly_scale;
+        draw_all(count, total);
+    } else {
+        // Only paint the new columns and move the sweep cursor
+        uint32_t first = total - count;
+        for (uint32_t seq = drawn_total; seq < total; seq++) {
+            draw_column(seq % NTP_HISTORY_LEN, &samples[seq - first]);
+        }
+        draw_cursor(total % NTP_HISTORY_LEN);
+        draw_footer(&samples[count - 1]);
+    }
+
+    drawn_total = total;
+    return NTP_GRAPH_RESULT_NONE;
+}
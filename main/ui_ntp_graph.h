@@ -0,0 +1,12 @@
+#ifndef UI_NTP_GRAPH_H
+#define UI_NTP_GRAPH_H
+
+typedef enum {
+    NTP_GRAPH_RESULT_NONE,
+    NTP_GRAPH_RESULT_BACK,
+} ntp_graph_result_t;
+
+void ui_ntp_graph_init(void);
+ntp_graph_result_t ui_ntp_graph_update(void);
+
+#endif // UI_NTP_GRAPH_H
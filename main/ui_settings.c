@@ -4,7 +4,11 @@
 #include "led.h"
 #include "touch.h"
 #include "nvs_config.h"
+#include "wifi.h"
 #include "ui_common.h"
+#include "ui_widget.h"
+#include "input.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -14,182 +18,239 @@
 static const char *TAG = "ui_settings";
 
 #define ITEM_START_Y        32
-#define ROTATION_TOGGLE_X   260
-#define ROTATION_TOGGLE_W   50
+#define ROW_H               (UI_ITEM_HEIGHT - 3)
+#define TOGGLE_X            260
+
+enum {
+    W_TIMEZONE,
+    W_WIFI,
+    W_WIFI_POWER,           // Cycles the radio power profile
+    W_NTP,
+    W_BRIGHTNESS,
+    W_LED,
+    W_ROTATION_LABEL,
+    W_ROTATION,
+    W_ABOUT,
+    W_DONE,
+    W_COUNT,
+};
+
+#define MENU_ITEM(label, ...) { .type = UI_WIDGET_MENU_ITEM, .h = ROW_H, .text = (label), \
+                                .fg = UI_COLOR_ITEM_FG, .bg = UI_COLOR_ITEM_BG, __VA_ARGS__ }
+
+static ui_widget_t widgets[W_COUNT] = {
+    [W_TIMEZONE]        = MENU_ITEM("Time zone"),
+    [W_WIFI]            = MENU_ITEM("WiFi", .w = TOGGLE_X),
+    [W_WIFI_POWER]      = { .type = UI_WIDGET_TOGGLE, .flags = UI_WIDGET_SAME_ROW, .h = ROW_H,
+                            .bg = COLOR_GREEN },
+    [W_NTP]             = MENU_ITEM("NTP"),
+    [W_BRIGHTNESS]      = { .type = UI_WIDGET_SLIDER, .h = ROW_H, .text = "Brightness",
+                            .bg = UI_COLOR_SELECTED, .max_value = BRIGHTNESS_MAX },
+    [W_LED]             = { .type = UI_WIDGET_SLIDER, .h = ROW_H, .text = "LED Blink",
+                            .bg = COLOR_RED, .max_value = BRIGHTNESS_MAX },
+    [W_ROTATION_LABEL]  = MENU_ITEM("Rotate 180\x7F", .w = TOGGLE_X, .flags = UI_WIDGET_NO_ARROW),
+    [W_ROTATION]        = { .type = UI_WIDGET_TOGGLE, .flags = UI_WIDGET_SAME_ROW, .h = ROW_H,
+                            .bg = COLOR_GREEN },
+    [W_ABOUT]           = MENU_ITEM("About"),
+    [W_DONE]            = { .type = UI_WIDGET_BUTTON, .flags = UI_WIDGET_CENTER, .w = DISPLAY_WIDTH / 3,
+                            .h = ROW_H, .text = "Done", .fg = COLOR_BLACK, .bg = COLOR_GREEN },
+};
+
+static ui_panel_t panel = {
+    .widgets = widgets,
+    .count = W_COUNT,
+    .top = ITEM_START_Y,
+    .row_gap = UI_ITEM_HEIGHT - ROW_H,
+};
+
+// Slider drag state
+static int drag_slider = -1;        // Widget index, -1 when not dragging
+static uint8_t drag_applied;        // Value last pushed to the hardware
+static int64_t drag_applied_us;
+
+static uint8_t slider_min(int index) {
+    return index == W_BRIGHTNESS ? BRIGHTNESS_MIN : 0;
+}
 
+static void set_slider(int index, int value) {
+    if (value < slider_min(index)) value = slider_min(index);
+    if (value > BRIGHTNESS_MAX) value = BRIGHTNESS_MAX;
+    ui_widget_set_value(&widgets[index], value);
+}
 
-static uint8_t brightness = BRIGHTNESS_DEFAULT;
-static uint8_t led_brightness = BRIGHTNESS_DEFAULT;
-static bool rotation = false;
-static uint32_t last_touch_time = 0;
+static void apply_slider(int index) {
+    uint8_t value = widgets[index].value;
+    if (index == W_BRIGHTNESS) {
+        display_set_backlight(value);
+    } else {
+        led_set_brightness(value);
+    }
+    drag_applied = value;
+    drag_applied_us = esp_timer_get_time();
+}
 
-// Handle touch on a slider row. Returns true if value changed.
-static bool handle_slider_touch(int touch_x, uint8_t *value, uint8_t min_val) {
-    if (touch_x >= UI_SLIDER_BAR_X && touch_x < UI_SLIDER_BAR_X + UI_SLIDER_BAR_W) {
-        *value = ((touch_x - UI_SLIDER_BAR_X) * BRIGHTNESS_MAX) / UI_SLIDER_BAR_W;
-        if (*value < min_val) *value = min_val;
-        return true;
+static void save_slider(int index) {
+    uint8_t value = widgets[index].value;
+    if (index == W_BRIGHTNESS) {
+        nvs_config_set_brightness(value);
+    } else {
+        nvs_config_set_led_brightness(value);
     }
-    if (touch_x >= UI_SLIDER_BTN_X1 && touch_x < UI_SLIDER_BTN_X1 + UI_SLIDER_BTN_W) {
-        if (*value >= min_val + BRIGHTNESS_STEP) {
-            *value -= BRIGHTNESS_STEP;
-        } else {
-            *value = min_val;
-        }
-        return true;
+}
+
+// Tap on a slider row: the bar starts a drag, -/+ step the value
+static void handle_slider_touch(int index, int touch_x) {
+    ui_widget_t *slider = &widgets[index];
+    switch (ui_slider_part_at(slider, touch_x)) {
+        case UI_SLIDER_PART_BAR:
+            drag_slider = index;
+            drag_applied_us = 0;
+            set_slider(index, ui_slider_value_at(slider, touch_x));
+            apply_slider(index);
+            return;
+        case UI_SLIDER_PART_MINUS:
+            set_slider(index, slider->value - BRIGHTNESS_STEP);
+            break;
+        case UI_SLIDER_PART_PLUS:
+            set_slider(index, slider->value + BRIGHTNESS_STEP);
+            break;
+        default:
+            return;
     }
-    if (touch_x >= UI_SLIDER_BTN_X2 && touch_x < UI_SLIDER_BTN_X2 + UI_SLIDER_BTN_W) {
-        if (*value <= BRIGHTNESS_MAX - BRIGHTNESS_STEP) {
-            *value += BRIGHTNESS_STEP;
+    apply_slider(index);
+    save_slider(index);
+}
+
+// Follow the finger along the bar. The hardware is updated at most every
+// SLIDER_APPLY_MS and the setting is stored once, on release.
+static void update_drag(void) {
+    touch_point_t touch;
+    if (!input_get_touch(&touch)) {
+        apply_slider(drag_slider);
+        save_slider(drag_slider);
+        drag_slider = -1;
+        return;
+    }
+
+    set_slider(drag_slider, ui_slider_value_at(&widgets[drag_slider], touch.x));
+    if (widgets[drag_slider].value != drag_applied) {
+        if (esp_timer_get_time() - drag_applied_us >= SLIDER_APPLY_MS * 1000) {
+            apply_slider(drag_slider);
         } else {
-            *value = BRIGHTNESS_MAX;
+            ui_request_frame();     // Finger may stop here; apply the value then
         }
-        return true;
     }
-    return false;
 }
 
-static void draw_menu(void) {
-    int y = ITEM_START_Y;
-
-    ui_draw_menu_item(y, "Time zone");
-    y += UI_ITEM_HEIGHT;
-
-    ui_draw_menu_item(y, "WiFi");
-    y += UI_ITEM_HEIGHT;
-
-    ui_draw_menu_item(y, "NTP");
-    y += UI_ITEM_HEIGHT;
-
-    ui_draw_slider(y, "Brightness", brightness, BRIGHTNESS_MAX, UI_COLOR_SELECTED);
-    y += UI_ITEM_HEIGHT;
-
-    ui_draw_slider(y, "LED Blink", led_brightness, BRIGHTNESS_MAX, COLOR_RED);
-    y += UI_ITEM_HEIGHT;
-
-    // Rotation toggle
-    display_fill_rect(0, y, DISPLAY_WIDTH, UI_ITEM_HEIGHT - 3, UI_COLOR_ITEM_BG);
-    display_string(10, y + UI_TEXT_Y_OFFSET, "Rotate 180\x7F", UI_COLOR_ITEM_FG, UI_COLOR_ITEM_BG);
-    uint16_t rot_bg = rotation ? COLOR_GREEN : COLOR_GRAY;
-    display_fill_rect(ROTATION_TOGGLE_X, y + 3, ROTATION_TOGGLE_W, 18, rot_bg);
-    const char *rot_label = rotation ? "On" : "Off";
-    int rot_text_x = ROTATION_TOGGLE_X + (ROTATION_TOGGLE_W - strlen(rot_label) * CHAR_WIDTH) / 2;
-    display_string(rot_text_x, y + 4, rot_label, rotation ? COLOR_BLACK : COLOR_WHITE, rot_bg);
-    y += UI_ITEM_HEIGHT;
-
-    ui_draw_menu_item(y, "About");
-    y += UI_ITEM_HEIGHT;
+static void show_wifi_power(void) {
+    wifi_power_profile_t profile = wifi_get_power_profile();
+    ui_widget_set_text(&widgets[W_WIFI_POWER], wifi_power_profile_name(profile));
+    ui_widget_set_on(&widgets[W_WIFI_POWER], profile == WIFI_POWER_SAVER);
+}
 
-    // Done button (1/3 width, centered)
-    int btn_w = DISPLAY_WIDTH / 3;
-    int btn_x = (DISPLAY_WIDTH - btn_w) / 2;
-    display_fill_rect(btn_x, y, btn_w, UI_ITEM_HEIGHT - 3, COLOR_GREEN);
-    display_string(btn_x + (btn_w - 4 * CHAR_WIDTH) / 2, y + UI_TEXT_Y_OFFSET, "Done", COLOR_BLACK, COLOR_GREEN);
+static void show_rotation(bool rotation) {
+    ui_widget_set_text(&widgets[W_ROTATION], rotation ? "On" : "Off");
+    ui_widget_set_on(&widgets[W_ROTATION], rotation);
 }
 
 void ui_settings_init(void) {
     ESP_LOGI(TAG, "Initializing settings UI");
 
     // Load saved brightness or default
+    uint8_t brightness;
     if (!nvs_config_get_brightness(&brightness) || brightness < BRIGHTNESS_MIN) {
         brightness = BRIGHTNESS_DEFAULT;
     }
-
-    // Load saved rotation
-    rotation = display_is_rotated();
+    widgets[W_BRIGHTNESS].value = brightness;
 
     // Load saved LED brightness (default to BRIGHTNESS_DEFAULT if not set)
+    uint8_t led_brightness;
     if (!nvs_config_get_led_brightness(&led_brightness)) {
         led_brightness = BRIGHTNESS_DEFAULT;
     }
+    widgets[W_LED].value = led_brightness;
+
+    show_wifi_power();
+    show_rotation(display_is_rotated());
+    drag_slider = -1;
 
     // Turn off LED when entering settings
     led_set_brightness(0);
 
     display_fill(COLOR_BLACK);
     ui_draw_header("Settings", false);
-    draw_menu();
+    ui_panel_layout(&panel);
+    ui_panel_draw(&panel);
 }
 
 settings_result_t ui_settings_update(void) {
-    touch_point_t touch;
-    bool touched = ui_read_touch(&touch, &last_touch_time);
-
-    if (!touched) {
+    if (drag_slider >= 0) {
+        update_drag();
+        ui_panel_draw(&panel);
         return SETTINGS_RESULT_NONE;
     }
 
-    int y = ITEM_START_Y;
-
-    // Timezone
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT) {
-        led_set_brightness(0);
-        return SETTINGS_RESULT_TIMEZONE;
-    }
-    y += UI_ITEM_HEIGHT;
-
-    // WiFi
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT) {
-        led_set_brightness(0);
-        return SETTINGS_RESULT_WIFI;
+    touch_point_t touch;
+    if (!ui_read_touch(&touch)) {
+        return SETTINGS_RESULT_NONE;
     }
-    y += UI_ITEM_HEIGHT;
 
-    // NTP
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT) {
-        led_set_brightness(0);
-        return SETTINGS_RESULT_NTP;
-    }
-    y += UI_ITEM_HEIGHT;
-
-    // Brightness controls
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT) {
-        if (handle_slider_touch(touch.x, &brightness, BRIGHTNESS_MIN)) {
-            display_set_backlight(brightness);
-            nvs_config_set_brightness(brightness);
-            draw_menu();
+    settings_result_t result = SETTINGS_RESULT_NONE;
+    int hit = ui_panel_hit(&panel, touch.x, touch.y);
+    switch (hit) {
+        case W_TIMEZONE:
+            result = SETTINGS_RESULT_TIMEZONE;
+            break;
+
+        case W_WIFI:
+            result = SETTINGS_RESULT_WIFI;
+            break;
+
+        case W_WIFI_POWER: {
+            wifi_power_profile_t profile = (wifi_get_power_profile() + 1) % WIFI_POWER_PROFILE_COUNT;
+            wifi_set_power_profile(profile);
+            nvs_config_set_wifi_power(profile);
+            show_wifi_power();
+            break;
         }
-    }
-    y += UI_ITEM_HEIGHT;
-
-    // LED brightness controls
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT) {
-        if (handle_slider_touch(touch.x, &led_brightness, 0)) {
-            led_set_brightness(led_brightness);
-            nvs_config_set_led_brightness(led_brightness);
-            draw_menu();
+
+        case W_NTP:
+            result = SETTINGS_RESULT_NTP;
+            break;
+
+        case W_BRIGHTNESS:
+        case W_LED:
+            handle_slider_touch(hit, touch.x);
+            break;
+
+        case W_ROTATION: {
+            bool rotation = !widgets[W_ROTATION].on;
+            display_set_rotation(rotation);
+            nvs_config_set_rotation(rotation);
+            show_rotation(rotation);
+            // Redraw everything after rotation change
+            display_fill(COLOR_BLACK);
+            ui_draw_header("Settings", false);
+            ui_panel_invalidate(&panel);
+            break;
         }
-    }
-    y += UI_ITEM_HEIGHT;
-
-    // Rotation toggle
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT &&
-        touch.x >= ROTATION_TOGGLE_X && touch.x < ROTATION_TOGGLE_X + ROTATION_TOGGLE_W) {
-        rotation = !rotation;
-        display_set_rotation(rotation);
-        nvs_config_set_rotation(rotation);
-        // Redraw everything after rotation change
-        display_fill(COLOR_BLACK);
-        ui_draw_header("Settings", false);
-        draw_menu();
-    }
-    y += UI_ITEM_HEIGHT;
 
-    // About
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT) {
-        led_set_brightness(0);
-        return SETTINGS_RESULT_ABOUT;
+        case W_ABOUT:
+            result = SETTINGS_RESULT_ABOUT;
+            break;
+
+        case W_DONE:
+            result = SETTINGS_RESULT_DONE;
+            break;
+
+        default:
+            break;
     }
-    y += UI_ITEM_HEIGHT;
 
-    // Done button (1/3 width, centered)
-    int btn_w = DISPLAY_WIDTH / 3;
-    int btn_x = (DISPLAY_WIDTH - btn_w) / 2;
-    if (touch.y >= y && touch.y < y + UI_ITEM_HEIGHT &&
-        touch.x >= btn_x && touch.x < btn_x + btn_w) {
+    if (result != SETTINGS_RESULT_NONE) {
         led_set_brightness(0);
-        return SETTINGS_RESULT_DONE;
+        return result;
     }
-
+    ui_panel_draw(&panel);
     return SETTINGS_RESULT_NONE;
 }
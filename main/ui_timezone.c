@@ -1,7 +1,7 @@
 #include "ui_timezone.h"
 #include "ui_common.h"
+#include "ui_list.h"
 #include "display.h"
-#include "touch.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -85,20 +85,10 @@ static const timezone_entry_t timezones[] = {
 
 // State
 static int selected_tz = 0;
-static int scroll_offset = 0;
 static bool selection_made = false;
-static uint32_t last_touch_time = 0;
 static bool show_back_button = false;
-
-
-
-static void draw_list(void) {
-    const char *labels[NUM_TIMEZONES];
-    for (int i = 0; i < NUM_TIMEZONES; i++) {
-        labels[i] = timezones[i].name;
-    }
-    ui_draw_list(labels, NUM_TIMEZONES, scroll_offset, selected_tz);
-}
+static const char *labels[NUM_TIMEZONES];
+static ui_list_t list;
 
 void ui_timezone_init(const char *current_tz, bool show_back) {
     ESP_LOGI(TAG, "Initializing timezone selector");
@@ -116,16 +106,13 @@ void ui_timezone_init(const char *current_tz, bool show_back) {
         }
     }
 
-    // Scroll so selected item is visible (center it if possible)
-    scroll_offset = selected_tz - UI_LIST_VISIBLE / 2;
-    if (scroll_offset < 0) scroll_offset = 0;
-    if (scroll_offset > NUM_TIMEZONES - UI_LIST_VISIBLE) {
-        scroll_offset = NUM_TIMEZONES - UI_LIST_VISIBLE;
+    for (int i = 0; i < NUM_TIMEZONES; i++) {
+        labels[i] = timezones[i].name;
     }
 
     display_fill(COLOR_BLACK);
     ui_draw_header("Select Timezone", show_back_button);
-    draw_list();
+    ui_list_init(&list, labels, NUM_TIMEZONES, selected_tz, NULL);
 }
 
 tz_select_result_t ui_timezone_update(void) {
@@ -133,42 +120,24 @@ tz_select_result_t ui_timezone_update(void) {
         return TZ_SELECT_DONE;
     }
 
-    touch_point_t touch;
-    bool touched = ui_read_touch(&touch, &last_touch_time);
-
-    if (!touched) {
-        return TZ_SELECT_CONTINUE;
-    }
-
-    // Back button
-    if (show_back_button && touch.y < UI_HEADER_HEIGHT && touch.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
-        return TZ_SELECT_CANCELLED;
-    }
+    gesture_t gesture;
+    while (gesture_get(&gesture)) {
+        // Back button
+        if (gesture.type == GESTURE_TAP && show_back_button && gesture.y < UI_HEADER_HEIGHT &&
+            gesture.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
+            return TZ_SELECT_CANCELLED;
+        }
 
-    // List item touch - single tap to select
-    if (touch.y >= UI_LIST_START_Y && touch.y < UI_LIST_START_Y + UI_LIST_VISIBLE * UI_LIST_ITEM_H) {
-        int item = (touch.y - UI_LIST_START_Y) / UI_LIST_ITEM_H + scroll_offset;
-        if (item < NUM_TIMEZONES) {
+        // Single tap on a row selects it; drags and flings scroll
+        int item = ui_list_handle(&list, &gesture);
+        if (item >= 0) {
             selected_tz = item;
             selection_made = true;
             return TZ_SELECT_DONE;
         }
     }
 
-    // Scroll up
-    if (touch.y < UI_LIST_START_Y && scroll_offset > 0) {
-        scroll_offset--;
-        draw_list();
-    }
-
-    // Scroll down (bottom area of screen)
-    if (touch.y >= UI_LIST_START_Y + UI_LIST_VISIBLE * UI_LIST_ITEM_H) {
-        if (scroll_offset + UI_LIST_VISIBLE < NUM_TIMEZONES) {
-            scroll_offset++;
-            draw_list();
-        }
-    }
-
+    ui_list_update(&list);
     return TZ_SELECT_CONTINUE;
 }
 
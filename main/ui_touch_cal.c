@@ -0,0 +1,142 @@
+#include "ui_touch_cal.h"
+#include "config.h"
+#include "display.h"
+#include "input.h"
+#include "nvs_config.h"
+#include "touch.h"
+#include "ui_common.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+
+static const char *TAG = "ui_touch_cal";
+
+#define CAL_POINTS      5
+#define CROSS_SIZE      10
+#define TEXT_Y          50      // Clear of the corner and center crosses
+#define STATUS_Y        175
+
+// Targets in screen coordinates as the user sees them
+static const int16_t target_x[CAL_POINTS] = {
+    TOUCH_CAL_MARGIN, DISPLAY_WIDTH - 1 - TOUCH_CAL_MARGIN,
+    DISPLAY_WIDTH - 1 - TOUCH_CAL_MARGIN, TOUCH_CAL_MARGIN, DISPLAY_WIDTH / 2,
+};
+static const int16_t target_y[CAL_POINTS] = {
+    TOUCH_CAL_MARGIN, TOUCH_CAL_MARGIN,
+    DISPLAY_HEIGHT - 1 - TOUCH_CAL_MARGIN, DISPLAY_HEIGHT - 1 - TOUCH_CAL_MARGIN, DISPLAY_HEIGHT / 2,
+};
+
+static touch_cal_point_t samples[CAL_POINTS];
+static int current = 0;
+
+// Raw readings accumulated over the current press
+static uint32_t sum_x = 0, sum_y = 0;
+static uint32_t sum_count = 0;
+static bool button_last = false;
+
+static void draw_cross(int i, uint16_t color) {
+    display_hline(target_x[i] - CROSS_SIZE, target_y[i], CROSS_SIZE * 2 + 1, color);
+    display_vline(target_x[i], target_y[i] - CROSS_SIZE, CROSS_SIZE * 2 + 1, color);
+}
+
+static void draw_screen(void) {
+    display_fill(COLOR_BLACK);
+    ui_draw_centered_string(TEXT_Y, "Touch calibration", COLOR_CYAN, COLOR_BLACK, false);
+    ui_draw_centered_string(TEXT_Y + 20, "Tap the center of each cross", COLOR_WHITE, COLOR_BLACK, false);
+    ui_draw_centered_string(STATUS_Y - 20, "BOOT button cancels", COLOR_GRAY, COLOR_BLACK, false);
+    draw_cross(0, COLOR_WHITE);
+}
+
+static void restart(void) {
+    current = 0;
+    sum_x = sum_y = sum_count = 0;
+    draw_screen();
+}
+
+// Largest distance between a target and where the fitted transform puts its sample
+static int32_t max_error(const touch_cal_t *cal) {
+    int32_t worst = 0;
+    for (int i = 0; i < CAL_POINTS; i++) {
+        int32_t x, y;
+        touch_cal_apply(cal, samples[i].raw_x, samples[i].raw_y, &x, &y);
+        int32_t dx = x - samples[i].x, dy = y - samples[i].y;
+        int32_t d2 = dx * dx + dy * dy;
+        if (d2 > worst) worst = d2;
+    }
+    int32_t d = 0;
+    while ((d + 1) * (d + 1) <= worst) d++;
+    return d;
+}
+
+static touch_cal_result_t finish(void) {
+    touch_cal_t cal;
+    int32_t error = -1;
+    if (touch_cal_solve(samples, CAL_POINTS, &cal)) {
+        error = max_error(&cal);
+    }
+
+    if (error < 0 || error > TOUCH_CAL_MAX_ERROR_PX) {
+        ESP_LOGW(TAG, "Calibration rejected (max error %ld px)", (long)error);
+        ui_draw_centered_string(STATUS_Y, "Inconsistent taps, try again", COLOR_RED, COLOR_BLACK, false);
+        vTaskDelay(pdMS_TO_TICKS(1500));
+        restart();
+        return TOUCH_CAL_RESULT_NONE;
+    }
+
+    ESP_LOGI(TAG, "Calibrated (max error %ld px)", (long)error);
+    touch_set_calibration(&cal);
+    nvs_config_set_touch_cal(&cal);
+    ui_draw_centered_string(STATUS_Y, "Calibration saved", COLOR_GREEN, COLOR_BLACK, false);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    return TOUCH_CAL_RESULT_DONE;
+}
+
+void ui_touch_cal_init(void) {
+    ESP_LOGI(TAG, "Initializing touch calibration screen");
+    button_last = input_button_is_down();
+    restart();
+}
+
+touch_cal_result_t ui_touch_cal_update(void) {
+    // BOOT is the way out, since every tap here is a calibration sample
+    bool button = input_button_is_down();
+    if (button && !button_last) {
+        button_last = button;
+        return TOUCH_CAL_RESULT_CANCEL;
+    }
+    button_last = button;
+
+    // A still finger sends no events; keep coming back to sample it
+    touch_point_t touch;
+    if (input_get_touch(&touch)) {
+        sum_x += touch.raw_x;
+        sum_y += touch.raw_y;
+        sum_count++;
+        ui_request_frame();
+        return TOUCH_CAL_RESULT_NONE;
+    }
+    if (sum_count == 0) {
+        return TOUCH_CAL_RESULT_NONE;
+    }
+
+    // Released: record the averaged press against the target. The transform
+    // maps to the unrotated panel, so undo rotation on the target instead.
+    touch_cal_point_t *s = &samples[current];
+    s->raw_x = sum_x / sum_count;
+    s->raw_y = sum_y / sum_count;
+    s->x = target_x[current];
+    s->y = target_y[current];
+    if (display_is_rotated()) {
+        s->x = DISPLAY_WIDTH - 1 - s->x;
+        s->y = DISPLAY_HEIGHT - 1 - s->y;
+    }
+    sum_x = sum_y = sum_count = 0;
+
+    draw_cross(current, COLOR_BLACK);
+    if (++current < CAL_POINTS) {
+        draw_cross(current, COLOR_WHITE);
+        return TOUCH_CAL_RESULT_NONE;
+    }
+    return finish();
+}
@@ -0,0 +1,14 @@
+#ifndef UI_TOUCH_CAL_H
+#define UI_TOUCH_CAL_H
+
+typedef enum {
+    TOUCH_CAL_RESULT_NONE,
+    TOUCH_CAL_RESULT_DONE,      // New calibration applied and saved
+    TOUCH_CAL_RESULT_CANCEL,    // BOOT pressed; previous calibration kept
+} touch_cal_result_t;
+
+// Five-target calibration: tap the center of each cross in turn
+void ui_touch_cal_init(void);
+touch_cal_result_t ui_touch_cal_update(void);
+
+#endif // UI_TOUCH_CAL_H
@@ -0,0 +1,234 @@
+#include "ui_widget.h"
+#include "ui_common.h"
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+// Slider row geometry, relative to the row
+#define SLIDER_BAR_X        100
+#define SLIDER_BAR_W        118
+#define SLIDER_BAR_H        14
+#define SLIDER_BAR_DY       5
+#define SLIDER_FILL_X       (SLIDER_BAR_X + 2)  // Fill sits inside the outline
+#define SLIDER_FILL_W       (SLIDER_BAR_W - 4)
+#define SLIDER_READOUT_X    222     // "100%", between the bar and the buttons
+#define SLIDER_MINUS_X      260
+#define SLIDER_PLUS_X       288
+#define SLIDER_BTN_W        22
+#define SLIDER_BTN_H        18
+#define SLIDER_BTN_DY       3
+
+// Toggle box inside its cell
+#define TOGGLE_INSET_R      10
+#define TOGGLE_DY           3
+
+#define TEXT_PAD            10
+
+// Glyphs sit high in their cell, so centering rounds a pixel down
+static int16_t text_y(const ui_widget_t *w) {
+    return w->y + (w->h - CHAR_HEIGHT + 3) / 2;
+}
+
+static int16_t centered_x(int16_t x, int16_t width, const char *text) {
+    return x + (width - (int16_t)strlen(text) * CHAR_WIDTH) / 2;
+}
+
+static int16_t slider_fill_w(const ui_widget_t *w, uint8_t value) {
+    return (value * SLIDER_FILL_W) / w->max_value;
+}
+
+static void draw_slider_readout(const ui_widget_t *w) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "%3d%%", w->value * 100 / w->max_value);
+    display_string(w->x + SLIDER_READOUT_X, text_y(w), buf, UI_COLOR_ITEM_FG, UI_COLOR_ITEM_BG);
+}
+
+static void draw_slider(ui_widget_t *w) {
+    display_fill_rect(w->x, w->y, w->width, w->h, UI_COLOR_ITEM_BG);
+    display_string(w->x + TEXT_PAD, text_y(w), w->text, UI_COLOR_ITEM_FG, UI_COLOR_ITEM_BG);
+
+    int16_t bar_x = w->x + SLIDER_BAR_X;
+    int16_t bar_y = w->y + SLIDER_BAR_DY;
+    display_fill_rect(bar_x, bar_y, SLIDER_BAR_W, SLIDER_BAR_H, COLOR_BLACK);
+    display_rect(bar_x, bar_y, SLIDER_BAR_W, SLIDER_BAR_H, COLOR_GRAY);
+    display_fill_rect(w->x + SLIDER_FILL_X, bar_y + 2, slider_fill_w(w, w->value), SLIDER_BAR_H - 4, w->bg);
+    draw_slider_readout(w);
+
+    display_fill_rect(w->x + SLIDER_MINUS_X, w->y + SLIDER_BTN_DY, SLIDER_BTN_W, SLIDER_BTN_H, COLOR_GRAY);
+    display_string(w->x + SLIDER_MINUS_X + 6, w->y + SLIDER_BTN_DY + 1, "-", COLOR_WHITE, COLOR_GRAY);
+    display_fill_rect(w->x + SLIDER_PLUS_X, w->y + SLIDER_BTN_DY, SLIDER_BTN_W, SLIDER_BTN_H, COLOR_GRAY);
+    display_string(w->x + SLIDER_PLUS_X + 6, w->y + SLIDER_BTN_DY + 1, "+", COLOR_WHITE, COLOR_GRAY);
+    w->drawn_value = w->value;
+}
+
+// Repaint only the strip between the drawn and the new fill width
+static void draw_slider_delta(ui_widget_t *w) {
+    int16_t old_w = slider_fill_w(w, w->drawn_value);
+    int16_t new_w = slider_fill_w(w, w->value);
+    int16_t fill_x = w->x + SLIDER_FILL_X;
+    int16_t fill_y = w->y + SLIDER_BAR_DY + 2;
+
+    if (new_w > old_w) {
+        display_fill_rect(fill_x + old_w, fill_y, new_w - old_w, SLIDER_BAR_H - 4, w->bg);
+    } else if (new_w < old_w) {
+        display_fill_rect(fill_x + new_w, fill_y, old_w - new_w, SLIDER_BAR_H - 4, COLOR_BLACK);
+    }
+    draw_slider_readout(w);
+    w->drawn_value = w->value;
+}
+
+static void draw_toggle(const ui_widget_t *w) {
+    int16_t box_w = w->width - TOGGLE_INSET_R;
+    int16_t box_h = w->h - 2 * TOGGLE_DY + 1;
+    uint16_t bg = w->on ? w->bg : COLOR_GRAY;
+    uint16_t fg = w->on ? COLOR_BLACK : COLOR_WHITE;
+
+    // Row background around the box
+    display_fill_rect(w->x, w->y, w->width, TOGGLE_DY, UI_COLOR_ITEM_BG);
+    display_fill_rect(w->x, w->y + TOGGLE_DY + box_h, w->width, w->h - TOGGLE_DY - box_h, UI_COLOR_ITEM_BG);
+    display_fill_rect(w->x + box_w, w->y + TOGGLE_DY, TOGGLE_INSET_R, box_h, UI_COLOR_ITEM_BG);
+
+    display_fill_rect(w->x, w->y + TOGGLE_DY, box_w, box_h, bg);
+    display_string(centered_x(w->x, box_w, w->text), w->y + TOGGLE_DY + 1, w->text, fg, bg);
+}
+
+static void draw_widget(ui_widget_t *w) {
+    switch (w->type) {
+        case UI_WIDGET_LABEL:
+            display_fill_rect(w->x, w->y, w->width, w->h, w->bg);
+            display_string(w->x, text_y(w), w->text, w->fg, w->bg);
+            break;
+
+        case UI_WIDGET_MENU_ITEM:
+            display_fill_rect(w->x, w->y, w->width, w->h, w->bg);
+            display_string(w->x + TEXT_PAD, text_y(w), w->text, w->fg, w->bg);
+            if (!(w->flags & UI_WIDGET_NO_ARROW)) {
+                display_string(w->x + w->width - 18, text_y(w), ">", w->fg, w->bg);
+            }
+            break;
+
+        case UI_WIDGET_SLIDER:
+            draw_slider(w);
+            break;
+
+        case UI_WIDGET_TOGGLE:
+            draw_toggle(w);
+            break;
+
+        case UI_WIDGET_BUTTON:
+            display_fill_rect(w->x, w->y, w->width, w->h, w->bg);
+            display_string(centered_x(w->x, w->width, w->text), text_y(w), w->text, w->fg, w->bg);
+            break;
+    }
+}
+
+// A widget's touch area spans the row pitch, so taps in the gap below it
+// still land on it
+static int16_t hit_h(const ui_panel_t *panel, const ui_widget_t *w) {
+    return w->h + panel->row_gap;
+}
+
+void ui_panel_layout(ui_panel_t *panel) {
+    int16_t row_y = panel->top;
+    int16_t row_h = 0;
+    int16_t x = panel->margin;
+
+    memset(panel->bands, 0, sizeof(panel->bands));
+    for (int i = 0; i < panel->count && i < UI_PANEL_MAX_WIDGETS; i++) {
+        ui_widget_t *w = &panel->widgets[i];
+
+        if (i > 0 && (w->flags & UI_WIDGET_SAME_ROW)) {
+            x += w->gap;
+        } else {
+            if (i > 0) row_y += row_h + panel->row_gap;
+            row_y += w->gap;
+            row_h = 0;
+            x = panel->margin;
+        }
+
+        w->width = w->w ? w->w : DISPLAY_WIDTH - panel->margin - x;
+        w->x = (w->flags & UI_WIDGET_CENTER) ? (DISPLAY_WIDTH - w->width) / 2 : x;
+        w->y = row_y;
+        w->dirty = true;
+        x = w->x + w->width;
+        if (w->h > row_h) row_h = w->h;
+
+        int first = w->y / UI_PANEL_BAND_H;
+        int last = (w->y + hit_h(panel, w) - 1) / UI_PANEL_BAND_H;
+        for (int band = first; band <= last && band < UI_PANEL_BANDS; band++) {
+            if (band >= 0) panel->bands[band] |= 1u << i;
+        }
+    }
+}
+
+void ui_panel_draw(ui_panel_t *panel) {
+    for (int i = 0; i < panel->count; i++) {
+        ui_widget_t *w = &panel->widgets[i];
+        if (w->dirty) {
+            draw_widget(w);
+            w->dirty = false;
+        } else if (w->type == UI_WIDGET_SLIDER && w->value != w->drawn_value) {
+            draw_slider_delta(w);
+        }
+    }
+}
+
+void ui_panel_invalidate(ui_panel_t *panel) {
+    for (int i = 0; i < panel->count; i++) {
+        panel->widgets[i].dirty = true;
+    }
+}
+
+int ui_panel_hit(const ui_panel_t *panel, int16_t x, int16_t y) {
+    if (y < 0 || y >= DISPLAY_HEIGHT) return -1;
+
+    uint32_t candidates = panel->bands[y / UI_PANEL_BAND_H];
+    while (candidates) {
+        int i = __builtin_ctz(candidates);
+        candidates &= candidates - 1;
+        const ui_widget_t *w = &panel->widgets[i];
+        if (x >= w->x && x < w->x + w->width && y >= w->y && y < w->y + hit_h(panel, w)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ui_widget_set_text(ui_widget_t *widget, const char *text) {
+    if (widget->text != text) {
+        widget->text = text;
+        widget->dirty = true;
+    }
+}
+
+void ui_widget_set_value(ui_widget_t *widget, uint8_t value) {
+    // Sliders compare against drawn_value when the panel is drawn
+    widget->value = value;
+}
+
+void ui_widget_set_on(ui_widget_t *widget, bool on) {
+    if (widget->on != on) {
+        widget->on = on;
+        widget->dirty = true;
+    }
+}
+
+void ui_widget_invalidate(ui_widget_t *widget) {
+    widget->dirty = true;
+}
+
+ui_slider_part_t ui_slider_part_at(const ui_widget_t *slider, int16_t x) {
+    x -= slider->x;
+    if (x >= SLIDER_BAR_X && x < SLIDER_BAR_X + SLIDER_BAR_W) return UI_SLIDER_PART_BAR;
+    if (x >= SLIDER_MINUS_X && x < SLIDER_MINUS_X + SLIDER_BTN_W) return UI_SLIDER_PART_MINUS;
+    if (x >= SLIDER_PLUS_X && x < SLIDER_PLUS_X + SLIDER_BTN_W) return UI_SLIDER_PART_PLUS;
+    return UI_SLIDER_PART_NONE;
+}
+
+// Inverse of slider_fill_w(), so a touch lands on the value drawn under it
+uint8_t ui_slider_value_at(const ui_widget_t *slider, int16_t x) {
+    int32_t offset = x - slider->x - SLIDER_FILL_X;
+    if (offset < 0) offset = 0;
+    if (offset > SLIDER_FILL_W) offset = SLIDER_FILL_W;
+    return (uint8_t)(offset * slider->max_value / SLIDER_FILL_W);
+}
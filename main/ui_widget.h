@@ -0,0 +1,97 @@
+#ifndef UI_WIDGET_H
+#define UI_WIDGET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "display.h"
+
+// Retained widgets. A screen declares its widgets once, in an array inside a
+// panel; a layout pass places them in rows and indexes them for hit-testing.
+// Setters mark a widget dirty only when its content changes, and drawing the
+// panel repaints just the dirty widgets. Scrolling lists stay on ui_list,
+// which keeps its own state the same way.
+
+typedef enum {
+    UI_WIDGET_LABEL,        // Text on a filled background
+    UI_WIDGET_MENU_ITEM,    // Text on the left, ">" on the right
+    UI_WIDGET_SLIDER,       // Full-width row: text, bar, percentage and -/+ buttons
+    UI_WIDGET_TOGGLE,       // Switch showing text; bg is its color when on
+    UI_WIDGET_BUTTON,       // Filled box with centered text
+} ui_widget_type_t;
+
+// Layout flags
+#define UI_WIDGET_SAME_ROW  (1 << 0)    // Continue the previous widget's row
+#define UI_WIDGET_CENTER    (1 << 1)    // Center horizontally on the screen
+#define UI_WIDGET_NO_ARROW  (1 << 2)    // Menu item without the ">"
+
+typedef struct {
+    ui_widget_type_t type;
+    uint8_t flags;
+    int16_t w;              // Requested width, 0 for the rest of the row
+    int16_t h;
+    int16_t gap;            // Extra space above a new row, or before a widget on the same row
+    const char *text;
+    uint16_t fg;
+    uint16_t bg;            // Fill color (slider: bar fill, toggle: box color when on)
+    uint8_t value;          // Slider position, 0..max_value
+    uint8_t max_value;
+    bool on;                // Toggle state
+
+    // Set by the layout pass
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    bool dirty;
+    uint8_t drawn_value;    // Slider position on screen
+} ui_widget_t;
+
+// Hit-testing table: one bitmask of overlapping widgets per band of rows
+#define UI_PANEL_MAX_WIDGETS    32
+#define UI_PANEL_BAND_H         8
+#define UI_PANEL_BANDS          ((DISPLAY_HEIGHT + UI_PANEL_BAND_H - 1) / UI_PANEL_BAND_H)
+
+typedef struct {
+    ui_widget_t *widgets;
+    int count;              // At most UI_PANEL_MAX_WIDGETS
+    int16_t top;            // y of the first row
+    int16_t margin;         // Left and right inset of each row
+    int16_t row_gap;        // Space between rows
+    uint32_t bands[UI_PANEL_BANDS];
+} ui_panel_t;
+
+// Place every widget, rebuild the hit-testing table and mark all dirty
+void ui_panel_layout(ui_panel_t *panel);
+
+// Repaint dirty widgets
+void ui_panel_draw(ui_panel_t *panel);
+
+// Mark every widget dirty, e.g. after the screen was cleared
+void ui_panel_invalidate(ui_panel_t *panel);
+
+// Index of the widget at a screen point, or -1. Each widget also takes the
+// row gap below it.
+int ui_panel_hit(const ui_panel_t *panel, int16_t x, int16_t y);
+
+// Setters; each marks the widget dirty only if the value differs. Text is
+// compared by pointer, so invalidate after editing a buffer in place. A
+// slider whose value moved repaints only the part of the bar that changed
+// and its percentage, not the whole row.
+void ui_widget_set_text(ui_widget_t *widget, const char *text);
+void ui_widget_set_value(ui_widget_t *widget, uint8_t value);
+void ui_widget_set_on(ui_widget_t *widget, bool on);
+void ui_widget_invalidate(ui_widget_t *widget);
+
+// Parts of a slider row, for hit-testing in callers
+typedef enum {
+    UI_SLIDER_PART_NONE,
+    UI_SLIDER_PART_BAR,
+    UI_SLIDER_PART_MINUS,
+    UI_SLIDER_PART_PLUS,
+} ui_slider_part_t;
+
+ui_slider_part_t ui_slider_part_at(const ui_widget_t *slider, int16_t x);
+
+// Slider value for a point on its bar (clamped to the bar's ends)
+uint8_t ui_slider_value_at(const ui_widget_t *slider, int16_t x);
+
+#endif // UI_WIDGET_H
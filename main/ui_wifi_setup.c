@@ -1,9 +1,11 @@
 #include "ui_wifi_setup.h"
 #include "ui_common.h"
+#include "ui_list.h"
 #include "ui_keyboard.h"
 #include "config.h"
 #include "display.h"
 #include "touch.h"
+#include "input.h"
 #include "wifi.h"
 #include "nvs_config.h"
 #include "esp_log.h"
@@ -16,6 +18,7 @@ static const char *TAG = "ui_wifi_setup";
 // UI States
 typedef enum {
     STATE_SCANNING,
+    STATE_NO_NETWORKS,
     STATE_NETWORK_LIST,
     STATE_PASSWORD_ENTRY,
     STATE_CONNECTING,
@@ -54,52 +57,66 @@ static const char *keyboard_symbols[] = {
 static setup_state_t state = STATE_SCANNING;
 static wifi_network_t networks[MAX_SCAN_RESULTS];
 static int network_count = 0;
+static uint32_t network_generation = 0;
+static bool scan_requested = false;
 static int selected_network = -1;
-static int list_scroll = 0;
+static const char *network_labels[MAX_SCAN_RESULTS];
+static ui_list_t network_list;
 static char password[MAX_PASSWORD_LEN] = {0};
 static int password_len = 0;
 static int keyboard_mode = 0;  // 0=lower, 1=upper, 2=symbols
 static bool shift_active = false;
 static char connected_ssid[MAX_SSID_LEN + 1] = {0};
 static char connected_password[MAX_PASSWORD_LEN] = {0};
-static uint32_t last_touch_time = 0;
 static bool show_back_button = false;
+static wifi_connect_state_t drawn_connect_state = WIFI_CONNECT_IDLE;
+
+// Cancel button on the connecting screen
+#define CANCEL_BTN_X    110
+#define CANCEL_BTN_Y    196
+#define CANCEL_BTN_W    100
+#define CANCEL_BTN_H    28
+
+// Pick up networks found since the last call. Returns true if the list changed.
+static bool refresh_networks(void) {
+    uint32_t generation;
+    int count = wifi_scan_get_results(networks, MAX_SCAN_RESULTS, &generation);
+    if (generation == network_generation) return false;
+    network_generation = generation;
+    network_count = count;
+    return true;
+}
 
+// Wifi-specific row decorations: signal bars and lock icon
+static void decorate_network(ui_canvas_t *canvas, int idx, int16_t y, uint16_t fg, uint16_t bg) {
+    // Signal strength indicator
+    int bars = 0;
+    if (networks[idx].rssi > -50) bars = 4;
+    else if (networks[idx].rssi > -60) bars = 3;
+    else if (networks[idx].rssi > -70) bars = 2;
+    else bars = 1;
+
+    for (int b = 0; b < bars; b++) {
+        int bh = 4 + b * 3;
+        ui_canvas_fill_rect(canvas, DISPLAY_WIDTH - 30 + b * 6, y + UI_LIST_ITEM_H - 4 - bh, 4, bh, fg);
+    }
 
-static void draw_network_list(void) {
-    const char *labels[MAX_SCAN_RESULTS];
-    for (int i = 0; i < network_count; i++) {
-        labels[i] = networks[i].ssid;
+    // Lock icon for secured networks
+    if (networks[idx].authmode) {
+        ui_canvas_string(canvas, DISPLAY_WIDTH - 50, y + 6, "*", fg, bg);
     }
-    ui_draw_list(labels, network_count, list_scroll, selected_network);
-
-    // Wifi-specific decorations: signal bars and lock icon
-    for (int i = 0; i < UI_LIST_VISIBLE && (i + list_scroll) < network_count; i++) {
-        int idx = i + list_scroll;
-        int y = UI_LIST_START_Y + i * UI_LIST_ITEM_H;
-
-        uint16_t bg = (idx == selected_network) ? UI_COLOR_SELECTED : COLOR_BLACK;
-        uint16_t fg = (idx == selected_network) ? COLOR_BLACK : COLOR_WHITE;
-
-        // Signal strength indicator
-        int bars = 0;
-        if (networks[idx].rssi > -50) bars = 4;
-        else if (networks[idx].rssi > -60) bars = 3;
-        else if (networks[idx].rssi > -70) bars = 2;
-        else bars = 1;
-
-        for (int b = 0; b < bars; b++) {
-            int bh = 4 + b * 3;
-            display_fill_rect(DISPLAY_WIDTH - 30 + b * 6, y + UI_LIST_ITEM_H - 4 - bh, 4, bh, fg);
-        }
+}
 
-        // Lock icon for secured networks
-        if (networks[idx].authmode) {
-            display_char(DISPLAY_WIDTH - 50, y + 6, '*', fg, bg);
-        }
+static void update_labels(void) {
+    for (int i = 0; i < network_count; i++) {
+        network_labels[i] = networks[i].ssid;
     }
 }
 
+static void show_network_list(void) {
+    update_labels();
+    ui_list_init(&network_list, network_labels, network_count, selected_network, decorate_network);
+}
 
 static void draw_password_input(void) {
     // Clear password area
@@ -199,8 +216,8 @@ void ui_wifi_setup_init(bool show_back) {
     ESP_LOGI(TAG, "Initializing WiFi setup UI");
     state = STATE_SCANNING;
     network_count = 0;
+    scan_requested = false;
     selected_network = -1;
-    list_scroll = 0;
     password_len = 0;
     password[0] = '\0';
     keyboard_mode = 0;
@@ -210,71 +227,88 @@ void ui_wifi_setup_init(bool show_back) {
 
 wifi_setup_result_t ui_wifi_setup_update(void) {
     touch_point_t touch;
-    bool touched = ui_read_touch(&touch, &last_touch_time);
+    bool touched = ui_read_touch(&touch);
 
     switch (state) {
-        case STATE_SCANNING:
-            display_fill(COLOR_BLACK);
-            ui_draw_header("WiFi Setup", show_back_button);
-            ui_draw_centered_string(120, "Scanning...", COLOR_WHITE, COLOR_BLACK, false);
-
-            wifi_init();
-            network_count = wifi_scan(networks, MAX_SCAN_RESULTS);
+        case STATE_SCANNING: {
+            bool scan_failed = false;
+            if (!scan_requested) {
+                display_fill(COLOR_BLACK);
+                ui_draw_header("WiFi Setup", show_back_button);
+                ui_draw_centered_string(120, "Scanning...", COLOR_WHITE, COLOR_BLACK, false);
+                scan_requested = true;
+                scan_failed = !wifi_scan_start();
+            }
 
+            // Show the list as soon as the first network turns up; the rest
+            // of the channels stream in while it is displayed
+            refresh_networks();
             if (network_count > 0) {
                 state = STATE_NETWORK_LIST;
                 ui_draw_header("Select Network", show_back_button);
-                draw_network_list();
-            } else {
+                show_network_list();
+            } else if (scan_failed || wifi_scan_is_done()) {
+                state = STATE_NO_NETWORKS;
                 display_fill_rect(0, 100, DISPLAY_WIDTH, 40, COLOR_BLACK);
                 ui_draw_centered_string(120, "No networks found", COLOR_RED, COLOR_BLACK, false);
                 ui_draw_centered_string(150, "Tap to retry", COLOR_GRAY, COLOR_BLACK, false);
-
-                if (touched) {
-                    // Back button
-                    if (show_back_button && touch.y < UI_HEADER_HEIGHT && touch.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
-                        return WIFI_SETUP_CANCELLED;
-                    }
-                    state = STATE_SCANNING;
-                }
+            } else if (touched && show_back_button && touch.y < UI_HEADER_HEIGHT &&
+                       touch.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
+                wifi_scan_stop();
+                return WIFI_SETUP_CANCELLED;
             }
             break;
+        }
 
-        case STATE_NETWORK_LIST:
+        case STATE_NO_NETWORKS:
             if (touched) {
                 // Back button
                 if (show_back_button && touch.y < UI_HEADER_HEIGHT && touch.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
                     return WIFI_SETUP_CANCELLED;
                 }
+                state = STATE_SCANNING;
+                scan_requested = false;
+            }
+            break;
 
-                // Check for list item touch - single tap to select
-                if (touch.y >= UI_LIST_START_Y && touch.y < UI_LIST_START_Y + UI_LIST_VISIBLE * UI_LIST_ITEM_H) {
-                    int item = (touch.y - UI_LIST_START_Y) / UI_LIST_ITEM_H + list_scroll;
-                    if (item < network_count) {
-                        selected_network = item;
-                        state = STATE_PASSWORD_ENTRY;
-                        password_len = 0;
-                        password[0] = '\0';
-                        display_fill(COLOR_BLACK);
-                        ui_draw_header("Enter Password", true);
-                        draw_password_input();
-                        draw_keyboard();
-                    }
+        case STATE_NETWORK_LIST: {
+            // Gestures are resolved against the rows on screen, before new
+            // scan results can re-sort them
+            gesture_t gesture;
+            while (gesture_get(&gesture)) {
+                // Back button
+                if (gesture.type == GESTURE_TAP && show_back_button && gesture.y < UI_HEADER_HEIGHT &&
+                    gesture.x < UI_BACK_BTN_X + UI_BACK_BTN_W) {
+                    wifi_scan_stop();
+                    return WIFI_SETUP_CANCELLED;
                 }
 
-                // Scroll up
-                if (touch.y < UI_LIST_START_Y && list_scroll > 0) {
-                    list_scroll--;
-                    draw_network_list();
+                // Single tap on a row selects it; drags and flings scroll
+                int item = ui_list_handle(&network_list, &gesture);
+                if (item >= 0) {
+                    selected_network = item;
+                    state = STATE_PASSWORD_ENTRY;
+                    password_len = 0;
+                    password[0] = '\0';
+                    display_fill(COLOR_BLACK);
+                    ui_draw_header("Enter Password", true);
+                    draw_password_input();
+                    draw_keyboard();
+                    break;
                 }
+            }
 
-                // Scroll down
-                if (touch.y > UI_LIST_START_Y + UI_LIST_VISIBLE * UI_LIST_ITEM_H && list_scroll + UI_LIST_VISIBLE < network_count) {
-                    list_scroll++;
-                    draw_network_list();
+            if (state == STATE_NETWORK_LIST) {
+                // Only take new results between touches, so a row never
+                // changes under the finger; the redraw follows right away
+                if (!input_touch_is_down() && refresh_networks()) {
+                    update_labels();
+                    ui_list_set_items(&network_list, network_labels, network_count);
                 }
+                ui_list_update(&network_list);
             }
             break;
+        }
 
         case STATE_PASSWORD_ENTRY:
             if (touched) {
@@ -284,7 +318,7 @@ wifi_setup_result_t ui_wifi_setup_update(void) {
                     selected_network = -1;
                     display_fill(COLOR_BLACK);
                     ui_draw_header("Select Network", show_back_button);
-                    draw_network_list();
+                    show_network_list();
                     break;
                 }
 
@@ -309,6 +343,12 @@ wifi_setup_result_t ui_wifi_setup_update(void) {
                     ui_draw_header("Connecting", false);
                     ui_draw_centered_string(100, "Connecting to", COLOR_WHITE, COLOR_BLACK, false);
                     ui_draw_centered_string(130, networks[selected_network].ssid, COLOR_CYAN, COLOR_BLACK, false);
+                    display_fill_rect(CANCEL_BTN_X, CANCEL_BTN_Y, CANCEL_BTN_W, CANCEL_BTN_H, COLOR_RED);
+                    display_string(CANCEL_BTN_X + 26, CANCEL_BTN_Y + 7, "Cancel", COLOR_WHITE, COLOR_RED);
+                    drawn_connect_state = WIFI_CONNECT_IDLE;
+                    if (!wifi_connect_async(networks[selected_network].ssid, password, NULL, NULL)) {
+                        state = STATE_FAILED;
+                    }
                 } else if (key >= ' ' && key <= '~' && password_len < MAX_PASSWORD_LEN - 1) {
                     password[password_len++] = key;
                     password[password_len] = '\0';
@@ -321,22 +361,37 @@ wifi_setup_result_t ui_wifi_setup_update(void) {
             }
             break;
 
-        case STATE_CONNECTING:
-            if (wifi_connect(networks[selected_network].ssid, password)) {
+        case STATE_CONNECTING: {
+            if (touched && touch.x >= CANCEL_BTN_X && touch.x < CANCEL_BTN_X + CANCEL_BTN_W &&
+                touch.y >= CANCEL_BTN_Y && touch.y < CANCEL_BTN_Y + CANCEL_BTN_H) {
+                wifi_connect_cancel();
+            }
+
+            wifi_connect_state_t connect_state = wifi_get_connect_state();
+            if (connect_state != drawn_connect_state) {
+                ui_draw_connect_progress(160, connect_state);
+                drawn_connect_state = connect_state;
+            }
+
+            if (connect_state == WIFI_CONNECT_DONE) {
                 strncpy(connected_ssid, networks[selected_network].ssid, sizeof(connected_ssid) - 1);
                 strncpy(connected_password, password, sizeof(connected_password) - 1);
                 state = STATE_CONNECTED;
-                display_fill_rect(0, 160, DISPLAY_WIDTH, 30, COLOR_BLACK);
-                display_string(120, 160, "Connected!", COLOR_GREEN, COLOR_BLACK);
                 vTaskDelay(pdMS_TO_TICKS(1000));
                 return WIFI_SETUP_CONNECTED;
-            } else {
+            } else if (connect_state == WIFI_CONNECT_FAILED) {
                 state = STATE_FAILED;
-                display_fill_rect(0, 160, DISPLAY_WIDTH, 50, COLOR_BLACK);
-                ui_draw_centered_string(160, "Connection failed", COLOR_RED, COLOR_BLACK, false);
+                display_fill_rect(0, CANCEL_BTN_Y, DISPLAY_WIDTH, CANCEL_BTN_H, COLOR_BLACK);
                 ui_draw_centered_string(190, "Tap to retry", COLOR_GRAY, COLOR_BLACK, false);
+            } else if (connect_state == WIFI_CONNECT_CANCELLED) {
+                state = STATE_PASSWORD_ENTRY;
+                display_fill(COLOR_BLACK);
+                ui_draw_header("Enter Password", true);
+                draw_password_input();
+                draw_keyboard();
             }
             break;
+        }
 
         case STATE_CONNECTED:
             return WIFI_SETUP_CONNECTED;
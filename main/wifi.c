@@ -1,15 +1,22 @@
 #include "wifi.h"
 #include "config.h"
+#include "seqlock.h"
+#include "nvs_config.h"
+#include "wifi_roam.h"
+#include "app_event.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "esp_sntp.h"
+#include "esp_random.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
 #include <string.h>
-#include <time.h>
 
 static const char *TAG = "wifi";
 
@@ -17,61 +24,250 @@ static const char *TAG = "wifi";
 static EventGroupHandle_t wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
+#define WIFI_CANCEL_BIT    BIT2
+#define WIFI_STOP_BIT      BIT3     // Supervision withdrawn, abort reconnecting
+#define WIFI_SCAN_DONE_BIT BIT4     // No scan running
+#define WIFI_SUP_IDLE_BIT  BIT5     // Supervisor is not handling an outage
+
+#define CONNECT_TASK_STACK      4096
+#define CONNECT_TASK_PRIORITY   5
+#define SUPERVISOR_TASK_STACK   3072
+#define SUPERVISOR_TASK_PRIORITY 4
 
 static bool wifi_initialized = false;
 static int retry_count = 0;
+static int retry_limit = WIFI_MAX_RETRY;
 
-// NTP state grouped together
+// Pending asynchronous connect
 static struct {
-    bool synced;
-    time_t last_sync_time;
-    uint32_t sync_start_ticks;
-    uint32_t sync_count;
-    uint32_t interval;
-    char custom_server[64];
-} ntp_state = {
-    .synced = false,
-    .last_sync_time = 0,
-    .sync_start_ticks = 0,
-    .sync_count = 0,
-    .interval = NTP_DEFAULT_INTERVAL_SEC,
-    .custom_server = DEFAULT_NTP_SERVER,
-};
+    char ssid[33];
+    char password[64];
+    wifi_connect_cb_t cb;
+    void *arg;
+    bool fallback;          // On failure, let the supervisor reconnect to a known network
+    volatile bool cancelled;
+} connect_req;
+static TaskHandle_t connect_task_handle = NULL;
+
+// Reconnect supervisor: owns the link once a connect has succeeded
+static TaskHandle_t supervisor_task_handle = NULL;
+static volatile bool supervise = false;     // Reconnect if the link drops
+static volatile bool reconnecting = false;  // Supervisor is handling an outage
+static wifi_outage_stats_t outage_stats = {0};
+static seqlock_t outage_seq = SEQLOCK_INIT;
+
+// Incremental scan: one channel per esp_wifi_scan_start(), results merged
+// into a fixed pool from the SCAN_DONE event
+#define SCAN_RECORDS_PER_CHANNEL 16
+
+typedef struct {
+    uint32_t hash;          // FNV-1a of the SSID, compared before the string
+    wifi_network_t net;
+} scan_entry_t;
+
+static scan_entry_t scan_pool[MAX_SCAN_RESULTS];   // Sorted by RSSI, strongest first
+static int scan_pool_count = 0;
+static uint32_t scan_generation = 0;
+static volatile uint8_t scan_channel = 0;           // Channel being scanned, 0 when idle
+static wifi_ap_record_t scan_records[SCAN_RECORDS_PER_CHANNEL];
+static portMUX_TYPE scan_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Power save: the profile's mode applies unless something holds the radio awake
+static wifi_power_profile_t power_profile = WIFI_POWER_BALANCED;
+static int power_holds = 0;
+static bool power_boosted = false;
+static SemaphoreHandle_t power_mutex = NULL;
+static esp_timer_handle_t boost_timer = NULL;
+
+// Written by the event handler and the connect task, read by the UI via
+// wifi_get_status()
+static wifi_status_t wifi_status = {0};
+static seqlock_t wifi_status_seq = SEQLOCK_INIT;
+static portMUX_TYPE wifi_status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void publish_status(bool connected, uint32_t ip) {
+    portENTER_CRITICAL(&wifi_status_lock);
+    seqlock_write_begin(&wifi_status_seq);
+    wifi_status.connected = connected;
+    wifi_status.ip = ip;
+    seqlock_write_end(&wifi_status_seq);
+    portEXIT_CRITICAL(&wifi_status_lock);
+    app_event_post(APP_EVENT_WIFI);
+}
+
+static void publish_connect_state(wifi_connect_state_t state) {
+    portENTER_CRITICAL(&wifi_status_lock);
+    seqlock_write_begin(&wifi_status_seq);
+    wifi_status.connect_state = state;
+    seqlock_write_end(&wifi_status_seq);
+    portEXIT_CRITICAL(&wifi_status_lock);
+    app_event_post(APP_EVENT_WIFI);
+}
+
+static uint32_t ssid_hash(const char *ssid) {
+    uint32_t h = 2166136261u;
+    while (*ssid) {
+        h ^= (uint8_t)*ssid++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Merge one AP into the pool, keeping the strongest AP per SSID and the pool
+// sorted. Caller holds scan_lock. Returns true if the pool changed.
+static bool scan_pool_merge(const wifi_ap_record_t *ap) {
+    const char *ssid = (const char *)ap->ssid;
+    uint32_t hash = ssid_hash(ssid);
+
+    int pos = -1;
+    for (int i = 0; i < scan_pool_count; i++) {
+        if (scan_pool[i].hash == hash && strcmp(scan_pool[i].net.ssid, ssid) == 0) {
+            pos = i;
+            break;
+        }
+    }
+
+    if (pos >= 0) {
+        if (ap->rssi <= scan_pool[pos].net.rssi) return false;
+    } else if (scan_pool_count < MAX_SCAN_RESULTS) {
+        pos = scan_pool_count++;
+    } else if (ap->rssi > scan_pool[MAX_SCAN_RESULTS - 1].net.rssi) {
+        pos = MAX_SCAN_RESULTS - 1;     // Evict the weakest
+    } else {
+        return false;
+    }
+
+    scan_entry_t entry = { .hash = hash };
+    strncpy(entry.net.ssid, ssid, 32);
+    entry.net.ssid[32] = '\0';
+    entry.net.rssi = ap->rssi;
+    entry.net.authmode = (ap->authmode != WIFI_AUTH_OPEN) ? 1 : 0;
+    memcpy(entry.net.bssid, ap->bssid, sizeof(entry.net.bssid));
+    entry.net.channel = ap->primary;
+
+    // Only ever gets stronger, so the entry can only move toward the front
+    while (pos > 0 && scan_pool[pos - 1].net.rssi < entry.net.rssi) {
+        scan_pool[pos] = scan_pool[pos - 1];
+        pos--;
+    }
+    scan_pool[pos] = entry;
+    return true;
+}
+
+static esp_err_t scan_channel_start(uint8_t channel) {
+    wifi_scan_config_t scan_config = {
+        .ssid = NULL,
+        .bssid = NULL,
+        .channel = channel,
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active.min = WIFI_SCAN_DWELL_MIN_MS,
+        .scan_time.active.max = WIFI_SCAN_DWELL_MAX_MS,
+    };
+    return esp_wifi_scan_start(&scan_config, false);
+}
+
+// SCAN_DONE for one channel: merge its APs and move on to the next channel
+static void handle_scan_done(void) {
+    uint16_t n = SCAN_RECORDS_PER_CHANNEL;
+    if (esp_wifi_scan_get_ap_records(&n, scan_records) != ESP_OK) n = 0;
+
+    uint8_t channel = scan_channel;
+    if (channel == 0) return;       // Stopped; records fetched only to free them
+
+    uint8_t next = channel < WIFI_SCAN_CHANNELS ? channel + 1 : 0;
+    bool changed = false;
+    portENTER_CRITICAL(&scan_lock);
+    for (int i = 0; i < n; i++) {
+        if (scan_records[i].ssid[0] == '\0') continue;
+        changed |= scan_pool_merge(&scan_records[i]);
+    }
+    if (changed) scan_generation++;
+    // wifi_scan_stop() may have run since the check above
+    if (scan_channel == channel) {
+        scan_channel = next;
+    } else {
+        next = 0;
+    }
+    portEXIT_CRITICAL(&scan_lock);
+
+    if (next != 0 && scan_channel_start(next) != ESP_OK) {
+        scan_channel = 0;
+        next = 0;
+    }
+    if (next == 0) {
+        ESP_LOGI(TAG, "Scan finished: %d networks", scan_pool_count);
+        xEventGroupSetBits(wifi_event_group, WIFI_SCAN_DONE_BIT);
+    }
+    if (changed || next == 0) {
+        app_event_post(APP_EVENT_WIFI);
+    }
+}
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT) {
         switch (event_id) {
+            case WIFI_EVENT_SCAN_DONE:
+                handle_scan_done();
+                break;
             case WIFI_EVENT_STA_START:
                 ESP_LOGI(TAG, "WiFi station started");
                 break;
+            case WIFI_EVENT_STA_CONNECTED:
+                ESP_LOGI(TAG, "WiFi associated");
+                if (connect_task_handle) publish_connect_state(WIFI_CONNECT_DHCP);
+                break;
             case WIFI_EVENT_STA_DISCONNECTED:
                 ESP_LOGI(TAG, "WiFi disconnected");
-                if (retry_count < WIFI_MAX_RETRY) {
+                if (connect_task_handle) publish_connect_state(WIFI_CONNECT_ASSOCIATING);
+                if (supervise && !reconnecting) {
+                    // Established link lost: the supervisor takes over
+                    xTaskNotifyGive(supervisor_task_handle);
+                } else if (retry_count < retry_limit) {
                     esp_wifi_connect();
                     retry_count++;
-                    ESP_LOGI(TAG, "Retrying connection (%d/%d)", retry_count, WIFI_MAX_RETRY);
+                    ESP_LOGI(TAG, "Retrying connection (%d/%d)", retry_count, retry_limit);
                 } else {
                     xEventGroupSetBits(wifi_event_group, WIFI_FAIL_BIT);
                 }
                 xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+                publish_status(false, 0);
                 break;
             default:
                 break;
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        ESP_LOGI(TAG, "Got IP: " IPSTR " (%lld ms since boot)", IP2STR(&event->ip_info.ip),
+                 (long long)esp_timer_get_time() / 1000);
         retry_count = 0;
+        publish_status(true, event->ip_info.ip.addr);
         xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
 
-static void time_sync_notification_cb(struct timeval *tv) {
-    ntp_state.synced = true;
-    ntp_state.last_sync_time = tv->tv_sec;
-    ntp_state.sync_count++;
-    ESP_LOGI(TAG, "NTP time synchronized (sync #%lu)", (unsigned long)ntp_state.sync_count);
+// Set the driver's power save mode from the profile and current holds
+static void apply_power_save(void) {
+    static const wifi_ps_type_t profile_ps[WIFI_POWER_PROFILE_COUNT] = {
+        [WIFI_POWER_PERFORMANCE] = WIFI_PS_NONE,
+        [WIFI_POWER_BALANCED] = WIFI_PS_MIN_MODEM,
+        [WIFI_POWER_SAVER] = WIFI_PS_MAX_MODEM,
+    };
+    static wifi_ps_type_t applied = WIFI_PS_MIN_MODEM;   // Driver default
+
+    if (!power_mutex) return;   // Applied by wifi_init
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    wifi_ps_type_t ps = (power_holds > 0 || power_boosted) ? WIFI_PS_NONE : profile_ps[power_profile];
+    if (ps != applied && esp_wifi_set_ps(ps) == ESP_OK) {
+        applied = ps;
+    }
+    xSemaphoreGive(power_mutex);
+}
+
+static void boost_timer_cb(void *arg) {
+    power_boosted = false;
+    apply_power_save();
 }
 
 void wifi_init(void) {
@@ -80,6 +276,7 @@ void wifi_init(void) {
     ESP_LOGI(TAG, "Initializing WiFi");
 
     wifi_event_group = xEventGroupCreate();
+    xEventGroupSetBits(wifi_event_group, WIFI_SUP_IDLE_BIT);
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -97,217 +294,469 @@ void wifi_init(void) {
                                                         &wifi_event_handler,
                                                         NULL, NULL));
 
+    // Request NTP servers (option 42) in DHCP; lwIP stores them in its SNTP
+    // server table, which wifi_ntp prefers over the configured server
+    esp_sntp_servermode_dhcp(true);
+
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    power_mutex = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t boost_args = {
+        .callback = boost_timer_cb,
+        .name = "wifi_boost",
+    };
+    esp_timer_create(&boost_args, &boost_timer);
+    apply_power_save();
+
     wifi_initialized = true;
     ESP_LOGI(TAG, "WiFi initialized");
 }
 
-int wifi_scan(wifi_network_t *networks, int max_networks) {
+bool wifi_scan_start(void) {
     if (!wifi_initialized) {
         wifi_init();
     }
+    if (scan_channel != 0) return true;     // Already running
 
     ESP_LOGI(TAG, "Starting WiFi scan");
 
-    wifi_scan_config_t scan_config = {
-        .ssid = NULL,
-        .bssid = NULL,
-        .channel = 0,
-        .show_hidden = false,
-        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
-        .scan_time.active.min = 100,
-        .scan_time.active.max = 300,
-    };
-
-    ESP_ERROR_CHECK(esp_wifi_scan_start(&scan_config, true));
-
-    uint16_t ap_count = 0;
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count));
-
-    if (ap_count == 0) {
-        ESP_LOGI(TAG, "No networks found");
-        return 0;
-    }
-
-    wifi_ap_record_t *ap_records = malloc(sizeof(wifi_ap_record_t) * ap_count);
-    if (!ap_records) {
-        ESP_LOGE(TAG, "Failed to allocate memory for scan results");
-        return 0;
+    portENTER_CRITICAL(&scan_lock);
+    scan_pool_count = 0;
+    scan_generation++;
+    portEXIT_CRITICAL(&scan_lock);
+
+    // Set before starting: SCAN_DONE may arrive before esp_wifi_scan_start returns
+    xEventGroupClearBits(wifi_event_group, WIFI_SCAN_DONE_BIT);
+    scan_channel = 1;
+    if (scan_channel_start(1) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start scan");
+        scan_channel = 0;
+        xEventGroupSetBits(wifi_event_group, WIFI_SCAN_DONE_BIT);
+        return false;
     }
+    return true;
+}
 
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&ap_count, ap_records));
-
-    int count = 0;
-    for (int i = 0; i < ap_count && count < max_networks; i++) {
-        // Skip empty SSIDs
-        if (ap_records[i].ssid[0] == '\0') continue;
-
-        // Skip duplicates
-        bool duplicate = false;
-        for (int j = 0; j < count; j++) {
-            if (strcmp(networks[j].ssid, (char *)ap_records[i].ssid) == 0) {
-                duplicate = true;
-                break;
-            }
-        }
-        if (duplicate) continue;
+void wifi_scan_stop(void) {
+    portENTER_CRITICAL(&scan_lock);
+    bool running = scan_channel != 0;
+    scan_channel = 0;
+    portEXIT_CRITICAL(&scan_lock);
 
-        strncpy(networks[count].ssid, (char *)ap_records[i].ssid, 32);
-        networks[count].ssid[32] = '\0';
-        networks[count].rssi = ap_records[i].rssi;
-        networks[count].authmode = (ap_records[i].authmode != WIFI_AUTH_OPEN) ? 1 : 0;
-        count++;
+    if (running) {
+        esp_wifi_scan_stop();
+        xEventGroupSetBits(wifi_event_group, WIFI_SCAN_DONE_BIT);
     }
+}
 
-    free(ap_records);
-    ESP_LOGI(TAG, "Found %d networks", count);
-    return count;
+bool wifi_scan_is_done(void) {
+    return scan_channel == 0;
 }
 
-bool wifi_connect(const char *ssid, const char *password) {
-    if (!wifi_initialized) {
-        wifi_init();
+bool wifi_scan_wait(void) {
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, WIFI_SCAN_DONE_BIT | WIFI_STOP_BIT,
+                                           pdFALSE, pdFALSE, portMAX_DELAY);
+    if (!(bits & WIFI_SCAN_DONE_BIT)) {
+        wifi_scan_stop();
+        return false;
     }
+    return true;
+}
 
-    ESP_LOGI(TAG, "Connecting to %s", ssid);
-
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid) - 1);
-    strncpy((char *)wifi_config.sta.password, password, sizeof(wifi_config.sta.password) - 1);
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+int wifi_scan_get_results(wifi_network_t *networks, int max_networks, uint32_t *generation) {
+    portENTER_CRITICAL(&scan_lock);
+    int count = scan_pool_count < max_networks ? scan_pool_count : max_networks;
+    for (int i = 0; i < count; i++) {
+        networks[i] = scan_pool[i].net;
+    }
+    if (generation) *generation = scan_generation;
+    portEXIT_CRITICAL(&scan_lock);
+    return count;
+}
 
+static bool connect_attempt(wifi_config_t *wifi_config, uint32_t timeout_ms, int max_retry) {
     // Clear previous state
     xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
     retry_count = 0;
+    retry_limit = max_retry;
+    publish_connect_state(WIFI_CONNECT_ASSOCIATING);
 
+    wifi_scan_stop();
     esp_wifi_disconnect();
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, wifi_config));
     ESP_ERROR_CHECK(esp_wifi_connect());
 
-    // Wait for connection or failure
+    // Wait for connection, failure or cancellation
     EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
-                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT | WIFI_CANCEL_BIT,
                                            pdFALSE, pdFALSE,
-                                           pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+                                           pdMS_TO_TICKS(timeout_ms));
+    retry_limit = WIFI_MAX_RETRY;
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
+// Remember the AP we ended up on so the next boot can skip the scan
+static void save_ap_cache(const char *ssid, const wifi_ap_cache_t *old) {
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) return;
+
+    wifi_ap_cache_t cache = {0};
+    strncpy(cache.ssid, ssid, sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+    cache.channel = ap_info.primary;
+
+    // Only write flash when something changed
+    if (!old || memcmp(old, &cache, sizeof(cache)) != 0) {
+        nvs_config_set_wifi_ap_cache(&cache);
+    }
+}
+
+static void make_sta_config(wifi_config_t *wifi_config, const char *ssid, const char *password) {
+    memset(wifi_config, 0, sizeof(*wifi_config));
+    strncpy((char *)wifi_config->sta.ssid, ssid, sizeof(wifi_config->sta.ssid) - 1);
+    strncpy((char *)wifi_config->sta.password, password, sizeof(wifi_config->sta.password) - 1);
+    wifi_config->sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    if (power_profile == WIFI_POWER_SAVER) {
+        wifi_config->sta.listen_interval = WIFI_PS_LISTEN_INTERVAL;
+    }
+}
+
+// Blocking connect sequence, run on the connect task
+static bool do_connect(const char *ssid, const char *password) {
+    int64_t start_us = esp_timer_get_time();
+
+    wifi_config_t wifi_config;
+    make_sta_config(&wifi_config, ssid, password);
+
+    // Directed connect to the last known AP: single channel, no scan of the band
+    wifi_ap_cache_t cache;
+    bool have_cache = nvs_config_get_wifi_ap_cache(&cache) && strcmp(cache.ssid, ssid) == 0;
+    bool connected = false;
+
+    if (have_cache) {
+        ESP_LOGI(TAG, "Connecting to %s (cached AP on channel %d)", ssid, cache.channel);
+        wifi_config_t directed = wifi_config;
+        directed.sta.bssid_set = true;
+        memcpy(directed.sta.bssid, cache.bssid, sizeof(directed.sta.bssid));
+        directed.sta.channel = cache.channel;
+        connected = connect_attempt(&directed, WIFI_FAST_CONNECT_TIMEOUT_MS, WIFI_FAST_CONNECT_RETRY);
+        if (!connected && !connect_req.cancelled) {
+            ESP_LOGW(TAG, "Cached AP not reachable, falling back to full connect");
+        }
+    }
+
+    if (!connected && !connect_req.cancelled) {
+        ESP_LOGI(TAG, "Connecting to %s", ssid);
+        connected = connect_attempt(&wifi_config, WIFI_CONNECT_TIMEOUT_MS, WIFI_MAX_RETRY);
+    }
 
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "Connected to %s", ssid);
+    if (connected) {
+        ESP_LOGI(TAG, "Connected to %s in %lld ms (%lld ms since boot)", ssid,
+                 (long long)(esp_timer_get_time() - start_us) / 1000,
+                 (long long)esp_timer_get_time() / 1000);
+        save_ap_cache(ssid, have_cache ? &cache : NULL);
         return true;
     } else {
-        ESP_LOGW(TAG, "Failed to connect to %s", ssid);
+        ESP_LOGW(TAG, "%s connecting to %s", connect_req.cancelled ? "Cancelled" : "Failed", ssid);
         return false;
     }
 }
 
-bool wifi_is_connected(void) {
-    if (!wifi_event_group) return false;
-    return (xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+static void update_outage(bool active, uint32_t duration_ms, bool attempt) {
+    portENTER_CRITICAL(&wifi_status_lock);
+    seqlock_write_begin(&outage_seq);
+    if (active && !outage_stats.active) {
+        outage_stats.count++;
+    }
+    if (active) {
+        outage_stats.current_ms = duration_ms;
+    } else if (outage_stats.active) {
+        outage_stats.current_ms = 0;
+        outage_stats.last_ms = duration_ms;
+        outage_stats.total_ms += duration_ms;
+        if (duration_ms > outage_stats.longest_ms) outage_stats.longest_ms = duration_ms;
+    }
+    if (attempt) outage_stats.attempts++;
+    outage_stats.active = active;
+    seqlock_write_end(&outage_seq);
+    portEXIT_CRITICAL(&wifi_status_lock);
 }
 
-void wifi_disconnect(void) {
-    esp_wifi_disconnect();
-    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+// One reconnect try with the driver's own retries disabled
+static bool reconnect_attempt(void) {
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    retry_count = 0;
+    retry_limit = 0;
+    if (esp_wifi_connect() != ESP_OK) return false;
+
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT | WIFI_STOP_BIT,
+                                           pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+    if (bits & WIFI_CONNECTED_BIT) return true;
+    if (!(bits & WIFI_FAIL_BIT)) {
+        esp_wifi_disconnect();      // Timed out mid-handshake; start clean next time
+    }
+    return false;
 }
 
-void wifi_start_ntp(void) {
-    const char *server = wifi_get_custom_ntp_server();
+// Handle one outage: work through the known networks, best first, with
+// exponential backoff and full jitter between rounds until the link is back
+// or supervision is withdrawn
+static void run_outage(void) {
+    int64_t start_us = esp_timer_get_time();
+    uint32_t backoff_ms = WIFI_RECONNECT_MIN_MS;
+
+    ESP_LOGW(TAG, "Link lost, reconnecting");
+    reconnecting = true;
+    xEventGroupClearBits(wifi_event_group, WIFI_SUP_IDLE_BIT);
+    update_outage(true, 0, false);
+
+    wifi_cred_t creds[WIFI_CRED_MAX];
+    int count = 0, next = 0;
+    bool connected = false;
+    while (supervise) {
+        if (next == 0) {
+            // Re-rank each round; with a choice of networks, scan first
+            count = wifi_roam_candidates(creds, WIFI_CRED_MAX);
+            if (count > 1) {
+                if (!wifi_roam_refresh_scan()) break;   // Stopped mid-scan
+                count = wifi_roam_candidates(creds, WIFI_CRED_MAX);
+            }
+        }
 
-    ESP_LOGI(TAG, "Starting NTP sync (server: %s, interval: %lu sec)",
-             server, (unsigned long)ntp_state.interval);
+        // Networks set up in this session but not saved are still worth a try
+        const char *ssid = count > 0 ? creds[next].ssid : connect_req.ssid;
+        const char *password = count > 0 ? creds[next].password : connect_req.password;
+        next = count > 0 ? (next + 1) % count : 0;
+
+        // Full config without the cached BSSID: the AP may come back on another channel
+        wifi_config_t wifi_config;
+        make_sta_config(&wifi_config, ssid, password);
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+
+        uint32_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+        update_outage(true, elapsed_ms, true);
+        ESP_LOGI(TAG, "Reconnecting to %s", ssid);
+        if (reconnect_attempt()) {
+            wifi_roam_report(ssid, true, wifi_get_rssi());
+            if (ssid != connect_req.ssid) {
+                strncpy(connect_req.ssid, ssid, sizeof(connect_req.ssid) - 1);
+                strncpy(connect_req.password, password, sizeof(connect_req.password) - 1);
+            }
+            connected = true;
+            break;
+        }
+        wifi_roam_report(ssid, false, 0);
+        if (next != 0) continue;
+
+        // Spread retries so clocks on the same AP don't reconnect in lockstep
+        uint32_t delay_ms = backoff_ms / 2 + esp_random() % (backoff_ms / 2 + 1);
+        ESP_LOGI(TAG, "Reconnect failed, next try in %lu ms", (unsigned long)delay_ms);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(delay_ms));   // Woken early on stop
+
+        backoff_ms *= 2;
+        if (backoff_ms > WIFI_RECONNECT_MAX_MS) backoff_ms = WIFI_RECONNECT_MAX_MS;
+    }
 
-    ntp_state.sync_start_ticks = xTaskGetTickCount();
+    uint32_t duration_ms = (esp_timer_get_time() - start_us) / 1000;
+    update_outage(false, duration_ms, false);
+    retry_limit = WIFI_MAX_RETRY;
+    reconnecting = false;
+    xEventGroupSetBits(wifi_event_group, WIFI_SUP_IDLE_BIT);
 
-    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    esp_sntp_setservername(0, server);
-    esp_sntp_set_sync_interval(ntp_state.interval * 1000);  // Convert to ms
-    sntp_set_time_sync_notification_cb(time_sync_notification_cb);
-    esp_sntp_init();
+    if (connected) {
+        ESP_LOGI(TAG, "Reconnected after %lu ms", (unsigned long)duration_ms);
+        // The clock free-ran through the outage: resync right away
+        wifi_ntp_sync_now();
+    }
 }
 
-bool wifi_time_is_synced(void) {
-    return ntp_state.synced;
+// Withdraw supervision and wait for an outage in progress to wind down
+static void stop_supervisor(void) {
+    supervise = false;
+    if (!supervisor_task_handle) return;
+    xEventGroupSetBits(wifi_event_group, WIFI_STOP_BIT);
+    xTaskNotifyGive(supervisor_task_handle);
+    xEventGroupWaitBits(wifi_event_group, WIFI_SUP_IDLE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
 }
 
-void wifi_set_timezone(const char *tz) {
-    ESP_LOGI(TAG, "Setting timezone: %s", tz);
-    setenv("TZ", tz, 1);
-    tzset();
+static void supervisor_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (supervise && !wifi_is_connected()) {
+            run_outage();
+        }
+    }
 }
 
-void wifi_get_ntp_stats(ntp_stats_t *stats) {
-    stats->synced = ntp_state.synced;
-    stats->last_sync_time = ntp_state.last_sync_time;
-    stats->sync_count = ntp_state.sync_count;
-    stats->sync_interval = ntp_state.interval;
+static void connect_task(void *arg) {
+    bool connected = do_connect(connect_req.ssid, connect_req.password);
+    if (!connect_req.cancelled) {
+        wifi_roam_report(connect_req.ssid, connected, connected ? wifi_get_rssi() : 0);
+    }
 
-    // Calculate elapsed time since sync started
-    if (!ntp_state.synced && ntp_state.sync_start_ticks > 0) {
-        stats->sync_elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - ntp_state.sync_start_ticks);
+    if (connected) {
+        xEventGroupClearBits(wifi_event_group, WIFI_STOP_BIT);
+        supervise = true;
     } else {
-        stats->sync_elapsed_ms = 0;
+        // Stop the driver from retrying in the background (the next
+        // connect attempt restores the limit)
+        retry_limit = 0;
+        esp_wifi_disconnect();
+
+        if (connect_req.fallback && !connect_req.cancelled) {
+            // Roam target unreachable: recover like any other outage
+            xEventGroupClearBits(wifi_event_group, WIFI_STOP_BIT);
+            supervise = true;
+            xTaskNotifyGive(supervisor_task_handle);
+        }
     }
 
-    // Get current server (index 0 is primary)
-    stats->server = esp_sntp_getservername(0);
-    if (!stats->server) {
-        stats->server = "N/A";
+    // Clear the handle first so whoever sees the final state can start the next connect
+    bool cancelled = connect_req.cancelled;
+    wifi_connect_cb_t cb = connect_req.cb;
+    void *cb_arg = connect_req.arg;
+    connect_task_handle = NULL;
+
+    publish_connect_state(connected ? WIFI_CONNECT_DONE :
+                          cancelled ? WIFI_CONNECT_CANCELLED : WIFI_CONNECT_FAILED);
+    if (cb) {
+        cb(connected, cb_arg);
     }
+    vTaskDelete(NULL);
 }
 
-void wifi_set_ntp_interval(uint32_t seconds) {
-    if (seconds < NTP_MIN_INTERVAL_SEC) seconds = NTP_MIN_INTERVAL_SEC;
-    ntp_state.interval = seconds;
+static bool start_connect(const char *ssid, const char *password, wifi_connect_cb_t cb, void *arg,
+                          bool fallback) {
+    if (!wifi_initialized) {
+        wifi_init();
+    }
+    if (connect_task_handle) {
+        ESP_LOGW(TAG, "Connect already in progress");
+        return false;
+    }
+
+    // A new connect replaces the supervised link
+    stop_supervisor();
+    if (!supervisor_task_handle) {
+        xTaskCreate(supervisor_task, "wifi_sup", SUPERVISOR_TASK_STACK, NULL,
+                    SUPERVISOR_TASK_PRIORITY, &supervisor_task_handle);
+    }
 
-    // Update the running SNTP if initialized
-    if (esp_sntp_enabled()) {
-        esp_sntp_stop();
-        esp_sntp_set_sync_interval(seconds * 1000);
-        esp_sntp_init();
+    strncpy(connect_req.ssid, ssid, sizeof(connect_req.ssid) - 1);
+    connect_req.ssid[sizeof(connect_req.ssid) - 1] = '\0';
+    strncpy(connect_req.password, password, sizeof(connect_req.password) - 1);
+    connect_req.password[sizeof(connect_req.password) - 1] = '\0';
+    connect_req.cb = cb;
+    connect_req.arg = arg;
+    connect_req.fallback = fallback;
+    connect_req.cancelled = false;
+    xEventGroupClearBits(wifi_event_group, WIFI_CANCEL_BIT);
+
+    publish_connect_state(WIFI_CONNECT_ASSOCIATING);
+    if (xTaskCreate(connect_task, "wifi_conn", CONNECT_TASK_STACK, NULL,
+                    CONNECT_TASK_PRIORITY, &connect_task_handle) != pdPASS) {
+        publish_connect_state(WIFI_CONNECT_FAILED);
+        return false;
     }
+    return true;
 }
 
-void wifi_force_ntp_sync(void) {
-    // Full restart to pick up any new server/interval settings
-    if (esp_sntp_enabled()) {
-        ntp_state.synced = false;  // Reset so UI shows "Syncing..." state
-        esp_sntp_stop();
-        wifi_start_ntp();
+bool wifi_connect_async(const char *ssid, const char *password, wifi_connect_cb_t cb, void *arg) {
+    return start_connect(ssid, password, cb, arg, false);
+}
+
+bool wifi_switch_network(const char *ssid, const char *password) {
+    return start_connect(ssid, password, NULL, NULL, true);
+}
+
+void wifi_connect_cancel(void) {
+    if (connect_task_handle) {
+        connect_req.cancelled = true;
+        xEventGroupSetBits(wifi_event_group, WIFI_CANCEL_BIT);
     }
 }
 
-void wifi_restart_ntp(void) {
-    // Restart NTP with current server if running
-    if (esp_sntp_enabled()) {
-        esp_sntp_stop();
-        wifi_start_ntp();
+wifi_connect_state_t wifi_get_connect_state(void) {
+    wifi_status_t status;
+    wifi_get_status(&status);
+    return status.connect_state;
+}
+
+bool wifi_is_connected(void) {
+    if (!wifi_event_group) return false;
+    return (xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+}
+
+void wifi_disconnect(void) {
+    stop_supervisor();
+    esp_wifi_disconnect();
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+}
+
+void wifi_get_status(wifi_status_t *status) {
+    SEQLOCK_READ(&wifi_status_seq, status, &wifi_status);
+}
+
+void wifi_set_power_profile(wifi_power_profile_t profile) {
+    if (profile >= WIFI_POWER_PROFILE_COUNT) return;
+    ESP_LOGI(TAG, "Power profile: %s", wifi_power_profile_name(profile));
+    power_profile = profile;
+    apply_power_save();
+}
+
+wifi_power_profile_t wifi_get_power_profile(void) {
+    return power_profile;
+}
+
+const char *wifi_power_profile_name(wifi_power_profile_t profile) {
+    switch (profile) {
+        case WIFI_POWER_PERFORMANCE: return "Fast";
+        case WIFI_POWER_BALANCED:    return "Bal";
+        case WIFI_POWER_SAVER:       return "Eco";
+        default:                     return "?";
     }
 }
 
-const char *wifi_get_custom_ntp_server(void) {
-    return ntp_state.custom_server[0] ? ntp_state.custom_server : DEFAULT_NTP_SERVER;
+void wifi_power_hold(void) {
+    if (!power_mutex) return;
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    power_holds++;
+    xSemaphoreGive(power_mutex);
+    apply_power_save();
 }
 
-void wifi_set_custom_ntp_server(const char *server) {
-    strncpy(ntp_state.custom_server, server, sizeof(ntp_state.custom_server) - 1);
-    ntp_state.custom_server[sizeof(ntp_state.custom_server) - 1] = '\0';
+void wifi_power_release(void) {
+    if (!power_mutex) return;
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    if (power_holds > 0) power_holds--;
+    xSemaphoreGive(power_mutex);
+    apply_power_save();
 }
 
-uint32_t wifi_get_ntp_interval(void) {
-    return ntp_state.interval;
+void wifi_power_boost(void) {
+    if (!boost_timer || power_profile == WIFI_POWER_PERFORMANCE) return;
+    esp_timer_stop(boost_timer);
+    esp_timer_start_once(boost_timer, (uint64_t)WIFI_PS_UI_BOOST_MS * 1000);
+    if (!power_boosted) {
+        power_boosted = true;
+        apply_power_save();
+    }
+}
+
+void wifi_get_outage_stats(wifi_outage_stats_t *stats) {
+    SEQLOCK_READ(&outage_seq, stats, &outage_stats);
 }
 
 void wifi_get_ip_str(char *buf, size_t len) {
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    if (netif && wifi_is_connected()) {
-        esp_netif_ip_info_t ip_info;
-        if (esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
-            snprintf(buf, len, IPSTR, IP2STR(&ip_info.ip));
-            return;
-        }
-    }
-    snprintf(buf, len, "0.0.0.0");
+    wifi_status_t status;
+    wifi_get_status(&status);
+
+    // ip is 0 while disconnected, which formats as "0.0.0.0"
+    esp_ip4_addr_t ip = { .addr = status.ip };
+    snprintf(buf, len, IPSTR, IP2STR(&ip));
 }
 
 int8_t wifi_get_rssi(void) {
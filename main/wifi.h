@@ -2,19 +2,63 @@
 #define WIFI_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
 #define MAX_SCAN_RESULTS 15
 #define DEFAULT_NTP_SERVER "pool.ntp.org"
+#define NTP_SERVER_NAME_LEN 64
+#define NTP_HISTORY_LEN 64
 
 // WiFi network info from scan
 typedef struct {
     char ssid[33];
     int8_t rssi;
     uint8_t authmode;  // 0 = open, other = secured
+    uint8_t bssid[6];  // Strongest AP seen for this SSID
+    uint8_t channel;
 } wifi_network_t;
 
+// Progress of an asynchronous connect
+typedef enum {
+    WIFI_CONNECT_IDLE,
+    WIFI_CONNECT_ASSOCIATING, // Finding the AP, associating and authenticating
+    WIFI_CONNECT_DHCP,        // Associated, waiting for an IP address
+    WIFI_CONNECT_DONE,        // Got an IP address
+    WIFI_CONNECT_FAILED,
+    WIFI_CONNECT_CANCELLED,
+} wifi_connect_state_t;
+
+// Radio power profiles
+typedef enum {
+    WIFI_POWER_PERFORMANCE,   // Radio always awake
+    WIFI_POWER_BALANCED,      // Modem sleep between DTIM beacons (driver default)
+    WIFI_POWER_SAVER,         // Max modem sleep with a long listen interval
+    WIFI_POWER_PROFILE_COUNT,
+} wifi_power_profile_t;
+
+// Completion callback (runs on the WiFi connect task)
+typedef void (*wifi_connect_cb_t)(bool connected, void *arg);
+
+// Connection status (snapshot, safe to poll from any task)
+typedef struct {
+    bool connected;
+    uint32_t ip;              // IPv4 address (network byte order), 0 when disconnected
+    wifi_connect_state_t connect_state;
+} wifi_status_t;
+
+// Link outages since boot (link lost after a successful connect)
+typedef struct {
+    uint32_t count;           // Outages so far, including one in progress
+    bool active;              // Currently reconnecting
+    uint32_t current_ms;      // Length of the outage in progress
+    uint32_t last_ms;         // Length of the most recent completed outage
+    uint32_t longest_ms;      // Longest completed outage
+    uint32_t total_ms;        // Sum of completed outages
+    uint32_t attempts;        // Reconnect attempts across all outages
+} wifi_outage_stats_t;
+
 // NTP statistics
 typedef struct {
     bool synced;              // Whether time has been synced at least once
@@ -22,26 +66,90 @@ typedef struct {
     uint32_t sync_count;      // Total number of successful syncs
     uint32_t sync_interval;   // Current sync interval in seconds
     uint32_t sync_elapsed_ms; // Milliseconds since sync attempt started (when not synced)
-    const char *server;       // Current NTP server name
+    char server[NTP_SERVER_NAME_LEN]; // Current NTP server name
+    uint8_t stratum;          // Stratum of the server at the last sync
+    uint32_t server_ip;       // IPv4 address of that server (network byte order)
+    bool server_from_dhcp;    // That server was advertised by DHCP (option 42)
+    uint32_t root_delay_us;   // Round-trip delay to the reference clock at the last sync
+    uint32_t root_dispersion_us; // Error bound to the reference clock at the last sync
 } ntp_stats_t;
 
+// Per-sync NTP measurement
+typedef struct {
+    time_t time;              // UTC time of the measurement
+    int32_t offset_us;        // Correction applied (server minus local, clamped to +/-2147 s)
+    uint32_t delay_us;        // Round-trip network delay
+    uint32_t server_ip;       // IPv4 address of the answering server (network byte order)
+    int8_t rssi;              // WiFi signal strength at the time (dBm)
+} ntp_sample_t;
+
 // Initialize WiFi subsystem
 void wifi_init(void);
 
-// Scan for available networks
-// Returns number of networks found (up to MAX_SCAN_RESULTS)
-int wifi_scan(wifi_network_t *networks, int max_networks);
+// Start a background scan, one channel at a time. Results stream into a
+// fixed pool (one entry per SSID, strongest AP, sorted by RSSI) as each
+// channel completes. Returns false if the scan could not be started.
+bool wifi_scan_start(void);
+
+// Abort a running scan (connecting does this automatically)
+void wifi_scan_stop(void);
+
+// True once every channel has been scanned (or the scan was stopped)
+bool wifi_scan_is_done(void);
+
+// Block until the running scan is done. Returns false if supervision was
+// withdrawn first (wifi_disconnect or a new connect), in which case the scan
+// is stopped.
+bool wifi_scan_wait(void);
+
+// Copy the networks found so far, strongest first. generation (optional)
+// receives a counter that changes whenever the results change.
+// Returns number of networks copied (up to MAX_SCAN_RESULTS).
+int wifi_scan_get_results(wifi_network_t *networks, int max_networks, uint32_t *generation);
 
-// Connect to a network
-// Returns true if connection initiated successfully
-bool wifi_connect(const char *ssid, const char *password);
+// Connect to a network in the background. Progress is reported in
+// wifi_status_t.connect_state; cb (optional) is called once on completion.
+// Returns false if another connect is already in progress.
+bool wifi_connect_async(const char *ssid, const char *password, wifi_connect_cb_t cb, void *arg);
+
+// Move an established link to another network (roaming). Like
+// wifi_connect_async, but if it fails the reconnect supervisor takes over
+// instead of leaving the clock offline.
+bool wifi_switch_network(const char *ssid, const char *password);
+
+// Abort an in-progress connect (completes with WIFI_CONNECT_CANCELLED)
+void wifi_connect_cancel(void);
+
+// Current connect progress
+wifi_connect_state_t wifi_get_connect_state(void);
 
 // Check if connected to WiFi
 bool wifi_is_connected(void);
 
-// Disconnect from WiFi
+// Disconnect from WiFi (also stops automatic reconnection)
 void wifi_disconnect(void);
 
+// Outage counters from the reconnect supervisor, which keeps retrying with
+// backoff whenever an established link drops
+void wifi_get_outage_stats(wifi_outage_stats_t *stats);
+
+// Get connection status without blocking
+void wifi_get_status(wifi_status_t *status);
+
+// Select the radio power profile. Network time requests and UI interaction
+// still get the radio fully awake while they run. The saver profile's listen
+// interval applies from the next association.
+void wifi_set_power_profile(wifi_power_profile_t profile);
+wifi_power_profile_t wifi_get_power_profile(void);
+const char *wifi_power_profile_name(wifi_power_profile_t profile);
+
+// Keep the radio fully awake while held (counted; pair every hold with a release)
+void wifi_power_hold(void);
+void wifi_power_release(void);
+
+// Keep the radio fully awake for WIFI_PS_UI_BOOST_MS (call on UI interaction)
+void wifi_power_boost(void);
+
 // Start NTP time sync
 void wifi_start_ntp(void);
 
@@ -51,6 +159,11 @@ bool wifi_time_is_synced(void);
 // Get NTP statistics
 void wifi_get_ntp_stats(ntp_stats_t *stats);
 
+// Copy NTP measurement history, oldest first (up to NTP_HISTORY_LEN samples)
+// total (optional) receives the number of samples ever recorded, so sample i
+// has sequence number total - count + i. Returns number of samples copied.
+int wifi_get_ntp_history(ntp_sample_t *samples, int max_samples, uint32_t *total);
+
 // Set NTP sync interval (in seconds, minimum 15)
 void wifi_set_ntp_interval(uint32_t seconds);
 
@@ -60,8 +173,12 @@ uint32_t wifi_get_ntp_interval(void);
 // Force an immediate NTP sync
 void wifi_force_ntp_sync(void);
 
+// Sync now without dropping the synced state (takes a full burst when
+// already synced), e.g. after the network comes back
+void wifi_ntp_sync_now(void);
+
 // NTP server management
-const char *wifi_get_custom_ntp_server(void);
+void wifi_get_custom_ntp_server(char *server, size_t len);
 void wifi_set_custom_ntp_server(const char *server);
 void wifi_restart_ntp(void);
 
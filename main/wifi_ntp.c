@@ -0,0 +1,419 @@
+#include "wifi.h"
+#include "config.h"
+#include "ntp_client.h"
+#include "seqlock.h"
+#include "dns_cache.h"
+#include "timekeep.h"
+#include "app_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_netif.h"
+#include "esp_sntp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+static const char *TAG = "wifi_ntp";
+
+#define NTP_TASK_STACK      4096
+#define NTP_TASK_PRIORITY   5
+
+// Set when the configured server sent a DENY/RSTR kiss code; cleared when
+// the server changes. Shared with the setters, so accessed under
+// ntp_status_lock.
+static bool ntp_denied = false;
+
+// Status polled by the UI every tick. Published through a seqlock so reads
+// never block and never see a torn 64-bit time_t; writers serialize on the
+// portMUX, which also keeps them from being preempted mid-update.
+typedef struct {
+    bool synced;
+    time_t last_sync_time;
+    uint32_t sync_start_ticks;
+    uint32_t sync_count;
+    uint32_t interval;
+    uint8_t stratum;
+    uint32_t server_ip;
+    bool from_dhcp;
+    uint32_t root_delay_us;
+    uint32_t root_dispersion_us;
+    char server[NTP_SERVER_NAME_LEN];   // Configured server name
+} ntp_status_t;
+
+static ntp_status_t ntp_status = {
+    .server = DEFAULT_NTP_SERVER,
+    .synced = false,
+    .last_sync_time = 0,
+    .sync_start_ticks = 0,
+    .sync_count = 0,
+    .interval = NTP_DEFAULT_INTERVAL_SEC,
+};
+static seqlock_t ntp_status_seq = SEQLOCK_INIT;
+static portMUX_TYPE ntp_status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t ntp_task_handle = NULL;
+
+// Measurement history ring (oldest entry overwritten first)
+static ntp_sample_t history[NTP_HISTORY_LEN];
+static uint32_t history_total = 0;
+static portMUX_TYPE history_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void status_write_begin(void) {
+    portENTER_CRITICAL(&ntp_status_lock);
+    seqlock_write_begin(&ntp_status_seq);
+}
+
+static void status_write_end(void) {
+    seqlock_write_end(&ntp_status_seq);
+    portEXIT_CRITICAL(&ntp_status_lock);
+}
+
+static void status_read(ntp_status_t *status) {
+    SEQLOCK_READ(&ntp_status_seq, status, &ntp_status);
+}
+
+static int64_t get_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void step_clock(int64_t offset_us) {
+    int64_t now_us = get_time_us() + offset_us;
+    struct timeval tv = {
+        .tv_sec = now_us / 1000000,
+        .tv_usec = now_us % 1000000,
+    };
+    settimeofday(&tv, NULL);
+}
+
+static void slew_clock(int64_t offset_us) {
+    struct timeval delta = {
+        .tv_sec = offset_us / 1000000,
+        .tv_usec = offset_us % 1000000,
+    };
+    adjtime(&delta, NULL);
+}
+
+static void sleep_ms(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+static void log_query(uint32_t ip, ntp_reply_t result, const ntp_packet_t *reply) {
+    esp_ip4_addr_t addr = { .addr = ip };
+    if (!reply) {
+        ESP_LOGW(TAG, "No usable reply from NTP server " IPSTR, IP2STR(&addr));
+    } else if (result != NTP_REPLY_OK) {
+        ESP_LOGW(TAG, "Rejected NTP reply from " IPSTR " (reason %d, stratum %d)",
+                 IP2STR(&addr), result, reply->stratum);
+    }
+}
+
+// Names go through the DNS cache, so a sync only waits on DNS the very first time
+static const ntp_client_t ntp_client = {
+    .now_us = get_time_us,
+    .step = step_clock,
+    .slew = slew_clock,
+    .sleep_ms = sleep_ms,
+    .resolve = dns_cache_resolve,
+    .on_query = log_query,
+    .timeout_ms = NTP_RESPONSE_TIMEOUT_MS,
+    .burst_samples = NTP_BURST_SAMPLES,
+    .burst_spacing_ms = NTP_BURST_SPACING_MS,
+    .step_threshold_us = NTP_STEP_THRESHOLD_MS * 1000,
+};
+
+static void record_sample(time_t when, int64_t offset_us, int64_t delay_us, uint32_t server_ip) {
+    ntp_sample_t sample = {
+        .time = when,
+        .offset_us = (int32_t)(offset_us > INT32_MAX ? INT32_MAX :
+                               offset_us < INT32_MIN ? INT32_MIN : offset_us),
+        .delay_us = (uint32_t)(delay_us > UINT32_MAX ? UINT32_MAX : delay_us),
+        .server_ip = server_ip,
+        .rssi = wifi_get_rssi(),
+    };
+
+    portENTER_CRITICAL(&history_lock);
+    history[history_total % NTP_HISTORY_LEN] = sample;
+    history_total++;
+    portEXIT_CRITICAL(&history_lock);
+}
+
+// NTP servers learned from DHCP option 42 (lwIP stores them in the SNTP
+// server table when DHCP server mode is enabled, see wifi_init)
+static int get_dhcp_servers(ntp_server_addr_t *servers, int max) {
+    int count = 0;
+    for (int i = 0; i < NTP_DHCP_MAX_SERVERS && count < max; i++) {
+        const ip_addr_t *ip = esp_sntp_getserver(i);
+        if (!ip || ip_addr_isany(ip) || !IP_IS_V4(ip)) continue;
+
+        servers[count] = (ntp_server_addr_t){
+            .ip = ip4_addr_get_u32(ip_2_ip4(ip)),
+            .port = NTP_PORT,
+        };
+        count++;
+    }
+    return count;
+}
+
+// Apply the measurement and publish it as the new sync state
+static void commit_sync(const ntp_measurement_t *best, bool synced, bool from_dhcp) {
+    // True UTC at this instant, before the correction is applied
+    int64_t utc_us = get_time_us() + best->offset_us;
+    ntp_client_apply(&ntp_client, best->offset_us, synced);
+
+    struct timeval tv = {
+        .tv_sec = utc_us / 1000000,
+        .tv_usec = utc_us % 1000000,
+    };
+    record_sample(tv.tv_sec, best->offset_us, best->delay_us, best->server_ip);
+
+    // Our distance from the reference clock, for serving time onward
+    uint32_t root_delay_us = ntp_short_to_us(best->reply.root_delay) + (uint32_t)best->delay_us;
+    uint32_t root_disp_us = ntp_short_to_us(best->reply.root_dispersion) + (uint32_t)best->delay_us / 2;
+
+    status_write_begin();
+    ntp_status.synced = true;
+    ntp_status.last_sync_time = tv.tv_sec;
+    ntp_status.stratum = best->reply.stratum;
+    ntp_status.server_ip = best->server_ip;
+    ntp_status.from_dhcp = from_dhcp;
+    ntp_status.root_delay_us = root_delay_us;
+    ntp_status.root_dispersion_us = root_disp_us;
+    uint32_t sync_count = ++ntp_status.sync_count;
+    status_write_end();
+    timekeep_on_sync(&tv);
+
+    ESP_LOGI(TAG, "NTP time synchronized (sync #%lu, offset %lld us, delay %lld us)",
+             (unsigned long)sync_count, (long long)best->offset_us, (long long)best->delay_us);
+}
+
+// Prefer LAN servers advertised by DHCP, falling back to the configured one
+static ntp_reply_t ntp_sync_once(void) {
+    ntp_server_addr_t servers[NTP_DHCP_MAX_SERVERS + 1];
+    int num_dhcp = get_dhcp_servers(servers, NTP_DHCP_MAX_SERVERS);
+    int count = num_dhcp;
+
+    // Snapshot the name with the flag so a DENY is pinned to the server
+    // that sent it, even if the setting changes during the exchange
+    char server[NTP_SERVER_NAME_LEN];
+    portENTER_CRITICAL(&ntp_status_lock);
+    bool denied = ntp_denied;
+    strcpy(server, ntp_status.server);
+    portEXIT_CRITICAL(&ntp_status_lock);
+
+    // Once the configured server refused us, only DHCP servers are tried
+    // until it changes
+    if (!denied) {
+        servers[count++] = (ntp_server_addr_t){ .name = server, .port = NTP_PORT };
+    }
+
+    ntp_status_t status;
+    status_read(&status);
+
+    ntp_measurement_t best;
+    int tried;
+    ntp_reply_t result = ntp_client_sync(&ntp_client, servers, count, status.synced, &best, &tried);
+
+    int dhcp_failed = result == NTP_REPLY_OK ? tried : num_dhcp;
+    for (int i = 0; i < dhcp_failed && i < num_dhcp; i++) {
+        esp_ip4_addr_t ip = { .addr = servers[i].ip };
+        ESP_LOGW(TAG, "DHCP NTP server " IPSTR " failed", IP2STR(&ip));
+    }
+
+    if (result == NTP_REPLY_OK) {
+        commit_sync(&best, status.synced, tried < num_dhcp);
+    }
+
+    if (denied) {
+        return result == NTP_REPLY_OK ? result : NTP_REPLY_KOD_DENY;
+    }
+    if (tried != num_dhcp) {
+        // Synced from DHCP, or the configured name did not resolve
+        return result;
+    }
+
+    if (result == NTP_REPLY_KOD_DENY) {
+        ESP_LOGE(TAG, "NTP server %s denied access, not polling it again", server);
+        portENTER_CRITICAL(&ntp_status_lock);
+        if (strcmp(ntp_status.server, server) == 0) {
+            ntp_denied = true;
+        }
+        portEXIT_CRITICAL(&ntp_status_lock);
+    } else if (result != NTP_REPLY_OK && result != NTP_REPLY_KOD_RATE) {
+        // The cached address may have moved: re-resolve before the retry
+        dns_cache_expire(server);
+    }
+
+    // Revalidate now that the clock is set, so the next sync skips DNS
+    dns_cache_refresh(server);
+    return result;
+}
+
+static void ntp_task(void *arg) {
+    ntp_backoff_t backoff;
+    ntp_backoff_init(&backoff, NTP_RETRY_MIN_SEC, NTP_RETRY_MAX_SEC);
+    TickType_t wait = 0;
+
+    while (1) {
+        // Woken early by force/restart requests
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        if (!wifi_is_connected()) {
+            wait = pdMS_TO_TICKS(NTP_RETRY_MIN_SEC * 1000);
+            continue;
+        }
+
+        // Radio fully awake for the exchange; log how long the sync took so
+        // the cost of the power profile's wakeup shows up in the log
+        int64_t start_us = esp_timer_get_time();
+        wifi_power_hold();
+        ntp_reply_t result = ntp_sync_once();
+        wifi_power_release();
+        app_event_post(APP_EVENT_SYNC);
+        ESP_LOGI(TAG, "Sync attempt took %lld ms (power profile %s)",
+                 (long long)(esp_timer_get_time() - start_us) / 1000,
+                 wifi_power_profile_name(wifi_get_power_profile()));
+
+        if (result == NTP_REPLY_KOD_RATE) {
+            ESP_LOGW(TAG, "NTP server asked to reduce rate");
+        }
+        // A DENY waits the full interval in case DHCP provides a server, or
+        // less if a new server is configured (which wakes the task)
+        wait = pdMS_TO_TICKS(ntp_backoff_next(&backoff, result, wifi_get_ntp_interval()) * 1000);
+    }
+}
+
+static void ntp_wake(void) {
+    if (ntp_task_handle) {
+        xTaskNotifyGive(ntp_task_handle);
+    }
+}
+
+void wifi_start_ntp(void) {
+    TickType_t now = xTaskGetTickCount();
+    status_write_begin();
+    ntp_status.sync_start_ticks = now;
+    status_write_end();
+
+    ntp_status_t status;
+    status_read(&status);
+    ESP_LOGI(TAG, "Starting NTP sync (server: %s, interval: %lu sec)",
+             status.server, (unsigned long)status.interval);
+
+    if (!ntp_task_handle) {
+        xTaskCreate(ntp_task, "ntp", NTP_TASK_STACK, NULL, NTP_TASK_PRIORITY, &ntp_task_handle);
+    } else {
+        ntp_wake();
+    }
+}
+
+bool wifi_time_is_synced(void) {
+    ntp_status_t status;
+    status_read(&status);
+    return status.synced;
+}
+
+void wifi_set_timezone(const char *tz) {
+    ESP_LOGI(TAG, "Setting timezone: %s", tz);
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+void wifi_get_ntp_stats(ntp_stats_t *stats) {
+    ntp_status_t status;
+    status_read(&status);
+
+    stats->synced = status.synced;
+    stats->last_sync_time = status.last_sync_time;
+    stats->sync_count = status.sync_count;
+    stats->sync_interval = status.interval;
+    stats->stratum = status.stratum;
+    stats->server_ip = status.server_ip;
+    stats->server_from_dhcp = status.from_dhcp;
+    stats->root_delay_us = status.root_delay_us;
+    stats->root_dispersion_us = status.root_dispersion_us;
+
+    // Calculate elapsed time since sync started
+    if (!status.synced && status.sync_start_ticks > 0) {
+        stats->sync_elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - status.sync_start_ticks);
+    } else {
+        stats->sync_elapsed_ms = 0;
+    }
+
+    strcpy(stats->server, ntp_task_handle ? status.server : "N/A");
+}
+
+int wifi_get_ntp_history(ntp_sample_t *samples, int max_samples, uint32_t *total) {
+    portENTER_CRITICAL(&history_lock);
+    int count = history_total < NTP_HISTORY_LEN ? (int)history_total : NTP_HISTORY_LEN;
+    if (count > max_samples) count = max_samples;
+
+    // Oldest first
+    uint32_t first = history_total - count;
+    for (int i = 0; i < count; i++) {
+        samples[i] = history[(first + i) % NTP_HISTORY_LEN];
+    }
+    if (total) *total = history_total;
+    portEXIT_CRITICAL(&history_lock);
+
+    return count;
+}
+
+void wifi_set_ntp_interval(uint32_t seconds) {
+    if (seconds < NTP_MIN_INTERVAL_SEC) seconds = NTP_MIN_INTERVAL_SEC;
+    status_write_begin();
+    ntp_status.interval = seconds;
+    status_write_end();
+
+    // Reschedule the running client
+    ntp_wake();
+}
+
+void wifi_ntp_sync_now(void) {
+    ntp_wake();
+}
+
+void wifi_force_ntp_sync(void) {
+    if (ntp_task_handle) {
+        TickType_t now = xTaskGetTickCount();
+        status_write_begin();
+        ntp_status.synced = false;  // Reset so UI shows "Syncing..." state
+        ntp_status.sync_start_ticks = now;
+        status_write_end();
+        ntp_wake();
+    }
+}
+
+void wifi_restart_ntp(void) {
+    // Query the (possibly new) server right away
+    portENTER_CRITICAL(&ntp_status_lock);
+    ntp_denied = false;
+    portEXIT_CRITICAL(&ntp_status_lock);
+    ntp_wake();
+}
+
+void wifi_get_custom_ntp_server(char *server, size_t len) {
+    ntp_status_t status;
+    status_read(&status);
+    strncpy(server, status.server, len - 1);
+    server[len - 1] = '\0';
+}
+
+void wifi_set_custom_ntp_server(const char *server) {
+    if (!server[0]) server = DEFAULT_NTP_SERVER;
+    status_write_begin();
+    strncpy(ntp_status.server, server, sizeof(ntp_status.server) - 1);
+    ntp_status.server[sizeof(ntp_status.server) - 1] = '\0';
+    ntp_denied = false;  // A DENY only applies to the server that sent it
+    status_write_end();
+}
+
+uint32_t wifi_get_ntp_interval(void) {
+    ntp_status_t status;
+    status_read(&status);
+    return status.interval;
+}
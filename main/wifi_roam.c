@@ -0,0 +1,240 @@
+#include "wifi_roam.h"
+#include "config.h"
+#include "wifi.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "wifi_roam";
+
+#define ROAM_TASK_STACK     3072
+#define ROAM_TASK_PRIORITY  3
+
+#define RSSI_UNKNOWN        -90     // Assumed for networks never connected to
+#define SUCCESS_BONUS_DB    2       // Per past success, capped below
+#define SUCCESS_BONUS_MAX   10
+#define FAILURE_PENALTY_DB  10      // Per failure since the last success
+
+static wifi_cred_t creds[WIFI_CRED_MAX];
+static int cred_count = 0;
+static uint32_t use_counter = 0;
+static portMUX_TYPE creds_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t roam_task_handle = NULL;
+
+// Caller holds creds_lock
+static wifi_cred_t *find_cred(const char *ssid) {
+    for (int i = 0; i < cred_count; i++) {
+        if (strcmp(creds[i].ssid, ssid) == 0) {
+            return &creds[i];
+        }
+    }
+    return NULL;
+}
+
+static void persist(void) {
+    wifi_cred_t copy[WIFI_CRED_MAX];
+    portENTER_CRITICAL(&creds_lock);
+    int count = cred_count;
+    memcpy(copy, creds, sizeof(copy));
+    portEXIT_CRITICAL(&creds_lock);
+
+    nvs_config_set_wifi_creds(copy, count);
+}
+
+void wifi_roam_init(void) {
+    wifi_cred_t loaded[WIFI_CRED_MAX];
+    int count = nvs_config_get_wifi_creds(loaded, WIFI_CRED_MAX);
+
+    portENTER_CRITICAL(&creds_lock);
+    memcpy(creds, loaded, sizeof(creds));
+    cred_count = count;
+    use_counter = 0;
+    for (int i = 0; i < count; i++) {
+        if (creds[i].last_used > use_counter) use_counter = creds[i].last_used;
+    }
+    portEXIT_CRITICAL(&creds_lock);
+}
+
+void wifi_roam_remember(const char *ssid, const char *password) {
+    int8_t rssi = wifi_get_rssi();
+
+    portENTER_CRITICAL(&creds_lock);
+    wifi_cred_t *cred = find_cred(ssid);
+    if (!cred) {
+        if (cred_count < WIFI_CRED_MAX) {
+            cred = &creds[cred_count++];
+        } else {
+            // Replace the least recently used network
+            cred = &creds[0];
+            for (int i = 1; i < cred_count; i++) {
+                if (creds[i].last_used < cred->last_used) cred = &creds[i];
+            }
+        }
+        memset(cred, 0, sizeof(*cred));
+        strncpy(cred->ssid, ssid, sizeof(cred->ssid) - 1);
+        cred->successes = 1;    // Only remembered after connecting
+    }
+    strncpy(cred->password, password, sizeof(cred->password) - 1);
+    cred->password[sizeof(cred->password) - 1] = '\0';
+    if (rssi != 0) cred->last_rssi = rssi;
+    cred->failures = 0;
+    cred->last_used = ++use_counter;
+    portEXIT_CRITICAL(&creds_lock);
+
+    persist();
+    ESP_LOGI(TAG, "Saved WiFi credentials for SSID: %s", ssid);
+}
+
+void wifi_roam_report(const char *ssid, bool connected, int8_t rssi) {
+    bool changed = false;
+
+    portENTER_CRITICAL(&creds_lock);
+    wifi_cred_t *cred = find_cred(ssid);
+    if (cred && connected) {
+        if (cred->successes < UINT8_MAX) cred->successes++;
+        if (rssi != 0) cred->last_rssi = rssi;
+        cred->failures = 0;
+        cred->last_used = ++use_counter;
+        changed = true;
+    } else if (cred && cred->failures < UINT8_MAX) {
+        cred->failures++;
+    }
+    portEXIT_CRITICAL(&creds_lock);
+
+    if (changed) {
+        persist();
+    }
+}
+
+static int score(const wifi_cred_t *cred, const wifi_network_t *seen, int seen_count) {
+    int rssi = cred->last_rssi ? cred->last_rssi : RSSI_UNKNOWN;
+    bool found = false;
+    for (int i = 0; i < seen_count; i++) {
+        if (strcmp(seen[i].ssid, cred->ssid) == 0) {
+            rssi = seen[i].rssi;
+            found = true;
+            break;
+        }
+    }
+    if (seen_count > 0 && !found) {
+        rssi -= WIFI_ROAM_UNSEEN_PENALTY_DB;
+    }
+
+    int successes = cred->successes < SUCCESS_BONUS_MAX ? cred->successes : SUCCESS_BONUS_MAX;
+    return rssi + successes * SUCCESS_BONUS_DB - cred->failures * FAILURE_PENALTY_DB;
+}
+
+int wifi_roam_candidates(wifi_cred_t *out, int max) {
+    wifi_network_t seen[MAX_SCAN_RESULTS];
+    int seen_count = wifi_scan_get_results(seen, MAX_SCAN_RESULTS, NULL);
+
+    wifi_cred_t table[WIFI_CRED_MAX];
+    portENTER_CRITICAL(&creds_lock);
+    int count = cred_count;
+    memcpy(table, creds, sizeof(table));
+    portEXIT_CRITICAL(&creds_lock);
+
+    // Insertion sort by score, best first (at most WIFI_CRED_MAX entries)
+    int scores[WIFI_CRED_MAX];
+    for (int i = 0; i < count; i++) {
+        wifi_cred_t cred = table[i];
+        int s = score(&cred, seen, seen_count);
+        int j = i;
+        while (j > 0 && scores[j - 1] < s) {
+            table[j] = table[j - 1];
+            scores[j] = scores[j - 1];
+            j--;
+        }
+        table[j] = cred;
+        scores[j] = s;
+    }
+
+    if (count > max) count = max;
+    memcpy(out, table, count * sizeof(wifi_cred_t));
+    return count;
+}
+
+bool wifi_roam_refresh_scan(void) {
+    if (!wifi_scan_start()) return true;
+    return wifi_scan_wait();
+}
+
+// Scan and move to a known AP that beats the current link by the hysteresis
+static void try_roam(int8_t link_rssi) {
+    wifi_ap_record_t current;
+    if (esp_wifi_sta_get_ap_info(&current) != ESP_OK) return;
+
+    ESP_LOGI(TAG, "Link weak (%d dBm), scanning for a better AP", link_rssi);
+    if (!wifi_roam_refresh_scan()) return;
+
+    wifi_network_t seen[MAX_SCAN_RESULTS];
+    int seen_count = wifi_scan_get_results(seen, MAX_SCAN_RESULTS, NULL);
+
+    const wifi_network_t *best = NULL;
+    wifi_cred_t best_cred;
+    int best_rssi = link_rssi + WIFI_ROAM_HYSTERESIS_DB;
+    for (int i = 0; i < seen_count; i++) {
+        if (memcmp(seen[i].bssid, current.bssid, sizeof(current.bssid)) == 0) continue;
+        if (seen[i].rssi < best_rssi) continue;
+
+        portENTER_CRITICAL(&creds_lock);
+        wifi_cred_t *cred = find_cred(seen[i].ssid);
+        if (cred) best_cred = *cred;
+        portEXIT_CRITICAL(&creds_lock);
+
+        if (cred) {
+            best = &seen[i];
+            best_rssi = seen[i].rssi;
+        }
+    }
+    if (!best) {
+        ESP_LOGI(TAG, "No better AP in range");
+        return;
+    }
+
+    ESP_LOGI(TAG, "Roaming to %s on channel %d (%d dBm)", best->ssid, best->channel, best->rssi);
+
+    // Point the directed connect at the new AP
+    wifi_ap_cache_t cache = {0};
+    strncpy(cache.ssid, best->ssid, sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, best->bssid, sizeof(cache.bssid));
+    cache.channel = best->channel;
+    nvs_config_set_wifi_ap_cache(&cache);
+
+    wifi_switch_network(best_cred.ssid, best_cred.password);
+}
+
+static void roam_task(void *arg) {
+    int weak_checks = 0;
+    bool scanned = false;
+    TickType_t last_scan = 0;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(WIFI_ROAM_CHECK_MS));
+
+        int8_t rssi = wifi_get_rssi();
+        if (!wifi_is_connected() || rssi == 0 || rssi >= WIFI_ROAM_RSSI_DBM) {
+            weak_checks = 0;
+            continue;
+        }
+
+        // Low duty: only after a sustained weak link, and rate limited
+        if (++weak_checks < WIFI_ROAM_WEAK_CHECKS) continue;
+        if (scanned && xTaskGetTickCount() - last_scan < pdMS_TO_TICKS(WIFI_ROAM_SCAN_INTERVAL_SEC * 1000)) {
+            continue;
+        }
+        scanned = true;
+        last_scan = xTaskGetTickCount();
+        weak_checks = 0;
+        try_roam(rssi);
+    }
+}
+
+void wifi_roam_start(void) {
+    if (!roam_task_handle) {
+        xTaskCreate(roam_task, "wifi_roam", ROAM_TASK_STACK, NULL, ROAM_TASK_PRIORITY, &roam_task_handle);
+    }
+}
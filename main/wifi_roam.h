@@ -0,0 +1,33 @@
+#ifndef WIFI_ROAM_H
+#define WIFI_ROAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nvs_config.h"
+
+// Known networks and roaming between them. Up to WIFI_CRED_MAX networks are
+// kept in NVS with the signal they were last connected at and their connect
+// history; candidates are ranked from that plus the latest scan results.
+
+// Load the credential table (call after nvs_config_init)
+void wifi_roam_init(void);
+
+// Add or update a network after connecting to it, and persist it
+void wifi_roam_remember(const char *ssid, const char *password);
+
+// Known networks, best candidate first. Returns number copied.
+int wifi_roam_candidates(wifi_cred_t *creds, int max);
+
+// Record the outcome of a connect to ssid (rssi: link signal when connected).
+// Failures are only persisted with the next success to spare the flash.
+void wifi_roam_report(const char *ssid, bool connected, int8_t rssi);
+
+// Run a scan to completion so candidates are ranked on fresh signal levels.
+// Returns false if WiFi supervision was withdrawn while scanning.
+bool wifi_roam_refresh_scan(void);
+
+// Start the monitor that scans when the link stays weak and switches to a
+// clearly stronger known AP
+void wifi_roam_start(void);
+
+#endif // WIFI_ROAM_H
@@ -0,0 +1,139 @@
+#define _DEFAULT_SOURCE
+#include "fake_sntp.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+struct fake_sntp {
+    int sock;
+    uint16_t port;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    fake_sntp_config_t config;
+    unsigned requests;
+    unsigned seed;
+    volatile bool running;
+};
+
+static int64_t get_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void path_delay(const fake_sntp_config_t *config, unsigned *seed) {
+    uint32_t us = config->path_delay_us;
+    if (config->jitter_us) us += rand_r(seed) % (config->jitter_us + 1);
+    if (us) usleep(us);
+}
+
+static void *serve(void *arg) {
+    fake_sntp_t *server = arg;
+    uint8_t buf[NTP_PACKET_SIZE];
+
+    while (server->running) {
+        struct sockaddr_in client;
+        socklen_t client_len = sizeof(client);
+        ssize_t len = recvfrom(server->sock, buf, sizeof(buf), 0, (struct sockaddr *)&client, &client_len);
+        ntp_packet_t request;
+        if (len < 0 || !ntp_packet_decode(buf, (size_t)len, &request)) continue;
+
+        pthread_mutex_lock(&server->lock);
+        fake_sntp_config_t config = server->config;
+        unsigned count = ++server->requests;
+        pthread_mutex_unlock(&server->lock);
+
+        if (config.drop_every && count % config.drop_every == 0) continue;
+
+        path_delay(&config, &server->seed);
+        int64_t recv_us = get_time_us() + config.offset_us;
+        ntp_packet_t reply;
+        if (config.as_clock) {
+            if (!ntp_make_reply(&request, recv_us, &config.reference, &reply)) continue;
+        } else {
+            reply = (ntp_packet_t){
+                .leap = config.leap,
+                .version = request.version,
+                .mode = NTP_MODE_SERVER,
+                .stratum = config.stratum,
+                .poll = request.poll,
+                .precision = -20,
+                .ref_id = config.stratum == NTP_STRATUM_KOD ? config.kiss_code : 0x7F000001,
+                .ref_ts = ntp_ts_from_unix_us(recv_us),
+                .orig_ts = request.xmit_ts,
+                .recv_ts = ntp_ts_from_unix_us(recv_us),
+            };
+            if (config.bad_origin) reply.orig_ts.frac ^= 1;
+        }
+        reply.xmit_ts = ntp_ts_from_unix_us(get_time_us() + config.offset_us);
+        path_delay(&config, &server->seed);
+
+        ntp_packet_encode(&reply, buf);
+        sendto(server->sock, buf, sizeof(buf), 0, (struct sockaddr *)&client, client_len);
+    }
+    return NULL;
+}
+
+fake_sntp_t *fake_sntp_start(const fake_sntp_config_t *config) {
+    fake_sntp_t *server = calloc(1, sizeof(*server));
+    if (!server) return NULL;
+
+    server->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addr_len = sizeof(addr);
+    if (server->sock < 0 ||
+        bind(server->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(server->sock, (struct sockaddr *)&addr, &addr_len) < 0) {
+        if (server->sock >= 0) close(server->sock);
+        free(server);
+        return NULL;
+    }
+
+    // Periodic timeout so a stop is noticed
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = 50000 };
+    setsockopt(server->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    server->port = ntohs(addr.sin_port);
+    server->config = *config;
+    server->seed = 1;   // Same jitter sequence on every run
+    server->running = true;
+    pthread_mutex_init(&server->lock, NULL);
+    if (pthread_create(&server->thread, NULL, serve, server) != 0) {
+        close(server->sock);
+        free(server);
+        return NULL;
+    }
+    return server;
+}
+
+void fake_sntp_configure(fake_sntp_t *server, const fake_sntp_config_t *config) {
+    pthread_mutex_lock(&server->lock);
+    server->config = *config;
+    pthread_mutex_unlock(&server->lock);
+}
+
+uint16_t fake_sntp_port(const fake_sntp_t *server) {
+    return server->port;
+}
+
+unsigned fake_sntp_requests(fake_sntp_t *server) {
+    pthread_mutex_lock(&server->lock);
+    unsigned count = server->requests;
+    pthread_mutex_unlock(&server->lock);
+    return count;
+}
+
+void fake_sntp_stop(fake_sntp_t *server) {
+    server->running = false;
+    pthread_join(server->thread, NULL);
+    close(server->sock);
+    pthread_mutex_destroy(&server->lock);
+    free(server);
+}
@@ -0,0 +1,42 @@
+#ifndef FAKE_SNTP_H
+#define FAKE_SNTP_H
+
+// Loopback SNTP server for host tests. Answers on 127.0.0.1 from a thread,
+// with a configurable clock offset, path delay and jitter, and can send
+// kiss codes, unsynchronized replies, bad origins or drop requests. With
+// as_clock set it builds replies with ntp_make_reply(), like the clock's own
+// SNTP server (ntp_server.c).
+
+#include "ntp_proto.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    int64_t offset_us;          // Server clock minus host clock
+    uint32_t path_delay_us;     // One-way delay added in each direction
+    uint32_t jitter_us;         // Extra random delay per direction, 0..jitter_us
+    uint8_t stratum;            // 0 sends a Kiss-o'-Death with kiss_code
+    uint8_t leap;
+    uint32_t kiss_code;         // Reference ID of a KoD reply, e.g. "RATE"
+    bool bad_origin;            // Do not echo the client's transmit timestamp
+    unsigned drop_every;        // Drop every Nth request, 0 to answer all
+    bool as_clock;              // Answer from reference; the header fields above are ignored
+    ntp_reference_t reference;
+} fake_sntp_config_t;
+
+typedef struct fake_sntp fake_sntp_t;
+
+// Start serving on an ephemeral port; NULL on failure
+fake_sntp_t *fake_sntp_start(const fake_sntp_config_t *config);
+
+// Change the behavior for the following requests
+void fake_sntp_configure(fake_sntp_t *server, const fake_sntp_config_t *config);
+
+uint16_t fake_sntp_port(const fake_sntp_t *server);
+
+// Requests received, including dropped ones
+unsigned fake_sntp_requests(fake_sntp_t *server);
+
+void fake_sntp_stop(fake_sntp_t *server);
+
+#endif // FAKE_SNTP_H
@@ -0,0 +1,41 @@
+#ifndef TEST_H
+#define TEST_H
+
+// Minimal assertion helpers for the host tests. A failed check prints its
+// location and the run continues; TEST_RESULT() is the exit status.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+    if (!(cond)) {                                                          \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+#define CHECK_EQ(a, b) do {                                                 \
+    long long check_a_ = (long long)(a), check_b_ = (long long)(b);         \
+    if (check_a_ != check_b_) {                                             \
+        fprintf(stderr, "%s:%d: %s == %s failed (%lld != %lld)\n",          \
+                __FILE__, __LINE__, #a, #b, check_a_, check_b_);            \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+// |a - b| <= tolerance
+#define CHECK_NEAR(a, b, tolerance) do {                                    \
+    long long check_d_ = (long long)(a) - (long long)(b);                   \
+    if (check_d_ < 0) check_d_ = -check_d_;                                 \
+    if (check_d_ > (long long)(tolerance)) {                                \
+        fprintf(stderr, "%s:%d: %s ~ %s failed (off by %lld)\n",            \
+                __FILE__, __LINE__, #a, #b, check_d_);                      \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+#define TEST_RESULT() (test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif // TEST_H
@@ -0,0 +1,206 @@
+#define _DEFAULT_SOURCE
+#include "http_date.h"
+#include "test.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int64_t get_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Only numeric addresses on the host
+static bool resolve(const char *host, uint32_t *ip) {
+    struct in_addr addr;
+    if (inet_aton(host, &addr) == 0) return false;
+    *ip = addr.s_addr;
+    return true;
+}
+
+static const http_date_hooks_t hooks = {
+    .resolve = resolve,
+    .now_us = monotonic_us,
+    .timeout_ms = 1000,
+};
+
+static void test_parse(void) {
+    time_t t;
+    CHECK(http_date_parse("Wed, 01 Jan 2025 00:00:00 GMT", &t));
+    CHECK_EQ(t, 1735689600);
+    CHECK(http_date_parse("Tue, 29 Feb 2028 12:34:56 GMT", &t));
+    CHECK_EQ(t, 1835440496);
+    CHECK(http_date_parse("Thu, 31 Dec 2099 23:59:59 GMT\r\nServer: x", &t));
+    CHECK_EQ(t, 4102444799LL);
+
+    // Leap second is passed through as the next second
+    CHECK(http_date_parse("Thu, 31 Dec 2099 23:59:60 GMT", &t));
+    CHECK_EQ(t, 4102444800LL);
+
+    CHECK(!http_date_parse("Sun, 06 Nov 1994 08:49:37 GMT", &t));  // Before 2025
+    CHECK(!http_date_parse("Wed, 01 Foo 2025 00:00:00 GMT", &t));
+    CHECK(!http_date_parse("Wed, 01 anF 2025 00:00:00 GMT", &t));  // Straddles two months
+    CHECK(!http_date_parse("Wed, 00 Jan 2025 00:00:00 GMT", &t));
+    CHECK(!http_date_parse("Wed, 01 Jan 2025 24:00:00 GMT", &t));
+    CHECK(!http_date_parse("Wed, 01 Jan 2025 00:60:00 GMT", &t));
+    CHECK(!http_date_parse("Wednesday, 01-Jan-25 00:00:00 GMT", &t));
+    CHECK(!http_date_parse("", &t));
+}
+
+static void test_find_header(void) {
+    const char *response =
+        "HTTP/1.1 200 OK\r\n"
+        "X-Date: wrong\r\n"
+        "Dates: wrong\r\n"
+        "date:   Wed, 01 Jan 2025 00:00:00 GMT\r\n"
+        "Server: test\r\n"
+        "\r\n";
+    const char *value = http_find_header(response, "Date");
+    CHECK(value != NULL);
+    if (value) CHECK(strncmp(value, "Wed, 01 Jan 2025", 16) == 0);
+
+    CHECK(http_find_header(response, "Content-Length") == NULL);
+    // The status line is not a header
+    CHECK(http_find_header("Date: x\r\n\r\n", "Date") == NULL);
+}
+
+static void test_estimate(void) {
+    const char *response = "HTTP/1.1 200 OK\r\nDate: Wed, 01 Jan 2025 00:00:00 GMT\r\n\r\n";
+    int64_t utc_us;
+    uint32_t err_ms;
+
+    // 200 ms round trip: half of it, plus the midpoint of the Date second
+    CHECK(http_date_estimate(response, 1000000, 1200000, &utc_us, &err_ms));
+    CHECK_EQ(utc_us, 1735689600LL * 1000000 + 500000 + 100000);
+    CHECK_EQ(err_ms, 600);
+
+    CHECK(!http_date_estimate("HTTP/1.1 200 OK\r\nServer: x\r\n\r\n", 0, 1000, &utc_us, &err_ms));
+}
+
+// Local HTTP stand-in: answers one HEAD request after a delay, with a Date
+// header from the host clock plus an offset (or none)
+typedef struct {
+    int sock;
+    int64_t offset_s;
+    uint32_t delay_us;
+    bool send_date;
+} stand_in_t;
+
+static void *stand_in_serve(void *arg) {
+    stand_in_t *stand_in = arg;
+    int conn = accept(stand_in->sock, NULL, NULL);
+    if (conn < 0) return NULL;
+
+    char buf[512];
+    ssize_t len = recv(conn, buf, sizeof(buf) - 1, 0);
+    if (len > 0) {
+        if (stand_in->delay_us) usleep(stand_in->delay_us);
+
+        time_t now = time(NULL) + stand_in->offset_s;
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        char date[64] = "";
+        if (stand_in->send_date) {
+            strftime(date, sizeof(date), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        }
+        int n = snprintf(buf, sizeof(buf), "HTTP/1.1 200 OK\r\nServer: stand-in\r\n%s\r\n", date);
+        send(conn, buf, n, 0);
+    }
+    close(conn);
+    return NULL;
+}
+
+// Serve one request from a stand-in configured like config and fetch the
+// Date from it with http_date_fetch(). Returns the estimated UTC offset from
+// the host clock in *offset_us.
+static http_date_result_t fetch(const stand_in_t *config, int64_t *offset_us, uint32_t *err_ms) {
+    stand_in_t stand_in = *config;
+    stand_in.sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addr_len = sizeof(addr);
+    if (stand_in.sock < 0 ||
+        bind(stand_in.sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(stand_in.sock, (struct sockaddr *)&addr, &addr_len) < 0 ||
+        listen(stand_in.sock, 1) < 0) {
+        fprintf(stderr, "Cannot start the HTTP stand-in\n");
+        return HTTP_DATE_NO_SOCKET;
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, stand_in_serve, &stand_in);
+
+    char host_port[32];
+    snprintf(host_port, sizeof(host_port), "127.0.0.1:%u", ntohs(addr.sin_port));
+    int64_t utc_us, local_us;
+    http_date_result_t result = http_date_fetch(host_port, &hooks, &utc_us, &local_us, err_ms);
+    if (result == HTTP_DATE_OK) {
+        // Carry the estimate forward on the monotonic clock, as the firmware does
+        *offset_us = utc_us + (monotonic_us() - local_us) - get_time_us();
+    }
+
+    pthread_join(thread, NULL);
+    close(stand_in.sock);
+    return result;
+}
+
+static void test_stand_in(void) {
+    int64_t offset_us;
+    uint32_t err_ms;
+
+    // The estimate must bracket the true time within its own error bound
+    stand_in_t config = { .delay_us = 50000, .send_date = true };
+    CHECK_EQ(fetch(&config, &offset_us, &err_ms), HTTP_DATE_OK);
+    CHECK(err_ms >= 525);     // Half the stand-in's delay at least
+    CHECK_NEAR(offset_us, 0, (int64_t)err_ms * 1000);
+
+    config.offset_s = 3600;
+    CHECK_EQ(fetch(&config, &offset_us, &err_ms), HTTP_DATE_OK);
+    CHECK_NEAR(offset_us, 3600LL * 1000000, (int64_t)err_ms * 1000);
+
+    config = (stand_in_t){ .send_date = false };
+    CHECK_EQ(fetch(&config, &offset_us, &err_ms), HTTP_DATE_NO_DATE);
+}
+
+static void test_fetch_errors(void) {
+    int64_t utc_us, local_us;
+    uint32_t err_ms;
+    CHECK_EQ(http_date_fetch("127.0.0.1:0", &hooks, &utc_us, &local_us, &err_ms), HTTP_DATE_BAD_HOST);
+    CHECK_EQ(http_date_fetch("127.0.0.1:70000", &hooks, &utc_us, &local_us, &err_ms), HTTP_DATE_BAD_HOST);
+    CHECK_EQ(http_date_fetch("no.such.host", &hooks, &utc_us, &local_us, &err_ms), HTTP_DATE_NO_ADDRESS);
+
+    // A port nobody listens on: bind one, then give it up
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addr_len = sizeof(addr);
+    bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+    getsockname(sock, (struct sockaddr *)&addr, &addr_len);
+    close(sock);
+    char host_port[32];
+    snprintf(host_port, sizeof(host_port), "127.0.0.1:%u", ntohs(addr.sin_port));
+    CHECK_EQ(http_date_fetch(host_port, &hooks, &utc_us, &local_us, &err_ms), HTTP_DATE_NO_CONNECT);
+}
+
+int main(void) {
+    test_parse();
+    test_find_header();
+    test_estimate();
+    test_stand_in();
+    test_fetch_errors();
+    return TEST_RESULT();
+}
@@ -0,0 +1,324 @@
+#define _DEFAULT_SOURCE
+#include "fake_sntp.h"
+#include "ntp_client.h"
+#include "test.h"
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define KISS(s) (((uint32_t)(s)[0] << 24) | ((uint32_t)(s)[1] << 16) | ((uint32_t)(s)[2] << 8) | (s)[3])
+
+// A delay asymmetry can shift the offset by at most half the round trip;
+// scheduling on a loaded host stretches either leg
+#define OFFSET_SLACK_US 1000
+
+#define CONFIGURED_NAME "ntp.example"
+
+// The disciplined clock: host time plus whatever the client corrected
+static int64_t clock_offset_us = 0;
+static int steps = 0, slews = 0;
+static int64_t last_slew_us = 0;
+
+static int64_t clock_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec + clock_offset_us;
+}
+
+static void clock_step(int64_t offset_us) {
+    clock_offset_us += offset_us;
+    steps++;
+}
+
+// Pretend the slew already completed, so the next query sees its effect
+static void clock_slew(int64_t offset_us) {
+    clock_offset_us += offset_us;
+    last_slew_us = offset_us;
+    slews++;
+}
+
+static void clock_reset(void) {
+    clock_offset_us = 0;
+    steps = slews = 0;
+    last_slew_us = 0;
+}
+
+static void sleep_ms(uint32_t ms) {
+    usleep(ms * 1000);
+}
+
+static bool resolve(const char *name, uint32_t *ip) {
+    if (strcmp(name, CONFIGURED_NAME) != 0) return false;
+    *ip = htonl(INADDR_LOOPBACK);
+    return true;
+}
+
+static const ntp_client_t client = {
+    .now_us = clock_now_us,
+    .step = clock_step,
+    .slew = clock_slew,
+    .sleep_ms = sleep_ms,
+    .resolve = resolve,
+    .timeout_ms = 500,
+    .burst_samples = 8,
+    .burst_spacing_ms = 0,
+    .step_threshold_us = 128000,
+};
+
+static ntp_reply_t query(fake_sntp_t *server, ntp_measurement_t *m) {
+    return ntp_client_query(&client, htonl(INADDR_LOOPBACK), fake_sntp_port(server), m);
+}
+
+static void test_offsets(fake_sntp_t *server) {
+    const int64_t offsets[] = { 1500000, -3000000, 0, 86400LL * 1000000 };
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        fake_sntp_config_t config = {
+            .offset_us = offsets[i],
+            .path_delay_us = 5000,
+            .stratum = 2,
+        };
+        fake_sntp_configure(server, &config);
+
+        ntp_measurement_t m;
+        CHECK_EQ(query(server, &m), NTP_REPLY_OK);
+        // Both path delays count, the server's hold between them does not
+        CHECK(m.delay_us >= 10000);
+        CHECK_NEAR(m.offset_us, offsets[i], m.delay_us / 2 + OFFSET_SLACK_US);
+        CHECK_EQ(m.server_ip, htonl(INADDR_LOOPBACK));
+        CHECK_EQ(m.reply.stratum, 2);
+    }
+}
+
+// Once synced, the client keeps the lowest-delay sample of a burst; with
+// jitter that sample's offset is the closest to the truth
+static void test_burst_selection(fake_sntp_t *server) {
+    fake_sntp_config_t config = {
+        .offset_us = 250000,
+        .path_delay_us = 1000,
+        .jitter_us = 20000,
+        .stratum = 1,
+    };
+    fake_sntp_configure(server, &config);
+    uint16_t port = fake_sntp_port(server);
+
+    unsigned before = fake_sntp_requests(server);
+    ntp_measurement_t best;
+    CHECK_EQ(ntp_client_sample(&client, htonl(INADDR_LOOPBACK), port, true, &best), NTP_REPLY_OK);
+    CHECK_EQ(fake_sntp_requests(server) - before, client.burst_samples);
+    CHECK(best.delay_us >= 2000);
+    CHECK_NEAR(best.offset_us, config.offset_us, best.delay_us / 2 + OFFSET_SLACK_US);
+
+    // Until the first sync a single exchange is enough
+    before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sample(&client, htonl(INADDR_LOOPBACK), port, false, &best), NTP_REPLY_OK);
+    CHECK_EQ(fake_sntp_requests(server) - before, 1);
+
+    // Lost samples do not spoil the burst
+    config.drop_every = 2;
+    fake_sntp_configure(server, &config);
+    before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sample(&client, htonl(INADDR_LOOPBACK), port, true, &best), NTP_REPLY_OK);
+    CHECK_EQ(fake_sntp_requests(server) - before, client.burst_samples);
+    CHECK_NEAR(best.offset_us, config.offset_us, best.delay_us / 2 + OFFSET_SLACK_US);
+}
+
+static void test_rejections(fake_sntp_t *server) {
+    ntp_measurement_t m;
+
+    fake_sntp_config_t config = { .stratum = NTP_STRATUM_KOD, .kiss_code = KISS("RATE") };
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_KOD_RATE);
+
+    config.kiss_code = KISS("DENY");
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_KOD_DENY);
+
+    config.kiss_code = KISS("RSTR");
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_KOD_DENY);
+
+    // A kiss code that does not echo our timestamp is not honored
+    config.bad_origin = true;
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_INVALID);
+
+    config = (fake_sntp_config_t){ .stratum = 16 };
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_UNSYNCED);
+
+    config = (fake_sntp_config_t){ .stratum = 2, .leap = NTP_LI_ALARM };
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_UNSYNCED);
+}
+
+// A kiss code ends the burst at once instead of hammering the server
+static void test_kod_ends_burst(fake_sntp_t *server) {
+    uint16_t port = fake_sntp_port(server);
+    ntp_measurement_t best;
+
+    fake_sntp_config_t config = { .stratum = NTP_STRATUM_KOD, .kiss_code = KISS("RATE") };
+    fake_sntp_configure(server, &config);
+    unsigned before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sample(&client, htonl(INADDR_LOOPBACK), port, true, &best), NTP_REPLY_KOD_RATE);
+    CHECK_EQ(fake_sntp_requests(server) - before, 1);
+
+    config.kiss_code = KISS("DENY");
+    fake_sntp_configure(server, &config);
+    before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sample(&client, htonl(INADDR_LOOPBACK), port, true, &best), NTP_REPLY_KOD_DENY);
+    CHECK_EQ(fake_sntp_requests(server) - before, 1);
+
+    // Other rejections just cost a sample
+    config = (fake_sntp_config_t){ .stratum = 16 };
+    fake_sntp_configure(server, &config);
+    before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sample(&client, htonl(INADDR_LOOPBACK), port, true, &best), NTP_REPLY_INVALID);
+    CHECK_EQ(fake_sntp_requests(server) - before, client.burst_samples);
+}
+
+static void test_loss(fake_sntp_t *server) {
+    ntp_measurement_t m;
+
+    fake_sntp_config_t config = { .stratum = 2, .drop_every = 2 };
+    fake_sntp_configure(server, &config);
+
+    // Every other request times out; the server saw all of them
+    unsigned before = fake_sntp_requests(server);
+    int answered = 0;
+    for (int i = 0; i < 4; i++) {
+        if (query(server, &m) == NTP_REPLY_OK) answered++;
+    }
+    CHECK_EQ(answered, 2);
+    CHECK_EQ(fake_sntp_requests(server) - before, 4);
+}
+
+// DHCP servers come first; the configured name is resolved only when they fail
+static void test_fallback(fake_sntp_t *server) {
+    fake_sntp_config_t config = { .offset_us = 40000, .stratum = 2 };
+    fake_sntp_configure(server, &config);
+
+    fake_sntp_config_t silent = { .stratum = 1, .drop_every = 1 };
+    fake_sntp_t *dhcp = fake_sntp_start(&silent);
+    CHECK(dhcp != NULL);
+    if (!dhcp) return;
+
+    ntp_server_addr_t servers[] = {
+        { .ip = htonl(INADDR_LOOPBACK), .port = fake_sntp_port(dhcp) },
+        { .name = CONFIGURED_NAME, .port = fake_sntp_port(server) },
+    };
+    ntp_measurement_t best;
+    int tried;
+
+    unsigned before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sync(&client, servers, 2, false, &best, &tried), NTP_REPLY_OK);
+    CHECK_EQ(tried, 1);
+    CHECK_EQ(fake_sntp_requests(dhcp), 1);
+    CHECK_EQ(fake_sntp_requests(server) - before, 1);
+    CHECK_NEAR(best.offset_us, config.offset_us, best.delay_us / 2 + OFFSET_SLACK_US);
+
+    // An answering DHCP server is used and the configured one left alone
+    fake_sntp_configure(dhcp, &config);
+    before = fake_sntp_requests(server);
+    CHECK_EQ(ntp_client_sync(&client, servers, 2, false, &best, &tried), NTP_REPLY_OK);
+    CHECK_EQ(tried, 0);
+    CHECK_EQ(fake_sntp_requests(server) - before, 0);
+
+    // A name that does not resolve is not queried, and counts as a failure
+    fake_sntp_configure(dhcp, &silent);
+    servers[1].name = "unknown.example";
+    CHECK_EQ(ntp_client_sync(&client, servers, 2, false, &best, &tried), NTP_REPLY_INVALID);
+    CHECK_EQ(tried, 0);
+    CHECK_EQ(ntp_client_sync(&client, &servers[1], 1, false, &best, &tried), NTP_REPLY_INVALID);
+    CHECK_EQ(tried, -1);
+
+    fake_sntp_stop(dhcp);
+}
+
+// The first sync and large errors step the clock; small ones slew it
+static void test_apply(fake_sntp_t *server) {
+    fake_sntp_config_t config = { .offset_us = 5000000, .stratum = 2 };
+    fake_sntp_configure(server, &config);
+    clock_reset();
+
+    ntp_measurement_t m;
+    CHECK_EQ(query(server, &m), NTP_REPLY_OK);
+    CHECK(ntp_client_apply(&client, m.offset_us, false));
+    CHECK_EQ(steps, 1);
+    CHECK_EQ(query(server, &m), NTP_REPLY_OK);
+    CHECK_NEAR(m.offset_us, 0, m.delay_us / 2 + OFFSET_SLACK_US);
+
+    // Below the threshold a synced clock is slewed
+    config.offset_us += 50000;
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_OK);
+    CHECK(!ntp_client_apply(&client, m.offset_us, true));
+    CHECK_EQ(slews, 1);
+    CHECK_NEAR(last_slew_us, 50000, m.delay_us / 2 + OFFSET_SLACK_US);
+    CHECK_EQ(steps, 1);
+
+    // Even small errors step until the first sync
+    CHECK(ntp_client_apply(&client, 1000, false));
+    CHECK_EQ(steps, 2);
+
+    // At the threshold a synced clock steps
+    config.offset_us -= 1000000;
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(query(server, &m), NTP_REPLY_OK);
+    CHECK(ntp_client_apply(&client, m.offset_us, true));
+    CHECK_EQ(steps, 3);
+    CHECK_EQ(slews, 1);
+    CHECK_EQ(query(server, &m), NTP_REPLY_OK);
+    CHECK_NEAR(m.offset_us, 0, m.delay_us / 2 + OFFSET_SLACK_US);
+
+    clock_reset();
+}
+
+static void test_backoff(void) {
+    ntp_backoff_t backoff;
+    ntp_backoff_init(&backoff, 2, 300);
+
+    // Failures double the wait up to the cap
+    const uint32_t expected[] = { 2, 4, 8, 16, 32, 64, 128, 256, 300, 300 };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_INVALID, 3600), expected[i]);
+    }
+
+    // A success polls at the interval and restarts the backoff
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_OK, 3600), 3600);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_UNSYNCED, 3600), 2);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_INVALID, 3600), 4);
+
+    // RATE goes straight to the cap; DENY waits the interval and keeps the backoff
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_KOD_RATE, 3600), 300);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_KOD_DENY, 3600), 3600);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_INVALID, 3600), 300);
+
+    // Never longer than the interval
+    ntp_backoff_init(&backoff, 2, 300);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_INVALID, 5), 2);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_INVALID, 5), 4);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_INVALID, 5), 5);
+    CHECK_EQ(ntp_backoff_next(&backoff, NTP_REPLY_KOD_RATE, 5), 5);
+}
+
+int main(void) {
+    fake_sntp_config_t config = { .stratum = 2 };
+    fake_sntp_t *server = fake_sntp_start(&config);
+    if (!server) {
+        fprintf(stderr, "Cannot start the loopback SNTP server\n");
+        return EXIT_FAILURE;
+    }
+
+    test_offsets(server);
+    test_burst_selection(server);
+    test_rejections(server);
+    test_kod_ends_burst(server);
+    test_loss(server);
+    test_fallback(server);
+    test_apply(server);
+    test_backoff();
+
+    fake_sntp_stop(server);
+    return TEST_RESULT();
+}
@@ -0,0 +1,197 @@
+#include "ntp_proto.h"
+#include "test.h"
+
+// First second of NTP era 1 (2036-02-07 06:28:16 UTC)
+#define ERA1_UNIX_SEC       2085978496LL
+#define US                  1000000LL
+
+#define KISS(s) (((uint32_t)(s)[0] << 24) | ((uint32_t)(s)[1] << 16) | ((uint32_t)(s)[2] << 8) | (s)[3])
+
+static ntp_packet_t make_request(void) {
+    ntp_packet_t request = {
+        .version = NTP_VERSION,
+        .mode = NTP_MODE_CLIENT,
+        .xmit_ts = { 0xE9A1B2C3, 0x12345678 },
+    };
+    return request;
+}
+
+// A good reply to request
+static ntp_packet_t make_reply(const ntp_packet_t *request) {
+    ntp_packet_t reply = {
+        .version = NTP_VERSION,
+        .mode = NTP_MODE_SERVER,
+        .stratum = 2,
+        .orig_ts = request->xmit_ts,
+        .recv_ts = { 0xE9A1B2C4, 0 },
+        .xmit_ts = { 0xE9A1B2C4, 0x100 },
+    };
+    return reply;
+}
+
+static void test_check_reply(void) {
+    ntp_packet_t request = make_request();
+    ntp_packet_t reply = make_reply(&request);
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_OK);
+
+    // Origin must echo our transmit timestamp
+    reply.orig_ts.frac ^= 1;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_INVALID);
+
+    reply = make_reply(&request);
+    reply.mode = NTP_MODE_CLIENT;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_INVALID);
+
+    reply = make_reply(&request);
+    reply.version = 0;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_INVALID);
+
+    reply = make_reply(&request);
+    reply.xmit_ts = (ntp_ts_t){ 0, 0 };
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_INVALID);
+
+    // Unsynchronized servers
+    reply = make_reply(&request);
+    reply.leap = NTP_LI_ALARM;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_UNSYNCED);
+
+    reply = make_reply(&request);
+    reply.stratum = 16;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_UNSYNCED);
+
+    reply.stratum = NTP_STRATUM_MAX;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_OK);
+}
+
+static void test_kiss_codes(void) {
+    ntp_packet_t request = make_request();
+    ntp_packet_t reply = make_reply(&request);
+    reply.stratum = NTP_STRATUM_KOD;
+
+    reply.ref_id = KISS("RATE");
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_KOD_RATE);
+    reply.ref_id = KISS("DENY");
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_KOD_DENY);
+    reply.ref_id = KISS("RSTR");
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_KOD_DENY);
+    reply.ref_id = KISS("INIT");
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_KOD_OTHER);
+
+    // Stratum 0 without a kiss code is still a KoD, never a usable time
+    reply.ref_id = 0;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_KOD_OTHER);
+
+    // A spoofed DENY that does not echo our timestamp is ignored
+    reply.ref_id = KISS("DENY");
+    reply.orig_ts.sec++;
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_INVALID);
+}
+
+static void test_packet_round_trip(void) {
+    ntp_packet_t pkt = {
+        .leap = 1,
+        .version = NTP_VERSION,
+        .mode = NTP_MODE_SERVER,
+        .stratum = 3,
+        .poll = 6,
+        .precision = -20,
+        .root_delay = 0x00012345,
+        .root_dispersion = 0x00000678,
+        .ref_id = 0xC0A80101,
+        .ref_ts = { 1, 2 },
+        .orig_ts = { 3, 4 },
+        .recv_ts = { 5, 6 },
+        .xmit_ts = { 0xFFFFFFFF, 0x80000000 },
+    };
+    uint8_t buf[NTP_PACKET_SIZE];
+    ntp_packet_encode(&pkt, buf);
+    CHECK_EQ(buf[0], (1 << 6) | (NTP_VERSION << 3) | NTP_MODE_SERVER);
+
+    ntp_packet_t decoded;
+    CHECK(ntp_packet_decode(buf, sizeof(buf), &decoded));
+    CHECK_EQ(decoded.leap, pkt.leap);
+    CHECK_EQ(decoded.version, pkt.version);
+    CHECK_EQ(decoded.mode, pkt.mode);
+    CHECK_EQ(decoded.stratum, pkt.stratum);
+    CHECK_EQ(decoded.poll, pkt.poll);
+    CHECK_EQ(decoded.precision, pkt.precision);
+    CHECK_EQ(decoded.root_delay, pkt.root_delay);
+    CHECK_EQ(decoded.root_dispersion, pkt.root_dispersion);
+    CHECK_EQ(decoded.ref_id, pkt.ref_id);
+    CHECK(ntp_ts_equal(decoded.ref_ts, pkt.ref_ts));
+    CHECK(ntp_ts_equal(decoded.orig_ts, pkt.orig_ts));
+    CHECK(ntp_ts_equal(decoded.recv_ts, pkt.recv_ts));
+    CHECK(ntp_ts_equal(decoded.xmit_ts, pkt.xmit_ts));
+    CHECK(!ntp_packet_decode(buf, NTP_PACKET_SIZE - 1, &decoded));
+}
+
+static void test_timestamps(void) {
+    // Unix epoch and the last second of era 0
+    ntp_ts_t ts = ntp_ts_from_unix_us(0);
+    CHECK_EQ(ts.sec, 2208988800u);
+    CHECK_EQ(ts.frac, 0);
+    ts = ntp_ts_from_unix_us((ERA1_UNIX_SEC - 1) * US + 500000);
+    CHECK_EQ(ts.sec, 0xFFFFFFFFu);
+    CHECK_EQ(ts.frac, 0x80000000u);
+
+    // Era 1 wraps the seconds field to zero but converts back past 2036
+    ts = ntp_ts_from_unix_us(ERA1_UNIX_SEC * US);
+    CHECK_EQ(ts.sec, 0);
+    CHECK_EQ(ntp_ts_to_unix_us(ts), ERA1_UNIX_SEC * US);
+
+    // Round trip keeps microseconds on both sides of the boundary
+    const int64_t samples[] = {
+        1700000000LL * US + 123456,
+        (ERA1_UNIX_SEC - 1) * US + 999999,
+        ERA1_UNIX_SEC * US + 1,
+        (ERA1_UNIX_SEC + 86400) * US + 654321,
+    };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        CHECK_NEAR(ntp_ts_to_unix_us(ntp_ts_from_unix_us(samples[i])), samples[i], 1);
+    }
+
+    // 16.16 short format
+    CHECK_EQ(ntp_short_from_us(1000000), 0x10000);
+    CHECK_EQ(ntp_short_to_us(0x8000), 500000);
+    CHECK_EQ(ntp_short_to_us(0xFFFFFFFF), UINT32_MAX);   // Saturates
+}
+
+static void test_offset_delay(void) {
+    int64_t offset, delay;
+
+    // Server 2 s ahead, 10 ms each way, 1 ms server hold
+    int64_t t1 = 1700000000LL * US;
+    ntp_compute_offset_delay(t1, t1 + 2010000, t1 + 2011000, t1 + 21000, &offset, &delay);
+    CHECK_EQ(offset, 2000000);
+    CHECK_EQ(delay, 20000);
+
+    // Exchange straddling the era rollover: the client sends in era 0 and
+    // receives in era 1. Timestamps go through the wire format.
+    int64_t c1 = (ERA1_UNIX_SEC - 1) * US + 990000;
+    int64_t s2 = c1 + 15000 - 250000;      // Server 250 ms behind, 15 ms path
+    int64_t s3 = s2 + 500;
+    int64_t c4 = c1 + 30500;
+    CHECK_EQ(ntp_ts_from_unix_us(c1).sec, 0xFFFFFFFFu);
+    CHECK_EQ(ntp_ts_from_unix_us(c4).sec, 0);
+
+    ntp_compute_offset_delay(ntp_ts_to_unix_us(ntp_ts_from_unix_us(c1)),
+                             ntp_ts_to_unix_us(ntp_ts_from_unix_us(s2)),
+                             ntp_ts_to_unix_us(ntp_ts_from_unix_us(s3)),
+                             ntp_ts_to_unix_us(ntp_ts_from_unix_us(c4)),
+                             &offset, &delay);
+    CHECK_NEAR(offset, -250000, 1);
+    CHECK_NEAR(delay, 30000, 2);
+
+    // Server clock behind our receive time cannot make the delay negative
+    ntp_compute_offset_delay(t1, t1 + 5000, t1 + 9000, t1 + 1000, &offset, &delay);
+    CHECK_EQ(delay, 0);
+}
+
+int main(void) {
+    test_check_reply();
+    test_kiss_codes();
+    test_packet_round_trip();
+    test_timestamps();
+    test_offset_delay();
+    return TEST_RESULT();
+}
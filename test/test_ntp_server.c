@@ -0,0 +1,135 @@
+#define _DEFAULT_SOURCE
+#include "fake_sntp.h"
+#include "ntp_client.h"
+#include "ntp_proto.h"
+#include "test.h"
+#include <arpa/inet.h>
+#include <sys/time.h>
+
+#define US                  1000000LL
+#define NOW_US              (1700000000LL * US)
+
+static int64_t host_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Only exchanges are made, so the clock is never corrected
+static const ntp_client_t client = {
+    .now_us = host_now_us,
+    .timeout_ms = 1000,
+    .burst_samples = 1,
+};
+
+static ntp_packet_t make_request(void) {
+    ntp_packet_t request = {
+        .version = NTP_VERSION,
+        .mode = NTP_MODE_CLIENT,
+        .poll = 6,
+        .xmit_ts = ntp_ts_from_unix_us(NOW_US - 5000),
+    };
+    return request;
+}
+
+static const ntp_reference_t synced_ref = {
+    .synced = true,
+    .stratum = 2,
+    .ref_id = 0xC0A80001,
+    .sync_us = NOW_US - 100 * US,
+    .root_delay_us = 20000,
+    .root_dispersion_us = 1000,
+};
+
+static void test_reply_header(void) {
+    ntp_packet_t request = make_request();
+    ntp_packet_t reply;
+    CHECK(ntp_make_reply(&request, NOW_US, &synced_ref, &reply));
+
+    CHECK_EQ(reply.mode, NTP_MODE_SERVER);
+    CHECK_EQ(reply.version, NTP_VERSION);
+    CHECK_EQ(reply.poll, 6);
+    CHECK_EQ(reply.leap, 0);
+    CHECK_EQ(reply.stratum, 3);         // One below our upstream
+    CHECK_EQ(reply.ref_id, 0xC0A80001);
+    CHECK(ntp_ts_equal(reply.orig_ts, request.xmit_ts));
+    CHECK_EQ(ntp_ts_to_unix_us(reply.recv_ts), NOW_US);
+    CHECK_EQ(ntp_ts_to_unix_us(reply.ref_ts), synced_ref.sync_us);
+    CHECK_NEAR(ntp_short_to_us(reply.root_delay), 20000, 16);
+
+    // 100 s since sync at 15 ppm adds 1.5 ms of dispersion
+    CHECK_NEAR(ntp_short_to_us(reply.root_dispersion), 1000 + 1500, 16);
+
+    // Older clients get their own version back
+    request.version = 3;
+    CHECK(ntp_make_reply(&request, NOW_US, &synced_ref, &reply));
+    CHECK_EQ(reply.version, 3);
+}
+
+static void test_reply_stratum(void) {
+    ntp_packet_t request = make_request();
+    ntp_packet_t reply;
+    ntp_reference_t ref = synced_ref;
+
+    ref.stratum = NTP_STRATUM_MAX;
+    CHECK(ntp_make_reply(&request, NOW_US, &ref, &reply));
+    CHECK_EQ(reply.stratum, NTP_STRATUM_MAX);
+
+    // Without a sync of our own, clients must not use us
+    ref.synced = false;
+    CHECK(ntp_make_reply(&request, NOW_US, &ref, &reply));
+    CHECK_EQ(reply.leap, NTP_LI_ALARM);
+    CHECK_EQ(reply.stratum, NTP_STRATUM_UNSYNC);
+    reply.xmit_ts = ntp_ts_from_unix_us(NOW_US);
+    CHECK_EQ(ntp_check_reply(&request, &reply), NTP_REPLY_UNSYNCED);
+}
+
+static void test_ignored_requests(void) {
+    ntp_packet_t request = make_request();
+    ntp_packet_t reply;
+
+    request.mode = NTP_MODE_SERVER;
+    CHECK(!ntp_make_reply(&request, NOW_US, &synced_ref, &reply));
+    request.mode = 1;   // Symmetric active
+    CHECK(!ntp_make_reply(&request, NOW_US, &synced_ref, &reply));
+
+    request = make_request();
+    request.version = 0;
+    CHECK(!ntp_make_reply(&request, NOW_US, &synced_ref, &reply));
+    request.version = NTP_VERSION + 1;
+    CHECK(!ntp_make_reply(&request, NOW_US, &synced_ref, &reply));
+}
+
+// A clock on the LAN syncing from another one over UDP
+static void test_loopback(void) {
+    fake_sntp_config_t config = {
+        .offset_us = -700000,
+        .path_delay_us = 2000,
+        .as_clock = true,
+        .reference = synced_ref,
+    };
+    fake_sntp_t *server = fake_sntp_start(&config);
+    CHECK(server != NULL);
+    if (!server) return;
+
+    uint32_t ip = htonl(INADDR_LOOPBACK);
+    ntp_measurement_t m;
+    CHECK_EQ(ntp_client_query(&client, ip, fake_sntp_port(server), &m), NTP_REPLY_OK);
+    CHECK(m.delay_us >= 4000);
+    CHECK_NEAR(m.offset_us, config.offset_us, m.delay_us / 2 + 1000);
+    CHECK_EQ(m.reply.stratum, 3);
+
+    config.reference.synced = false;
+    fake_sntp_configure(server, &config);
+    CHECK_EQ(ntp_client_query(&client, ip, fake_sntp_port(server), &m), NTP_REPLY_UNSYNCED);
+
+    fake_sntp_stop(server);
+}
+
+int main(void) {
+    test_reply_header();
+    test_reply_stratum();
+    test_ignored_requests();
+    test_loopback();
+    return TEST_RESULT();
+}
@@ -0,0 +1,280 @@
+#include "peer_beacon.h"
+#include "config.h"
+#include "test.h"
+
+#define MAX_PHASE_US    ((int64_t)PEER_SYNC_MAX_PHASE_MS * 1000)
+#define SLEW_US         PEER_SYNC_SLEW_US
+
+static void test_codec(void) {
+    peer_beacon_t beacon = {
+        .stratum = 3,
+        .node_id = 0xA1B2C3D4,
+        .time_us = 1700000000123456LL,
+    };
+    uint8_t buf[PEER_BEACON_SIZE];
+    peer_beacon_encode(&beacon, buf);
+
+    peer_beacon_t decoded;
+    CHECK(peer_beacon_decode(buf, sizeof(buf), &decoded));
+    CHECK_EQ(decoded.stratum, 3);
+    CHECK_EQ(decoded.node_id, 0xA1B2C3D4);
+    CHECK_EQ(decoded.time_us, 1700000000123456LL);
+
+    CHECK(!peer_beacon_decode(buf, PEER_BEACON_SIZE - 1, &decoded));
+    buf[4]++;               // Version
+    CHECK(!peer_beacon_decode(buf, sizeof(buf), &decoded));
+    buf[4]--;
+    buf[0] ^= 0x80;         // Magic
+    CHECK(!peer_beacon_decode(buf, sizeof(buf), &decoded));
+}
+
+static void test_ranking(void) {
+    CHECK(peer_beacon_outranks(1, 900, 2, 100));
+    CHECK(!peer_beacon_outranks(2, 100, 1, 900));
+    CHECK(peer_beacon_outranks(2, 100, 2, 900));
+    CHECK(!peer_beacon_outranks(2, 900, 2, 100));
+    CHECK(!peer_beacon_outranks(2, 100, 2, 100));
+    CHECK(peer_beacon_outranks(15, 0xFFFFFFFF, PEER_STRATUM_NONE, 0));
+}
+
+static void test_phase_estimate(void) {
+    peer_phase_t phase;
+    peer_phase_reset(&phase);
+    int32_t estimate = 0;
+
+    // Largest sample wins: it saw the least one-way delay
+    CHECK(peer_phase_add(&phase, -3000, MAX_PHASE_US, &estimate));
+    CHECK_EQ(estimate, -3000);
+    CHECK(peer_phase_add(&phase, -1000, MAX_PHASE_US, &estimate));
+    CHECK(peer_phase_add(&phase, -2500, MAX_PHASE_US, &estimate));
+    CHECK_EQ(estimate, -1000);
+
+    // Outliers are dropped and leave the estimate alone
+    CHECK(!peer_phase_add(&phase, MAX_PHASE_US + 1, MAX_PHASE_US, &estimate));
+    CHECK(!peer_phase_add(&phase, -MAX_PHASE_US - 1, MAX_PHASE_US, &estimate));
+    CHECK_EQ(phase.count, 3);
+
+    // The best sample ages out after a full window
+    for (int i = 0; i < PEER_PHASE_WINDOW - 1; i++) {
+        CHECK(peer_phase_add(&phase, -2000, MAX_PHASE_US, &estimate));
+    }
+    CHECK_EQ(estimate, -2000);
+
+    peer_phase_reset(&phase);
+    CHECK(peer_phase_add(&phase, -9000, MAX_PHASE_US, &estimate));
+    CHECK_EQ(estimate, -9000);
+}
+
+static void test_slew(void) {
+    CHECK_EQ(peer_phase_slew(0, 20000, SLEW_US), 5000);
+    CHECK_EQ(peer_phase_slew(0, -20000, SLEW_US), -5000);
+    CHECK_EQ(peer_phase_slew(4000, 6000, SLEW_US), 6000);
+    CHECK_EQ(peer_phase_slew(-100, -100, SLEW_US), -100);
+}
+
+// Deterministic uniform value in [lo, hi]
+static int32_t uniform(uint32_t *state, int32_t lo, int32_t hi) {
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (int32_t)((*state >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+// N clocks whose system time differs by NTP residuals; clock 0 leads. Each
+// beacon reaches a follower after a random one-way delay, and the follower
+// folds the sample into its estimate and slews its displayed phase. The
+// spread of displayed time across all clocks must shrink from the NTP
+// residuals to below the average one-way delay.
+static void test_phase_spread(void) {
+    enum { CLOCKS = 8, BEACONS = 40 };
+    uint32_t rng = 12345;
+    int32_t error_us[CLOCKS];
+    int32_t applied_us[CLOCKS] = {0};
+    peer_phase_t phase[CLOCKS];
+
+    for (int i = 0; i < CLOCKS; i++) {
+        error_us[i] = uniform(&rng, -20000, 20000);
+        peer_phase_reset(&phase[i]);
+    }
+
+    int32_t initial_spread = 0;
+    int32_t spread = 0;
+    for (int beacon = 0; beacon <= BEACONS; beacon++) {
+        int32_t lo = INT32_MAX, hi = INT32_MIN;
+        for (int i = 0; i < CLOCKS; i++) {
+            int32_t shown = error_us[i] + applied_us[i];
+            if (shown < lo) lo = shown;
+            if (shown > hi) hi = shown;
+        }
+        spread = hi - lo;
+        if (beacon == 0) initial_spread = spread;
+        if (beacon == BEACONS) break;
+
+        for (int i = 1; i < CLOCKS; i++) {
+            int32_t delay_us = uniform(&rng, 300, 3000);
+            // Leader's clock reading minus our clock at receipt
+            int64_t sample = (int64_t)error_us[0] - error_us[i] - delay_us;
+            int32_t estimate;
+            if (peer_phase_add(&phase[i], sample, MAX_PHASE_US, &estimate)) {
+                applied_us[i] = peer_phase_slew(applied_us[i], estimate, SLEW_US);
+            }
+        }
+    }
+
+    printf("phase spread over %d clocks: %ld us -> %ld us\n", CLOCKS, (long)initial_spread, (long)spread);
+    CHECK(initial_spread > 10000);
+    CHECK(spread < 1500);
+}
+
+// A group of clocks on one subnet, stepped one beacon interval at a time.
+// Each round every clock ticks, and the beacons of those that lead reach
+// all the others that are still up.
+enum { GROUP_MAX = 4 };
+
+typedef struct {
+    peer_node_t nodes[GROUP_MAX];
+    uint8_t stratum[GROUP_MAX];
+    bool up[GROUP_MAX];
+    int count;
+    uint32_t now_ms;
+    int leader;                 // Last clock that sent in the latest round
+} group_t;
+
+static void group_add(group_t *g, uint32_t node_id, uint8_t stratum) {
+    peer_node_init(&g->nodes[g->count], node_id, PEER_SYNC_LEADER_TIMEOUT_MS, MAX_PHASE_US, SLEW_US);
+    g->stratum[g->count] = stratum;
+    g->up[g->count] = true;
+    g->count++;
+}
+
+// Run one round; returns how many clocks sent a beacon
+static int group_round(group_t *g) {
+    g->now_ms += PEER_SYNC_BEACON_MS;
+    bool sent[GROUP_MAX] = {false};
+    for (int i = 0; i < g->count; i++) {
+        if (g->up[i]) sent[i] = peer_node_tick(&g->nodes[i], g->stratum[i], g->now_ms);
+    }
+
+    int leaders = 0;
+    g->leader = -1;
+    for (int i = 0; i < g->count; i++) {
+        if (!sent[i]) continue;
+        g->leader = i;
+        leaders++;
+        peer_beacon_t beacon = {
+            .stratum = g->stratum[i],
+            .node_id = g->nodes[i].node_id,
+            .time_us = 1000000,
+        };
+        for (int j = 0; j < g->count; j++) {
+            if (j != i && g->up[j]) {
+                peer_node_receive(&g->nodes[j], &beacon, 1000000, g->stratum[j], g->now_ms);
+            }
+        }
+    }
+    return leaders;
+}
+
+// One round in which only clock i leads
+static bool led_alone(group_t *g, int i) {
+    return group_round(g) == 1 && g->leader == i;
+}
+
+static void test_election(void) {
+    group_t g = {0};
+    group_add(&g, 0x30, 3);
+    group_add(&g, 0x20, 2);
+    group_add(&g, 0x10, 2);
+    group_add(&g, 0x05, PEER_STRATUM_NONE);     // Not synced
+
+    // Every synced clock without a leader speaks up once; then the best remains
+    CHECK_EQ(group_round(&g), 3);
+    CHECK(led_alone(&g, 2));
+    CHECK(led_alone(&g, 2));
+    CHECK_EQ(g.nodes[0].leader_id, 0x10);
+    CHECK_EQ(g.nodes[1].leader_id, 0x10);
+    CHECK_EQ(g.nodes[3].leader_id, 0x10);
+    CHECK(!g.nodes[1].leading);
+    CHECK(!g.nodes[3].leading);
+}
+
+static void test_failover(void) {
+    group_t g = {0};
+    group_add(&g, 0x30, 3);
+    group_add(&g, 0x20, 2);
+    group_add(&g, 0x10, 2);
+    group_round(&g);
+    CHECK(led_alone(&g, 2));
+
+    // The leader goes quiet: nobody speaks until its beacons time out
+    g.up[2] = false;
+    uint32_t lost_ms = g.now_ms;
+    int sent;
+    do {
+        sent = group_round(&g);
+    } while (sent == 0 && g.now_ms - lost_ms < 2 * PEER_SYNC_LEADER_TIMEOUT_MS);
+    CHECK_EQ(sent, 2);
+    CHECK(g.now_ms - lost_ms >= PEER_SYNC_LEADER_TIMEOUT_MS);
+    CHECK(g.now_ms - lost_ms < PEER_SYNC_LEADER_TIMEOUT_MS + PEER_SYNC_BEACON_MS);
+
+    // Both survivors take over at once; the better one keeps the lead
+    CHECK(led_alone(&g, 1));
+    CHECK_EQ(g.nodes[0].leader_id, 0x20);
+
+    // Back again, the old leader outranks the new one and takes over
+    g.up[2] = true;
+    group_round(&g);
+    CHECK(led_alone(&g, 2));
+    CHECK_EQ(g.nodes[0].leader_id, 0x10);
+    CHECK_EQ(g.nodes[1].leader_id, 0x10);
+    CHECK(!g.nodes[1].leading);
+}
+
+// A follower whose own sync improves past its leader's takes over at once
+static void test_preemption(void) {
+    group_t g = {0};
+    group_add(&g, 0x20, 3);
+    group_add(&g, 0x10, 2);
+    group_round(&g);
+    CHECK(led_alone(&g, 1));
+
+    g.stratum[0] = 1;
+    group_round(&g);
+    CHECK_EQ(g.nodes[1].leader_id, 0x20);
+    CHECK(led_alone(&g, 0));
+}
+
+// Without a leader the applied phase slews back to system time
+static void test_phase_release(void) {
+    peer_node_t n;
+    peer_node_init(&n, 0x20, PEER_SYNC_LEADER_TIMEOUT_MS, MAX_PHASE_US, SLEW_US);
+    peer_beacon_t beacon = { .stratum = 2, .node_id = 0x10, .time_us = 1000000 + 3 * SLEW_US };
+    for (int i = 0; i < 3; i++) {
+        CHECK(peer_node_receive(&n, &beacon, 1000000, PEER_STRATUM_NONE, 0));
+    }
+    CHECK_EQ(n.applied_us, 3 * SLEW_US);
+
+    uint32_t now_ms = PEER_SYNC_LEADER_TIMEOUT_MS;
+    CHECK(!peer_node_tick(&n, PEER_STRATUM_NONE, now_ms));
+    CHECK_EQ(n.applied_us, 2 * SLEW_US);
+    CHECK(!peer_node_tick(&n, PEER_STRATUM_NONE, now_ms));
+    CHECK(!peer_node_tick(&n, PEER_STRATUM_NONE, now_ms));
+    CHECK_EQ(n.applied_us, 0);
+
+    // A dropped link forgets the leader and the phase at once
+    CHECK(peer_node_receive(&n, &beacon, 1000000, PEER_STRATUM_NONE, now_ms));
+    peer_node_reset(&n);
+    CHECK_EQ(n.leader_stratum, PEER_STRATUM_NONE);
+    CHECK_EQ(n.applied_us, 0);
+}
+
+int main(void) {
+    test_codec();
+    test_ranking();
+    test_phase_estimate();
+    test_slew();
+    test_phase_spread();
+    test_election();
+    test_failover();
+    test_preemption();
+    test_phase_release();
+    return TEST_RESULT();
+}
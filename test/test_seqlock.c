@@ -0,0 +1,81 @@
+#include "seqlock.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdint.h>
+
+// A writer thread keeps rewriting a struct whose fields must always agree;
+// readers on other threads must never copy a mix of two writes.
+
+#define READERS     3
+#define WRITES      2000000
+
+typedef struct {
+    uint64_t a;
+    uint32_t b;
+    uint64_t c;
+    char tag[24];
+} status_t;
+
+static status_t shared;
+static seqlock_t shared_seq = SEQLOCK_INIT;
+static atomic_bool writing_done = false;
+
+static void *writer(void *arg) {
+    (void)arg;
+    for (uint64_t i = 1; i <= WRITES; i++) {
+        seqlock_write_begin(&shared_seq);
+        shared.a = i;
+        shared.b = (uint32_t)i * 3;
+        shared.c = ~i;
+        memset(shared.tag, (char)i, sizeof(shared.tag));
+        seqlock_write_end(&shared_seq);
+    }
+    atomic_store(&writing_done, true);
+    return NULL;
+}
+
+static bool consistent(const status_t *s) {
+    if (s->b != (uint32_t)s->a * 3 || s->c != ~s->a) return false;
+    for (size_t i = 0; i < sizeof(s->tag); i++) {
+        if (s->tag[i] != (char)s->a) return false;
+    }
+    return true;
+}
+
+static void *reader(void *arg) {
+    long *torn = arg;
+    uint64_t last = 0;
+    while (!atomic_load(&writing_done)) {
+        status_t copy;
+        SEQLOCK_READ(&shared_seq, &copy, &shared);
+        if (!consistent(&copy) || copy.a < last) (*torn)++;
+        last = copy.a;
+    }
+    return NULL;
+}
+
+int main(void) {
+    // The initial all-zero state is consistent: ~0 is the only odd one out
+    shared.c = ~(uint64_t)0;
+
+    pthread_t writer_thread, reader_threads[READERS];
+    long torn[READERS] = {0};
+    for (int i = 0; i < READERS; i++) {
+        pthread_create(&reader_threads[i], NULL, reader, &torn[i]);
+    }
+    pthread_create(&writer_thread, NULL, writer, NULL);
+
+    pthread_join(writer_thread, NULL);
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(reader_threads[i], NULL);
+        CHECK_EQ(torn[i], 0);
+    }
+
+    // Sequence is even again and the last write is visible
+    CHECK_EQ(atomic_load(&shared_seq.seq) & 1, 0);
+    status_t copy;
+    SEQLOCK_READ(&shared_seq, &copy, &shared);
+    CHECK_EQ(copy.a, WRITES);
+    CHECK(consistent(&copy));
+    return TEST_RESULT();
+}